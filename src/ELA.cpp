@@ -1,18 +1,72 @@
 #include "checkpoint/checkpoint.h"
 #include "globalVariables.h"
+#include "output/asciilog.h"
+#include "output/vv.h"
 #include <ELA.h>
+#include <ELA_Output.h>
+#include <stdexcept>
 
 // define global variables
 namespace ela {
 DomainType* dom;
 int inputPad[6];
+domain::HaloSettings haloSettings;
 } // namespace ela
 
+void ELA_SetHaloEncoding(const int& encoding)
+{
+    if (encoding < ELA_HALO_ENCODING_ELEMENTS || encoding > ELA_HALO_ENCODING_COMPACT_FLOAT) {
+        throw std::invalid_argument("Unknown halo encoding");
+    }
+    ela::haloSettings.encoding = static_cast<domain::Encoding>(encoding);
+}
+
+void ELA_SetHaloBackend(const int& backend)
+{
+    if (backend < ELA_HALO_BACKEND_POINT_TO_POINT || backend > ELA_HALO_BACKEND_SHARED_MEMORY) {
+        throw std::invalid_argument("Unknown halo backend");
+    }
+    ela::haloSettings.backend = static_cast<domain::Backend>(backend);
+}
+
+void ELA_SetHaloUpwindOnly(const int& upwindOnly)
+{
+    ela::haloSettings.upwindOnly = (upwindOnly != 0);
+}
+
+void ELA_SetHaloDelta(const int& delta)
+{
+    ela::haloSettings.delta = (delta != 0);
+}
+
+void ELA_SetHaloThreads(const int& threads)
+{
+    if (threads < 1) {
+        throw std::invalid_argument("Number of halo threads must be positive");
+    }
+    ela::haloSettings.threads = threads;
+}
+
+void ELA_SetHaloDepth(const int& depth)
+{
+    if (depth < 1) {
+        throw std::invalid_argument("Halo depth must be positive");
+    }
+    ela::haloSettings.depth = depth;
+}
+
 #ifdef ELA_USE_MPI
 void ELA_Init(const int* N, const int* pad, const int& numELA, MPI_Comm cart_comm)
 {
+    // the fluxes and cell sizes are needed in a deep halo
+    for (auto f = 0; f < 6; ++f) {
+        if (ela::haloSettings.depth > 1 && pad[f] < ela::haloSettings.depth) {
+            throw std::invalid_argument("Padding must be at least the halo depth");
+        }
+    }
+
     std::copy(pad, pad + 6, ela::inputPad);
-    ela::dom = new ela::DomainType(N[0], N[1], N[2], numELA, cart_comm);
+    ela::dom = new ela::DomainType(N[0], N[1], N[2], numELA, cart_comm, ela::haloSettings);
 }
 #else
 void ELA_Init(const int* N, const int* pad, const int& numELA)
@@ -24,6 +78,15 @@ void ELA_Init(const int* N, const int* pad, const int& numELA)
 
 void ELA_DeInit()
 {
+    // pending output uses the communicator
+    ELA_OutputFlush();
+    ela::resetOutput();
+
+#ifdef ELA_USE_MPI
+    output::ASCIILog::freeTypes();
+    output::VolumeVector::freeTypes();
+#endif
+
     delete ela::dom;
 }
 
@@ -41,6 +104,9 @@ void ELA_InitLabels(const double* vof, const int& num, const int* labels)
         sVector = svec::SVector(svec::Element{
             static_cast<svec::Label>(*(l++)), static_cast<svec::Value>(1.0 - *(v++))});
     }
+
+    ela::dom->markChanged(num);
+    ela::invalidateGhosts();
 }
 
 int ELA_GetLabel(const int& i, const int& j, const int& k, const int& n)
@@ -81,4 +147,9 @@ void ELA_LoadCheckpoint(const char* filename)
 {
     assert(ela::dom != nullptr);
     checkpoint::load(filename, *ela::dom);
+
+    for (auto n = 0; n < ela::dom->nn; ++n) {
+        ela::dom->markChanged(n);
+    }
+    ela::invalidateGhosts();
 }
@@ -22,6 +22,113 @@ extern "C" {
  * @file
  */
 
+/**
+ * @brief Formats for the data exchanged between processors, see ELA_SetHaloEncoding()
+ *
+ */
+enum ELA_HaloEncoding
+{
+    /** Version 1 format, non-zero entries are sent uncompressed (16 bytes each) */
+    ELA_HALO_ENCODING_ELEMENTS = 0,
+    /** Version 2 format, labels are delta and varint encoded (default) */
+    ELA_HALO_ENCODING_COMPACT = 1,
+    /** Version 2 format with values rounded to single precision (lossy) */
+    ELA_HALO_ENCODING_COMPACT_FLOAT = 2
+};
+
+/**
+ * @brief Set the format of the ghost cell data exchanged between processors
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param encoding One of \ref ELA_HaloEncoding
+ */
+void ELA_SetHaloEncoding(const int& encoding);
+
+/**
+ * @brief MPI communication used to exchange data between processors, see ELA_SetHaloBackend()
+ *
+ */
+enum ELA_HaloBackend
+{
+    /** Non-blocking point-to-point messages with each neighbor (default) */
+    ELA_HALO_BACKEND_POINT_TO_POINT = 0,
+    /** Neighborhood collective (`MPI_Ineighbor_alltoallv`) on a distributed graph communicator */
+    ELA_HALO_BACKEND_NEIGHBORHOOD = 1,
+    /** MPI-3 shared memory window with neighbors on the same node, messages otherwise */
+    ELA_HALO_BACKEND_SHARED_MEMORY = 2
+};
+
+/**
+ * @brief Set how ghost cell data is exchanged between processors
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param backend One of \ref ELA_HaloBackend
+ */
+void ELA_SetHaloBackend(const int& backend);
+
+/**
+ * @brief Only exchange the ghost cells needed as upwind sources in ELA_SolverAdvectLabels()
+ *
+ * When enabled, a ghost cell is only sent when the flux on its face is into the processor's
+ * domain. For flows with a dominant direction, this roughly halves the data exchanged.
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param upwindOnly Non-zero to enable, zero (default) to exchange all ghost cells
+ */
+void ELA_SetHaloUpwindOnly(const int& upwindOnly);
+
+/**
+ * @brief Only exchange the ghost cells which changed since the last exchange
+ *
+ * When enabled, each processor keeps a copy of the data last exchanged with its neighbors, and only
+ * a bitmap plus the changed cells are sent. This helps when much of the boundary is quiescent,
+ * at the cost of the memory for the copies.
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param delta Non-zero to enable, zero (default) to send all ghost cells every exchange
+ */
+void ELA_SetHaloDelta(const int& delta);
+
+/**
+ * @brief Set the number of threads used to exchange ghost cells and advect ELA instances
+ *
+ * With more than one thread, each ELA instance is exchanged and advected independently in
+ * ELA_SolverAdvectLabels(), and advection of an instance starts as soon as its ghost cells arrive.
+ * This requires #ELA_HALO_BACKEND_POINT_TO_POINT and that MPI was initialized with
+ * `MPI_Init_thread()` providing `MPI_THREAD_MULTIPLE`.
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param threads The number of threads, `1` (default) to use only the calling thread
+ */
+void ELA_SetHaloThreads(const int& threads);
+
+/**
+ * @brief Set the number of layers of ghost cells exchanged between processors
+ *
+ * With \p depth layers, up to \p depth consecutive calls to ELA_SolverAdvectLabels() in the same
+ * direction (e.g., substeps) need only one exchange, as the cells near the boundary are also
+ * advected locally. Any other call which changes the vector source fraction requires a new
+ * exchange. This requires all padding given to ELA_Init() to be at least \p depth, and cannot be
+ * combined with ELA_SetHaloUpwindOnly().
+ *
+ * @warning There is no benefit for split (directional) sweeps, where each call to
+ * ELA_SolverAdvectLabels() is in a different direction than the last, e.g., `0`, `1`, `2` each
+ * time step. Advecting in one direction changes the cells the ghost cells of the other directions
+ * are copied from, and they can not be advected locally as the corner ghost cells are not
+ * exchanged, so every such call exchanges all \p depth layers. Deeper halos then only send more
+ * data.
+ *
+ * @note Must be called before ELA_Init(). Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param depth The number of layers, `1` (default) to exchange every call
+ */
+void ELA_SetHaloDepth(const int& depth);
+
 #ifdef ELA_USE_MPI
 /**
  * @brief Initialize the ELA library
@@ -52,7 +159,8 @@ void ELA_Init(const int* N, const int* pad, const int& numELA);
 /**
  * @brief Cleanup ELA
  *
- * Dealocates memory reserved by ELA_Init()
+ * Dealocates memory reserved by ELA_Init(). Any output not yet written is written first, see
+ * ELA_OutputFlush().
  *
  */
 void ELA_DeInit();
@@ -3,11 +3,209 @@
 #include "naming.h"
 
 #include "output/asciilog.h"
+#include "output/backgroundwriter.h"
+#include "output/container.h"
+#include "output/events.h"
 #include "output/vtm.h"
 #include "output/vv.h"
 
 #include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string.h>
+#include <thread>
+#include <vector>
+
+// whether the reductions are left running between calls, see ELA_SetOutputAsync()
+static bool async = false;
+
+// whether the volume tracking matrix is summed and written in parallel, see
+// ELA_SetOutputDistributed()
+static bool distributed = false;
+
+// number of snapshots of the log reduced and written together, see ELA_SetOutputLogInterval()
+static int logInterval = 1;
+
+// snapshots of the log not yet reduced, their times, and the file to write them to
+static std::unique_ptr<output::ASCIILog> logBatch;
+static std::vector<double> logTimes;
+static std::string logFilename;
+
+// the format of the volume tracking matrix files, see ELA_SetOutputMatrixEncoding()
+static output::MatrixEncoding matrixEncoding = output::MatrixEncoding::plain;
+
+// whether snapshots are appended to a container, see ELA_SetOutputContainer()
+static bool useContainer = false;
+
+// the container of each folder, kept open until ELA_OutputFlush()
+static std::map<std::string, std::shared_ptr<output::ContainerWriter>> containers;
+
+// whether events are found from the volume tracking matrices, see ELA_SetOutputEvents()
+static int eventOutput = ELA_EVENTS_OFF;
+
+// which entries of the volume tracking matrix are links, see ELA_SetOutputEventThresholds()
+static output::EventThresholds eventThresholds;
+
+// the event detector of each folder, kept between the matrices written to it
+static std::map<std::string, std::shared_ptr<output::EventDetector>> detectors;
+
+// number of threads used to sum the outputs, see ELA_SetOutputThreads()
+static int threads = 1;
+
+// the most blocks the field is split into to sum the outputs
+// the blocks only depend on the size of the domain, so the sums do not depend on the threads
+constexpr int maxBlocks = 16;
+
+// the direction the field is split along, with the slowest index
+#ifdef F_STYLE
+constexpr int blockDim = 2;
+#else
+constexpr int blockDim = 0;
+#endif
+
+// the last matrix of ELA_OutputGetVTM(), the rows on this process
+static int vtmFirstRow = 0;
+static std::vector<output::Int_BinType> vtmRowIndex(1, 0);
+static std::vector<output::Int_BinType> vtmColumnIndex;
+static std::vector<output::Fp_BinType> vtmValues;
+
+// the last volume vector of ELA_OutputGetV(), only on root
+static std::vector<output::Fp_BinType> vvValues;
+
+// writes files on a background thread, see ELA_SetOutputBackground()
+static std::unique_ptr<output::BackgroundWriter> writer;
+
+// an output, whose reductions are started in the order it was requested
+struct Pending {
+    // starts the reductions
+    std::function<void()> start;
+
+    // continues the reductions without waiting, and returns true once they are complete
+    std::function<bool()> proceed;
+
+    // whether the reductions have collectives left to start
+    // a write which communicates does so on its own communicator, so is not counted
+    std::function<bool()> collective;
+
+    // writes the output, once the reductions are complete
+    std::function<void()> write;
+
+    // false if the write communicates, so must be done at the same call on every process
+    bool local;
+
+    bool started = false;
+    bool reduced = false;
+};
+
+// outputs which have not been written, in the order they were requested
+static std::deque<Pending> pending;
+
+// continue the reductions of every pending output without waiting, then write those complete, in
+// order
+// an output only starts a collective once those before it have started all of theirs, so the
+// collectives are started in the same order on every process however long each takes
+static void progressPending()
+{
+    // whether the outputs so far have no collectives left to start
+    bool ordered = true;
+    for (auto& p : pending) {
+        if (!p.started) {
+            // started in order, so the tags are too
+            if (!ordered && p.collective()) break;
+            p.start();
+            p.started = true;
+        }
+        if (!p.reduced && (ordered || !p.collective())) p.reduced = p.proceed();
+        ordered = ordered && !p.collective();
+    }
+
+    while (!pending.empty() && pending.front().reduced && pending.front().local) {
+        pending.front().write();
+        pending.pop_front();
+    }
+}
+
+// continue the pending outputs, removing those written
+// this is done at the same points on every process
+static void continuePending()
+{
+    // each output is completed by the call after it was requested if its write communicates, and
+    // so are the outputs before it
+    auto last = std::find_if(pending.rbegin(), pending.rend(), [](const Pending& p) {
+        return !p.local;
+    });
+    for (auto count = pending.rend() - last; count > 0; --count) {
+        auto& p = pending.front();
+        if (!p.started) p.start();
+        while (!p.reduced) {
+            p.reduced = p.proceed();
+        }
+        p.write();
+        pending.pop_front();
+    }
+
+    progressPending();
+}
+
+// continue the pending outputs until all are written
+static void completePending()
+{
+    while (!pending.empty()) {
+        continuePending();
+    }
+}
+
+// queue the reductions of the output, it is written with write(*out) once they are complete
+// if local is true, write does not communicate so can be done by the background writer
+// if given, prepare(*out) is called just before the reductions are started
+template <class Output, class Write>
+static void start(
+    std::shared_ptr<Output> out, Write write, const bool& local = true,
+    std::function<void(Output&)> prepare = nullptr
+)
+{
+    Pending p;
+    p.start = [out, prepare]() {
+        if (prepare) prepare(*out);
+        out->startFinalize();
+    };
+    p.proceed = [out]() { return out->continueFinalize(); };
+    p.collective = [out]() { return out->hasCollectivesToStart(); };
+    p.write = [out, write, local]() {
+        if (writer && local) {
+            // keeps the output until written
+            writer->submit([out, write]() { write(*out); });
+        }
+        else {
+            write(*out);
+        }
+    };
+    p.local = local;
+    pending.push_back(std::move(p));
+}
+
+template <class Output, class Write>
+static void start(std::unique_ptr<Output> out, Write write, const bool& local = true)
+{
+    start(std::shared_ptr<Output>(std::move(out)), write, local);
+}
+
+// wait for the outputs started, unless asynchronous
+static void finish()
+{
+#ifdef ELA_USE_MPI
+    if (async) {
+        progressPending();
+        return;
+    }
+#endif
+
+    completePending();
+}
 
 // Name of a volume vector file
 std::string getNameVVFileName(const char* folder, const int& t_num)
@@ -41,90 +239,693 @@ std::string getNameASCIILogFileName(const char* folder)
     return std::string(folder) + "/" + "tracking.log";
 }
 
+// Name of the event log file
+std::string getNameEventsFileName(const char* folder)
+{
+    return std::string(folder) + "/" + EVENTS_FILENAME + "." + EVENTS_FILENAME_EXT;
+}
+
+// Name of the container data file
+std::string getNameContainerDataFileName(const char* folder)
+{
+    return std::string(folder) + "/" + CONTAINER_FILENAME + "." + CONTAINER_DATA_EXT;
+}
+
+// Name of the container index file
+std::string getNameContainerIndexFileName(const char* folder)
+{
+    return std::string(folder) + "/" + CONTAINER_FILENAME + "." + CONTAINER_INDEX_EXT;
+}
+
+// the container of the folder, the files are opened when first written
+static std::shared_ptr<output::ContainerWriter> getContainer(const char* folder)
+{
+    auto& container = containers[folder];
+    if (!container) {
+        container = std::make_shared<output::ContainerWriter>(
+            getNameContainerDataFileName(folder), getNameContainerIndexFileName(folder)
+        );
+    }
+    return container;
+}
+
+// the event detector of the folder, which keeps the last volume vector
+static std::shared_ptr<output::EventDetector> getEventDetector(const char* folder)
+{
+    auto& detector = detectors[folder];
+    if (!detector) detector = std::make_shared<output::EventDetector>();
+    return detector;
+}
+
+// a volume vector with rows for the labels on this processor, made global by finalize
+static std::unique_ptr<output::VolumeVector> createVV(const int& maxLabel)
+{
+#ifdef ELA_USE_MPI
+    return std::make_unique<output::VolumeVector>(maxLabel, ela::dom->getOutputComm());
+#else
+    return std::make_unique<output::VolumeVector>(maxLabel);
+#endif
+}
+
+// start the reductions of the volume vector, then write the volume vector file in each folder
+static void startVV(
+    std::shared_ptr<output::VolumeVector> vv, const std::vector<const char*>& folders,
+    const int& t_num, const double& time
+)
+{
+    if (useContainer) {
+        std::vector<std::shared_ptr<output::ContainerWriter>> containers;
+        for (const auto& folder : folders) {
+            containers.push_back(getContainer(folder));
+        }
+        start(std::move(vv), [containers, t_num, time](output::VolumeVector& vv) {
+            for (const auto& container : containers) {
+                vv.writeToContainer(*container, t_num, time);
+            }
+        });
+        return;
+    }
+
+    std::vector<std::string> filenames;
+    for (const auto& folder : folders) {
+        filenames.push_back(getNameVVFileName(folder, t_num));
+    }
+    start(std::move(vv), [filenames](output::VolumeVector& vv) {
+        for (const auto& filename : filenames) {
+            vv.write(filename.c_str());
+        }
+    });
+}
+
+// whether the volume tracking matrices written are distributed
+// events are found on root, so it needs the whole matrix
+static bool isWrittenDistributed()
+{
+    return distributed && eventOutput == ELA_EVENTS_OFF;
+}
+
+// append the events of the volume tracking matrix to the event log of the detector
+// the volumes of the blobs are from vv if given, otherwise the sums of the rows
+static void writeEvents(
+    const output::VolumeTrackingMatrix& vtm, const output::VolumeVector* vv,
+    output::EventDetector& detector, const std::string& filename, const int& t_num,
+    const double& time, const output::EventThresholds& thresholds
+)
+{
+    // only root has any rows, so only root finds any events
+    int firstRow;
+    std::vector<output::Int_BinType> rowIndex, columnIndex;
+    std::vector<output::Fp_BinType> values;
+    vtm.getRows(firstRow, rowIndex, columnIndex, values);
+
+    std::vector<output::Fp_BinType> volumes;
+    if (vv) {
+        vv->getValues(volumes);
+    }
+    else {
+        volumes.assign(rowIndex.size() - 1, 0.0);
+        for (std::size_t i = 0; i < volumes.size(); ++i) {
+            for (auto k = rowIndex[i]; k < rowIndex[i + 1]; ++k) {
+                volumes[i] += values[k];
+            }
+        }
+    }
+
+    output::writeEvents(
+        filename.c_str(),
+        detector.detect(t_num, time, volumes, rowIndex, columnIndex, values, thresholds)
+    );
+}
+
+// a volume tracking matrix with rows for the labels on this processor, made global by finalize
+static std::unique_ptr<output::VolumeTrackingMatrix> createVTM(
+    const int& maxLabel, [[maybe_unused]] const bool& dist = isWrittenDistributed()
+)
+{
+#ifdef ELA_USE_MPI
+    return std::make_unique<output::VolumeTrackingMatrix>(
+        maxLabel, ela::dom->getOutputComm(), dist, ela::dom->getOutputWriteComm()
+    );
+#else
+    return std::make_unique<output::VolumeTrackingMatrix>(maxLabel);
+#endif
+}
+
+// start the reductions of the volume tracking matrix, then write the volume tracking matrix file
+// and append to the log file, and find the events if enabled
+// if given, the row count is taken from vv, of the same labels and started before, rather than
+// reduced again, and the events use its volumes
+static void startVTM(
+    std::shared_ptr<output::VolumeTrackingMatrix> vtm, const char* folder, const int& t_num,
+    const double& time, const std::shared_ptr<const output::VolumeVector>& vv = nullptr
+)
+{
+    std::function<void(output::VolumeTrackingMatrix&)> prepare;
+    if (vv && isWrittenDistributed()) {
+        // a distributed matrix starts collectives, so is only started once the volume vector has
+        // started all of its, after its row count is reduced
+        // otherwise the row count is found by the tree, so is not needed
+        prepare = [vv](output::VolumeTrackingMatrix& vtm) { vtm.setRowCount(vv->getRowCount()); };
+    }
+
+    const bool writeMatrix = (eventOutput != ELA_EVENTS_ONLY);
+    std::function<void(const output::VolumeTrackingMatrix&)> events;
+    if (eventOutput != ELA_EVENTS_OFF) {
+        events = [vv, detector = getEventDetector(folder),
+                  filename = getNameEventsFileName(folder), t_num, time,
+                  thresholds = eventThresholds](const output::VolumeTrackingMatrix& vtm) {
+            writeEvents(vtm, vv.get(), *detector, filename, t_num, time, thresholds);
+        };
+    }
+
+    if (useContainer) {
+        start(
+            vtm,
+            [container = getContainer(folder), t_num, time, encoding = matrixEncoding,
+             writeMatrix, events](output::VolumeTrackingMatrix& vtm) {
+                if (writeMatrix) vtm.writeToContainer(*container, t_num, time, encoding);
+                if (events) events(vtm);
+            },
+            true, prepare
+        );
+        return;
+    }
+
+    start(
+        vtm,
+        [filename = getNameVTMFileName(folder, t_num), logFilename = getNameVTMLogFileName(folder),
+         t_num, time, encoding = matrixEncoding, writeMatrix,
+         events](output::VolumeTrackingMatrix& vtm) {
+            if (writeMatrix) {
+                // write the volume tracking matrix file
+                vtm.write(filename.c_str(), encoding);
+
+                // append to the log file
+                vtm.writeToLog(logFilename.c_str(), t_num, time);
+            }
+            if (events) events(vtm);
+        },
+        !isWrittenDistributed(), prepare
+    );
+}
+
+// a log with the statistics of this processor, made global by finalize
+static std::unique_ptr<output::ASCIILog> createLog()
+{
+#ifdef ELA_USE_MPI
+    return std::make_unique<output::ASCIILog>(ela::dom->getOutputComm());
+#else
+    return std::make_unique<output::ASCIILog>();
+#endif
+}
+
+// start the reductions of the snapshots in the batch of the log, then write them
+static void startLog()
+{
+    start(
+        std::move(logBatch),
+        [filename = logFilename, times = logTimes](output::ASCIILog& log) {
+            log.write(filename.c_str(), times.data());
+        }
+    );
+    logTimes.clear();
+}
+
+// add a snapshot to the batch of the log
+static output::ASCIILog& addLogSnapshot(const char* folder, const double& time)
+{
+    // the batch is only written to one file
+    if (logBatch && getNameASCIILogFileName(folder) != logFilename) startLog();
+
+    if (logBatch) {
+        logBatch->startSnapshot();
+    }
+    else {
+        logBatch = createLog();
+    }
+    logTimes.push_back(time);
+    logFilename = getNameASCIILogFileName(folder);
+
+    return *logBatch;
+}
+
+// start the reductions of the log, if the batch is full
+static void startLogIfFull()
+{
+    if (static_cast<int>(logTimes.size()) >= logInterval) startLog();
+}
+
+// number of blocks the field is split into
+static int getBlockCount()
+{
+    return std::max(1, std::min(maxBlocks, ela::dom->n[blockDim]));
+}
+
+// block b of the field
+template <class T>
+static fields::Helper<T> getBlock(const fields::Helper<T>& field, const int& b)
+{
+    const auto& n = ela::dom->n;
+    const int count = getBlockCount();
+
+    int start[3] = {0, 0, 0};
+    int end[3] = {n[0], n[1], n[2]};
+    start[blockDim] = n[blockDim] * b / count;
+    end[blockDim] = n[blockDim] * (b + 1) / count;
+
+    return field.slice(start[0], end[0], start[1], end[1], start[2], end[2]);
+}
+
+// the outputs summed over one block of the field, with rows only for the labels in the block
+// there are rows of the volume tracking matrix for each ELA instance being output
+class Parts {
+  public:
+    // slot is shared by the blocks summed on one thread, see getSlots()
+    Parts(std::vector<int>& slot_in, const std::size_t& nn) : slot(&slot_in), vtm(nn)
+    {
+    }
+
+    Parts() = default;
+
+    // add to the volume of label l
+    void addVolume(const int& l, const output::Fp_BinType& volume)
+    {
+        vv[getSlot(l)] += volume;
+    }
+
+    // add to the row of label l of the volume tracking matrix of ELA instance n
+    void addSource(const std::size_t& n, const int& l, const double& dV, const svec::SVector& s)
+    {
+        vtm[n][getSlot(l)].add(s, dV);
+    }
+
+    // the log, null if not being output
+    std::unique_ptr<output::ASCIILog> log;
+
+    // add the rows to the outputs (those not null), leaving this empty
+    void merge(
+        output::VolumeVector* vvOut, const std::vector<output::VolumeTrackingMatrix*>& vtmOut,
+        output::ASCIILog* logOut
+    )
+    {
+        for (std::size_t i = 0; i < labels.size(); ++i) {
+            if (vvOut) vvOut->addCell(labels[i], vv[i]);
+            for (std::size_t n = 0; n < vtmOut.size(); ++n) {
+                vtmOut[n]->mergeRow(labels[i], vtm[n][i]);
+            }
+        }
+        if (logOut) logOut->merge(*log);
+        *this = Parts();
+    }
+
+    // reset the slots of the labels in the block, once it is summed
+    void releaseSlots()
+    {
+        for (const auto& l : labels) {
+            (*slot)[l] = -1;
+        }
+    }
+
+  private:
+    // the index of the row of each label, -1 if not in the block
+    int getSlot(const int& l)
+    {
+        auto& i = (*slot)[l];
+        if (i < 0) {
+            i = static_cast<int>(labels.size());
+            labels.push_back(l);
+            vv.push_back(0);
+            for (auto& rows : vtm) {
+                rows.emplace_back();
+            }
+        }
+        return i;
+    }
+
+    std::vector<int>* slot = nullptr;
+
+    // the labels in the block, and their rows
+    std::vector<int> labels;
+    std::vector<output::Fp_BinType> vv;
+    std::vector<std::vector<output::RowAccumulator>> vtm;
+};
+
+// the slots of each output thread, see Parts, grown to the largest label
+// every slot is reset once a block is summed, so they are kept between calls
+static std::vector<std::vector<int>> slots;
+
+// the slots of output thread t, for labels up to maxLabel
+static std::vector<int>& getSlots(const int& t, const int& maxLabel)
+{
+    auto& slot = slots[t];
+    if (static_cast<int>(slot.size()) <= maxLabel) slot.resize(maxLabel + 1, -1);
+    return slot;
+}
+
+// sum the outputs (those not null) over the field, sum(b, parts) adds the cells of block b
+// each block is summed separately, on the output threads, then merged in order
+// the cells are added to the last logSnapshots snapshots of the log
+template <class Sum>
+static void sumBlocks(
+    output::VolumeVector* vv, const std::vector<output::VolumeTrackingMatrix*>& vtm,
+    output::ASCIILog* log, const int& logSnapshots, const int& maxLabel, Sum sum
+)
+{
+    const int count = getBlockCount();
+
+    // sum block b, with the slots of the thread
+    auto sumBlock = [&](const int& b, std::vector<int>& slot) {
+        Parts parts(slot, vtm.size());
+        if (log) {
+            parts.log = createLog();
+            for (auto n = 1; n < logSnapshots; ++n) {
+                parts.log->startSnapshot();
+            }
+        }
+        sum(b, parts);
+        parts.releaseSlots();
+        return parts;
+    };
+
+    const int numThreads = std::min(threads, count);
+    if (static_cast<int>(slots.size()) < numThreads) slots.resize(numThreads);
+
+    if (threads <= 1) {
+        // only one block is needed at a time
+        auto& slot = getSlots(0, maxLabel);
+        for (auto b = 0; b < count; ++b) {
+            sumBlock(b, slot).merge(vv, vtm, log);
+        }
+        return;
+    }
+
+    std::vector<Parts> parts(count);
+
+    std::vector<std::thread> pool;
+    pool.reserve(numThreads);
+    for (auto t = 0; t < numThreads; ++t) {
+        pool.emplace_back([&parts, &sumBlock, maxLabel, numThreads, count, t]() {
+            auto& slot = getSlots(t, maxLabel);
+            for (auto b = t; b < count; b += numThreads) {
+                parts[b] = sumBlock(b, slot);
+            }
+        });
+    }
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    // in order, to be deterministic
+    for (auto& p : parts) {
+        p.merge(vv, vtm, log);
+    }
+}
+
+// sum the volume vector, volume tracking matrix, and log (those not null) over the field
+static void sumOutputs(
+    const int* labels, const double* vof_in, const double* dV_in, const int& num,
+    const int& maxLabel, output::VolumeVector* vv, output::VolumeTrackingMatrix* vtm,
+    output::ASCIILog* log
+)
+{
+    auto vofField = ela::wrapField<const double>(vof_in);
+    auto dVField = ela::wrapField<const double>(dV_in);
+    auto labelField = ela::wrapField<const int>(labels);
+    auto& sField = ela::dom->s[num];
+
+    // do the integration locally, for everything at once
+    std::vector<output::VolumeTrackingMatrix*> vtmPtrs;
+    if (vtm) vtmPtrs.push_back(vtm);
+
+    sumBlocks(vv, vtmPtrs, log, 1, maxLabel, [&](const int& b, Parts& parts) {
+        auto f = getBlock(vofField, b).begin();
+        auto dV = getBlock(dVField, b).begin();
+        auto s = getBlock<svec::SVector>(sField, b).begin();
+        for (auto l : getBlock(labelField, b)) {
+            if (l != 0) {
+                if (*f != 1) parts.addVolume(l, (1 - *f) * (*dV));
+                parts.addSource(0, l, (*dV), (*s));
+            }
+            if (parts.log) parts.log->addCell(*s, *dV, 1.0 - *f);
+            ++f;
+            ++dV;
+            ++s;
+        }
+    });
+}
+
+// the largest label on this processor
+static int getMaxLabel(const int* labels)
+{
+    auto labelField = ela::wrapField<const int>(labels);
+    return *std::max_element(labelField.begin(), labelField.end());
+}
+
 void ELA_Output(
     const int* labels, const double* vof_in, const double* dV_in, const int& num, const int& t_num,
     const double& time, const char* folder, const bool& write_log
 )
 {
-    ELA_OutputWriteV(vof_in, labels, dV_in, t_num, folder);
-    ELA_OutputWriteVTM(labels, dV_in, num, t_num, time, folder);
-    if(write_log) {
-        ELA_OutputLog(vof_in, dV_in, num, time, folder);
+    continuePending();
+
+    // calculate the number of rows (i=1..max(label)), made global by finalize
+    int maxLabel = getMaxLabel(labels);
+
+    std::shared_ptr<output::VolumeVector> vv = createVV(maxLabel);
+    auto vtm = createVTM(maxLabel);
+    output::ASCIILog* const log = (write_log ? &addLogSnapshot(folder, time) : nullptr);
+
+    sumOutputs(labels, vof_in, dV_in, num, maxLabel, vv.get(), vtm.get(), log);
+
+    // the reductions are started together, in this order, as each only starts its collectives
+    // once those before it have started theirs: the log has one, the volume vector reduces the row
+    // count first, and the matrix only needs the row count if distributed
+    if (log) startLogIfFull();
+    startVV(vv, {folder}, t_num, time);
+    startVTM(std::move(vtm), folder, t_num, time, vv);
+
+    finish();
+}
+
+void ELA_OutputAll(
+    const int* labels, const double* vof_in, const double* dV_in, const int& t_num,
+    const double& time, const char* const* folders, const bool& write_log
+)
+{
+    auto vofField = ela::wrapField<const double>(vof_in);
+    auto dVField = ela::wrapField<const double>(dV_in);
+    auto labelField = ela::wrapField<const int>(labels);
+    const int nn = ela::dom->nn;
+
+    continuePending();
+
+    // calculate the number of rows (i=1..max(label)), made global by finalize
+    // the labels are shared, so this is the same for every ELA instance
+    int maxLabel = getMaxLabel(labels);
+
+    // the volume vector does not depend on the ELA instance, so is only summed once
+    std::shared_ptr<output::VolumeVector> vv = createVV(maxLabel);
+    std::vector<std::unique_ptr<output::VolumeTrackingMatrix>> vtm;
+    std::vector<output::VolumeTrackingMatrix*> vtmPtrs;
+    for (auto n = 0; n < nn; ++n) {
+        vtm.push_back(createVTM(maxLabel));
+        vtmPtrs.push_back(vtm.back().get());
+    }
+
+    // a snapshot of the log for each ELA instance, reduced together
+    std::unique_ptr<output::ASCIILog> log;
+    if (write_log) {
+        log = createLog();
+        for (auto n = 1; n < nn; ++n) {
+            log->startSnapshot();
+        }
+    }
+
+    // do the integration locally, for every ELA instance at once
+    sumBlocks(vv.get(), vtmPtrs, log.get(), nn, maxLabel, [&](const int& b, Parts& parts) {
+        std::vector<fields::Helper<svec::SVector>::forward_Iterator> s;
+        for (auto n = 0; n < nn; ++n) {
+            s.push_back(getBlock<svec::SVector>(ela::dom->s[n], b).begin());
+        }
+
+        auto f = getBlock(vofField, b).begin();
+        auto dV = getBlock(dVField, b).begin();
+        for (auto l : getBlock(labelField, b)) {
+            if (l != 0 && *f != 1) parts.addVolume(l, (1 - *f) * (*dV));
+            for (auto n = 0; n < nn; ++n) {
+                if (l != 0) parts.addSource(n, l, (*dV), (*s[n]));
+                if (parts.log) parts.log->addCell(n, *s[n], *dV, 1.0 - *f);
+                ++s[n];
+            }
+            ++f;
+            ++dV;
+        }
+    });
+
+    // the reductions of every ELA instance are started together, in the order of ELA_Output()
+    // the trees of the matrices have no collectives, so all are started at once, and when
+    // distributed, each matrix starts its exchange once the one before has started its own
+    if (log) {
+        std::vector<std::string> filenames;
+        for (auto n = 0; n < nn; ++n) {
+            filenames.push_back(getNameASCIILogFileName(folders[n]));
+        }
+        start(std::move(log), [filenames, time](output::ASCIILog& log) {
+            for (std::size_t n = 0; n < filenames.size(); ++n) {
+                log.writeSnapshot(filenames[n].c_str(), n, time);
+            }
+        });
+    }
+    startVV(vv, std::vector<const char*>(folders, folders + nn), t_num, time);
+    for (auto n = 0; n < nn; ++n) {
+        startVTM(std::move(vtm[n]), folders[n], t_num, time, vv);
     }
+
+    finish();
 }
 
-void ELA_OutputWriteV(
-    const double* vof_in, const int* labels, const double* dV_in, const int& t_num,
-    const char* folder
+// the volume vector of this processor, summed over the field
+static std::unique_ptr<output::VolumeVector> sumVV(
+    const double* vof_in, const int* labels, const double* dV_in
 )
 {
     auto vofField = ela::wrapField<const double>(vof_in);
     auto dVField = ela::wrapField<const double>(dV_in);
     auto labelField = ela::wrapField<const int>(labels);
 
-    // calculate the number of rows (i=1..max(label))
-    int maxLabel = ela::dom->getMax<int>(*std::max_element(labelField.begin(), labelField.end()));
+    // calculate the number of rows (i=1..max(label)), made global by finalize
+    int maxLabel = *std::max_element(labelField.begin(), labelField.end());
 
     // initialize the volume vector
-#ifdef ELA_USE_MPI
-    output::VolumeVector vv = output::VolumeVector(maxLabel, ela::dom->getMPIComm());
-#else
-    output::VolumeVector vv = output::VolumeVector(maxLabel);
-#endif
+    auto vv = createVV(maxLabel);
 
     // do the integration locally
-    auto f = vofField.begin();
-    auto dV = dVField.begin();
-    for (auto l : labelField) {
-        if (l != 0 && *f != 1) vv.addCell(l, (1 - *f) * (*dV));
-        ++f;
-        ++dV;
-    }
-
-    // finalize the volume vector for writing
-    vv.finalize();
+    sumBlocks(vv.get(), {}, nullptr, 1, maxLabel, [&](const int& b, Parts& parts) {
+        auto f = getBlock(vofField, b).begin();
+        auto dV = getBlock(dVField, b).begin();
+        for (auto l : getBlock(labelField, b)) {
+            if (l != 0 && *f != 1) parts.addVolume(l, (1 - *f) * (*dV));
+            ++f;
+            ++dV;
+        }
+    });
 
-    // write the volume vector file
-    vv.write(getNameVVFileName(folder, t_num).c_str());
+    return vv;
 }
 
-void ELA_OutputWriteVTM(
-    const int* labels, const double* dV_in, const int& num, const int& t_num, const double& time,
+void ELA_OutputWriteV(
+    const double* vof_in, const int* labels, const double* dV_in, const int& t_num,
     const char* folder
 )
+{
+    continuePending();
+
+    auto vv = sumVV(vof_in, labels, dV_in);
+
+    // finalize the volume vector and write the volume vector file, the time is not known
+    startVV(std::move(vv), {folder}, t_num, std::numeric_limits<double>::quiet_NaN());
+    finish();
+}
+
+// the volume tracking matrix of this processor, summed over the field
+static std::unique_ptr<output::VolumeTrackingMatrix> sumVTM(
+    const int* labels, const double* dV_in, const int& num, const bool& dist
+)
 {
     auto dVField = ela::wrapField<const double>(dV_in);
     auto labelField = ela::wrapField<const int>(labels);
     auto& sField = ela::dom->s[num];
 
-    // calculate the number of rows (i=1..max(label))
-    int maxLabel = ela::dom->getMax<int>(*std::max_element(labelField.begin(), labelField.end()));
+    // calculate the number of rows (i=1..max(label)), made global by finalize
+    int maxLabel = *std::max_element(labelField.begin(), labelField.end());
 
     // initialize the volume tracking matrix
-#ifdef ELA_USE_MPI
-    output::VolumeTrackingMatrix vtm =
-        output::VolumeTrackingMatrix(maxLabel, ela::dom->getMPIComm());
-#else
-    output::VolumeTrackingMatrix vtm = output::VolumeTrackingMatrix(maxLabel);
-#endif
+    auto vtm = createVTM(maxLabel, dist);
 
     // do the integration locally
-    auto dV = dVField.begin();
-    auto s = sField.begin();
-    for (auto l : labelField) {
-        if (l != 0) vtm.addCell(l, (*dV), (*s));
-        ++s;
-        ++dV;
-    }
+    sumBlocks(nullptr, {vtm.get()}, nullptr, 1, maxLabel, [&](const int& b, Parts& parts) {
+        auto dV = getBlock(dVField, b).begin();
+        auto s = getBlock<svec::SVector>(sField, b).begin();
+        for (auto l : getBlock(labelField, b)) {
+            if (l != 0) parts.addSource(0, l, (*dV), (*s));
+            ++s;
+            ++dV;
+        }
+    });
+
+    return vtm;
+}
+
+void ELA_OutputWriteVTM(
+    const int* labels, const double* dV_in, const int& num, const int& t_num, const double& time,
+    const char* folder
+)
+{
+    continuePending();
+
+    auto vtm = sumVTM(labels, dV_in, num, isWrittenDistributed());
 
     // finalize the volume volume tracking matrix for writing
-    vtm.finalize();
+    startVTM(std::move(vtm), folder, t_num, time);
+    finish();
+}
+
+void ELA_OutputGetVTM(
+    const int* labels, const double* dV_in, const int& num, int* first_row, int* rc, int* nnz,
+    const uint32_t** row_index, const uint32_t** column_index, const double** values
+)
+{
+    continuePending();
+
+    auto vtm = sumVTM(labels, dV_in, num, distributed);
+
+    // wait for the reductions, after any outputs started before
+    start(
+        std::move(vtm),
+        [](output::VolumeTrackingMatrix& vtm) {
+            vtm.getRows(vtmFirstRow, vtmRowIndex, vtmColumnIndex, vtmValues);
+        },
+        false
+    );
+    completePending();
+
+    if (first_row) *first_row = vtmFirstRow;
+    if (rc) *rc = static_cast<int>(vtmRowIndex.size() - 1);
+    if (nnz) *nnz = static_cast<int>(vtmValues.size());
+    if (row_index) *row_index = vtmRowIndex.data();
+    if (column_index) *column_index = vtmColumnIndex.data();
+    if (values) *values = vtmValues.data();
+}
+
+void ELA_OutputCopyVTM(uint32_t* row_index, uint32_t* column_index, double* values)
+{
+    std::copy(vtmRowIndex.begin(), vtmRowIndex.end(), row_index);
+    std::copy(vtmColumnIndex.begin(), vtmColumnIndex.end(), column_index);
+    std::copy(vtmValues.begin(), vtmValues.end(), values);
+}
+
+void ELA_OutputGetV(
+    const double* vof_in, const int* labels, const double* dV_in, int* rc, const double** values
+)
+{
+    continuePending();
+
+    auto vv = sumVV(vof_in, labels, dV_in);
 
-    // write the volume vector file
-    vtm.write(getNameVTMFileName(folder, t_num).c_str());
+    // wait for the reductions, after any outputs started before
+    start(
+        std::move(vv), [](output::VolumeVector& vv) { vv.getValues(vvValues); }, false
+    );
+    completePending();
+
+    if (rc) *rc = static_cast<int>(vvValues.size());
+    if (values) *values = vvValues.data();
+}
 
-    // append to the log file
-    vtm.writeToLog(getNameVTMLogFileName(folder).c_str(), t_num, time);
+void ELA_OutputCopyV(double* values)
+{
+    std::copy(vvValues.begin(), vvValues.end(), values);
 }
 
 void ELA_OutputLog(
@@ -137,11 +938,9 @@ void ELA_OutputLog(
     auto dVField = ela::wrapField<const double>(dV_in);
     auto& sField = ela::dom->s[num];
 
-#ifdef ELA_USE_MPI
-    output::ASCIILog log = output::ASCIILog(ela::dom->getMPIComm());
-#else
-    output::ASCIILog log = output::ASCIILog();
-#endif
+    continuePending();
+
+    auto& log = addLogSnapshot(folder, time);
 
     auto dV = dVField.begin();
     auto f = vofField.begin();
@@ -149,7 +948,108 @@ void ELA_OutputLog(
         log.addCell(s, *(dV++), 1.0 - *(f++));
     }
 
-    log.finalize();
+    startLogIfFull();
+    finish();
+}
+
+void ELA_SetOutputAsync(const int& async_in)
+{
+    async = (async_in != 0);
+}
+
+void ELA_SetOutputDistributed(const int& distributed_in)
+{
+    if (distributed_in != 0 && useContainer) {
+        throw std::invalid_argument("Distributed output can not be written to a container");
+    }
+    distributed = (distributed_in != 0);
+}
 
-    log.write(getNameASCIILogFileName(folder).c_str(), time);
+void ELA_SetOutputLogInterval(const int& interval)
+{
+    if (interval < 1) {
+        throw std::invalid_argument("Log interval must be at least 1");
+    }
+    logInterval = interval;
+}
+
+void ELA_SetOutputMatrixEncoding(const int& encoding)
+{
+    if (encoding < ELA_MATRIX_ENCODING_PLAIN || encoding > ELA_MATRIX_ENCODING_COMPACT_SHUFFLED) {
+        throw std::invalid_argument("Unknown matrix encoding");
+    }
+    matrixEncoding = static_cast<output::MatrixEncoding>(encoding);
+}
+
+void ELA_SetOutputContainer(const int& container)
+{
+    if (container != 0 && distributed) {
+        throw std::invalid_argument("Distributed output can not be written to a container");
+    }
+    useContainer = (container != 0);
+}
+
+void ELA_SetOutputEvents(const int& events)
+{
+    if (events < ELA_EVENTS_OFF || events > ELA_EVENTS_ONLY) {
+        throw std::invalid_argument("Unknown event output");
+    }
+    eventOutput = events;
+}
+
+void ELA_SetOutputEventThresholds(const double& min_volume, const double& min_fraction)
+{
+    if (min_volume < 0) {
+        throw std::invalid_argument("Event volume threshold must not be negative");
+    }
+    if (min_fraction < 0 || min_fraction > 1) {
+        throw std::invalid_argument("Event fraction threshold must be between 0 and 1");
+    }
+    eventThresholds.minVolume = min_volume;
+    eventThresholds.minFraction = min_fraction;
+}
+
+void ELA_SetOutputThreads(const int& threads_in)
+{
+    if (threads_in < 1) {
+        throw std::invalid_argument("Number of output threads must be positive");
+    }
+    threads = threads_in;
+}
+
+void ELA_SetOutputBackground(const int& maxQueued)
+{
+    if (maxQueued < 0) {
+        throw std::invalid_argument("Background output queue length must not be negative");
+    }
+
+    // anything queued is written first, and any error writing it is thrown
+    if (writer) writer->wait();
+    writer.reset();
+    if (maxQueued > 0) writer = std::make_unique<output::BackgroundWriter>(maxQueued);
+}
+
+int ELA_OutputPending()
+{
+    return static_cast<int>(pending.size());
+}
+
+void ela::resetOutput()
+{
+    detectors.clear();
+}
+
+void ELA_OutputFlush()
+{
+    if (logBatch) startLog();
+
+    completePending();
+
+    if (writer) writer->wait();
+
+    // close the containers
+    for (auto& container : containers) {
+        container.second->close();
+    }
+    containers.clear();
 }
@@ -2,6 +2,7 @@
 #define ELA_OUTPUT_H
 
 #include <ELA.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +18,11 @@ extern "C" {
 
 /**
  * @brief Has the same effect as calling `ELA_OutputWriteV()`, `ELA_OutputWriteVTM()`, and (if \p write_log is true) `ELA_OutputLog()`
+ *
+ * The fields are only traversed once, and the reductions between processors are started together,
+ * once those of any output requested before have started. The row count is only reduced once, by
+ * the volume vector. A distributed volume tracking matrix (see `ELA_SetOutputDistributed()`) needs
+ * it to split the rows, so starts exchanging them once it is reduced.
  * 
  * @see  [Volume Vector](OutputFiles.html#volumevector), [Volume Tracking Matrix](OutputFiles.html#volumetrackingmatrix), and
  * [timelog.bin](OutputFiles.html#timelogbin)
@@ -41,6 +47,41 @@ void ELA_Output(
     const char* folder, const bool& write_log=true
 );
 
+/**
+ * @brief Has the same effect as calling `ELA_Output()` for every ELA instance, each with its own
+ * folder
+ *
+ * The shared fields are only traversed once, for every ELA instance at once. As it does not
+ * depend on the ELA instance, the volume vector is only summed and reduced once, then written to
+ * every folder. The statistics of the log of every ELA instance are reduced with a single
+ * reduction. The reductions are started together, as for `ELA_Output()`, and the volume tracking
+ * matrices summed onto the first processor are all summed at once. When distributed (see
+ * `ELA_SetOutputDistributed()`), each matrix starts exchanging its rows once the one before has
+ * started its own, as the exchanges are collective.
+ *
+ * The log is reduced and written by this call, so the interval of `ELA_SetOutputLogInterval()`
+ * does not apply.
+ *
+ * @warning It is assumed the \p folders exist
+ *
+ * @note Must be called on all processors.
+ *
+ * @param labels The label feild
+ * @param f The volume fraction \f$ f \f$
+ * @param dV Cell volume \f$ \Delta \Omega \f$
+ * @param t_num The snapshot index \f$ n \f$
+ * @param time The snapshot time \f$ t^{n} \f$
+ * @param folders The folder of each ELA instance, one for each given to `ELA_Init()`
+ * @param write_log Whether or not to append to the log file of each ELA instance
+ *
+ * @note When calling from Fortran, \p folders is a `character(len=folder_len)` array, each
+ * terminated with `C_NULL_CHAR`, followed by `folder_len`, and \p write_log is an integer
+ */
+void ELA_OutputAll(
+    const int* labels, const double* f, const double* dV, const int& t_num, const double& time,
+    const char* const* folders, const bool& write_log = true
+);
+
 /**
  * @brief Calculate the volume vector (@cite Gaylo2022, Eq. 8)
  *
@@ -122,6 +163,275 @@ void ELA_OutputLog(
     const double* f, const double* dV, const int& num, const double& time, const char* folder
 );
 
+/**
+ * @brief Calculate the volume tracking matrix, as `ELA_OutputWriteVTM()`, without writing a file
+ *
+ * The matrix is returned in CSR format, in buffers held by the library until the next call.
+ * Unless `ELA_SetOutputDistributed()` is enabled, the whole matrix is returned on the root
+ * processor and the others get no rows. When distributed, each processor gets its contiguous
+ * range of rows, starting at \p first_row.
+ *
+ * The reductions are always completed before returning, after those of any output started
+ * asynchronously. Any of the outputs may be null.
+ *
+ * @note Must be called on all processors.
+ *
+ * @param labels The label feild
+ * @param dV Cell volume \f$ \Delta \Omega \f$
+ * @param num The ELA instance
+ * @param[out] first_row The row of the matrix that is the first row returned (from 0)
+ * @param[out] rc The number of rows returned
+ * @param[out] nnz The number of non-zeros returned
+ * @param[out] row_index The row index, with the starting zero (\p rc + 1 values)
+ * @param[out] column_index The column indices (\p nnz values)
+ * @param[out] values The values (\p nnz values)
+ */
+void ELA_OutputGetVTM(
+    const int* labels, const double* dV, const int& num, int* first_row, int* rc, int* nnz,
+    const uint32_t** row_index, const uint32_t** column_index, const double** values
+);
+
+/**
+ * @brief Copy the matrix of the last call to `ELA_OutputGetVTM()` into the given buffers
+ *
+ * @param[out] row_index At least `rc+1` values
+ * @param[out] column_index At least `nnz` values
+ * @param[out] values At least `nnz` values
+ */
+void ELA_OutputCopyVTM(uint32_t* row_index, uint32_t* column_index, double* values);
+
+/**
+ * @brief Calculate the volume vector, as `ELA_OutputWriteV()`, without writing a file
+ *
+ * The volume vector is returned in a buffer held by the library until the next call. It is only
+ * returned on the root processor, the others get no values.
+ *
+ * The reductions are always completed before returning, after those of any output started
+ * asynchronously. Any of the outputs may be null.
+ *
+ * @note Must be called on all processors.
+ *
+ * @param f The volume fraction \f$ f \f$
+ * @param labels The label feild
+ * @param dV Cell volume \f$ \Delta \Omega \f$
+ * @param[out] rc The row count \f$ M^{n} \f$, or zero if not root
+ * @param[out] values The volume of each label (\p rc values)
+ */
+void ELA_OutputGetV(
+    const double* f, const int* labels, const double* dV, int* rc, const double** values
+);
+
+/**
+ * @brief Copy the volume vector of the last call to `ELA_OutputGetV()` into the given buffer
+ *
+ * @param[out] values At least `rc` values
+ */
+void ELA_OutputCopyV(double* values);
+
+/**
+ * @brief Whether output is written asynchronously
+ *
+ * When enabled (\p async non-zero), the functions in this file do the integration locally and
+ * start the reductions between processors with non-blocking collectives, but return without
+ * waiting for them. The reductions of every pending output continue at each later call to a
+ * function in this file, as far as they can without waiting, and the files are written once they
+ * are complete. Use `ELA_OutputPending()` to see how many are left, and `ELA_OutputFlush()` to wait
+ * for all of them, e.g., before reading the files or calling `ELA_DeInit()`.
+ *
+ * Outputs are still written in the order they were requested, and each only starts a collective
+ * once those requested before it have started theirs. A distributed volume tracking matrix (see
+ * `ELA_SetOutputDistributed()`) is written collectively, so the call after it was requested waits
+ * for it.
+ *
+ * @note Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param async Non-zero to enable, zero (the default) to disable
+ */
+void ELA_SetOutputAsync(const int& async);
+
+/**
+ * @brief Whether the volume tracking matrix is assembled and written in parallel
+ *
+ * By default, `ELA_OutputWriteVTM()` sums the rows of the matrix onto one processor, which
+ * writes the file. When enabled (\p distributed non-zero), the rows are split into a contiguous
+ * range for each processor instead. Each processor sums the rows it owns, then all write their
+ * part of the same file with MPI-IO. The file is identical, but no processor holds the whole
+ * matrix.
+ *
+ * @note Has no effect unless built with `ELA_USE_MPI=on`.
+ *
+ * @param distributed Non-zero to enable, zero (the default) to disable
+ */
+void ELA_SetOutputDistributed(const int& distributed);
+
+/**
+ * @brief Number of calls to `ELA_OutputLog()` whose statistics are reduced and written together
+ *
+ * With an \p interval of \f$k\f$, `ELA_OutputLog()` only calculates the statistics locally,
+ * and every \f$k\f$-th call reduces the statistics of the last \f$k\f$ calls at once and writes
+ * a line for each. `ELA_OutputFlush()` writes any left over, as does a call with another folder.
+ *
+ * @param interval The number of calls, at least 1 (the default)
+ */
+void ELA_SetOutputLogInterval(const int& interval);
+
+/**
+ * @brief Formats of the volume tracking matrix file, see ELA_SetOutputMatrixEncoding()
+ *
+ */
+enum ELA_MatrixEncoding
+{
+    /** Version 1 format, uncompressed CSR (default) */
+    ELA_MATRIX_ENCODING_PLAIN = 0,
+    /** Version 2 format, indices are delta and varint encoded */
+    ELA_MATRIX_ENCODING_COMPACT = 1,
+    /** Version 2 format, with the values also byte-shuffled and run-length encoded (lossless) */
+    ELA_MATRIX_ENCODING_COMPACT_SHUFFLED = 2
+};
+
+/**
+ * @brief Set the format of the volume tracking matrix files written by `ELA_OutputWriteVTM()`
+ *
+ * The version 2 formats start with a version tag, and can be converted back to the version 1
+ * format with the `ela_decode` tool. Matrices written with `ELA_SetOutputDistributed()` are
+ * always in the version 1 format.
+ *
+ * @see [Volume Tracking Matrix](OutputFiles.html#volumetrackingmatrix)
+ *
+ * @param encoding One of \ref ELA_MatrixEncoding
+ */
+void ELA_SetOutputMatrixEncoding(const int& encoding);
+
+/**
+ * @brief Whether snapshots are appended to a single container rather than a file each
+ *
+ * When enabled (\p container non-zero), `ELA_OutputWriteVTM()` and `ELA_OutputWriteV()` append
+ * each snapshot to `tracking.dat` in the folder, and an entry with the snapshot index, time, row
+ * count, and NNZ to the index `tracking.idx`, which replaces `timelog.bin`. The files are opened
+ * by the first snapshot and kept open until `ELA_OutputFlush()`, so there are no file opens
+ * per snapshot. The snapshots are read with output::ContainerReader.
+ *
+ * This can not be combined with `ELA_SetOutputDistributed()`.
+ *
+ * @param container Non-zero to enable, zero (the default) to disable
+ */
+void ELA_SetOutputContainer(const int& container);
+
+/**
+ * @brief Set the number of threads used to sum the outputs over the field
+ *
+ * The field is always split into the same blocks (slabs along the slowest index), which depend
+ * only on the size of the domain. Each block is summed separately, on one of the \p threads, and
+ * the blocks are then added in order. So the output is identical for any number of threads. Each
+ * block only holds the rows of the labels in it, until it is added.
+ *
+ * @param threads The number of threads, `1` (default) to use only the calling thread
+ */
+void ELA_SetOutputThreads(const int& threads);
+
+/**
+ * @brief Whether output files are written on a background thread
+ *
+ * When enabled (\p maxQueued positive), once the reductions of an output are complete the file
+ * is written by a background thread, in order, so the calling thread does not wait on the file
+ * system. At most \p maxQueued outputs wait to be written, which bounds the memory held. Beyond
+ * that, the calling thread waits for the oldest to start. Use `ELA_OutputFlush()` to wait for all
+ * files to be written.
+ *
+ * Volume tracking matrices assembled with `ELA_SetOutputDistributed()` are still written on the
+ * calling thread, as all processors take part.
+ *
+ * Any files already queued are written before the setting changes, and an error writing them is
+ * thrown here, as by `ELA_OutputFlush()`.
+ *
+ * @param maxQueued The most outputs waiting to be written, zero (the default) to disable
+ */
+void ELA_SetOutputBackground(const int& maxQueued);
+
+/**
+ * @brief Whether events are found from the volume tracking matrices, see ELA_SetOutputEvents()
+ *
+ */
+enum ELA_EventOutput
+{
+    /** Only the volume tracking matrices are written (default) */
+    ELA_EVENTS_OFF = 0,
+    /** The events are appended to the event log as well as the matrices written */
+    ELA_EVENTS_WITH_MATRIX = 1,
+    /** The events are appended to the event log, and the matrices are not written */
+    ELA_EVENTS_ONLY = 2
+};
+
+/**
+ * @brief Whether the coalescence and breakup events are found from each volume tracking matrix
+ *
+ * When enabled, once the reductions of the matrix of `ELA_OutputWriteVTM()`, `ELA_Output()`, or
+ * `ELA_OutputAll()` are complete, the links between blobs (the entries of
+ * \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$ above the thresholds set by
+ * `ELA_SetOutputEventThresholds()`) are classified into events, and appended to the event log of
+ * the folder:
+ * - a merge, when a blob at \f$n\f$ has links to two or more blobs at \f$n-1\f$,
+ * - a split, when a blob at \f$n-1\f$ has links to two or more blobs at \f$n\f$,
+ * - a birth, when a blob at \f$n\f$ has no links, and
+ * - a death, when a blob at \f$n-1\f$ has no links (not found for the first matrix of a folder).
+ *
+ * With \ref ELA_EVENTS_ONLY the matrix file (and its entry in `timelog.bin` or the container) is
+ * not written, so events can be found every snapshot without storing every matrix.
+ *
+ * The volume of each blob is from the volume vector of `ELA_Output()` and `ELA_OutputAll()`, and
+ * is kept until the next matrix of the folder to find the deaths, or until `ELA_DeInit()`.
+ * `ELA_OutputWriteVTM()` has no volume vector, so the sum of the row of each blob is used
+ * instead, and births are only found if that is above the volume threshold.
+ *
+ * The events are found on the first processor, so the matrices are not distributed (see
+ * `ELA_SetOutputDistributed()`) while enabled.
+ *
+ * @see  [events.bin](OutputFiles.html#eventsbin)
+ *
+ * @param events One of \ref ELA_EventOutput
+ */
+void ELA_SetOutputEvents(const int& events);
+
+/**
+ * @brief Which entries of the volume tracking matrix are links between blobs for
+ * `ELA_SetOutputEvents()`
+ *
+ * An entry \f$q_{ml}\f$ is a link if it is at least \p min_volume, and at least \p min_fraction
+ * of the smaller of its row and column sums (the volume tracked into blob \f$m\f$ and out of blob
+ * \f$l\f$). Blobs of volume at most \p min_volume are never born or die.
+ *
+ * @param min_volume The least volume of a link, zero (the default) for any
+ * @param min_fraction The least fraction of a link, in \f$[0,1]\f$, zero (the default) for any
+ */
+void ELA_SetOutputEventThresholds(const double& min_volume, const double& min_fraction);
+
+/**
+ * @brief The number of outputs requested whose reductions are not yet complete, or that are not
+ * yet written
+ *
+ * Once complete, an output is written, or queued for the background thread (see
+ * `ELA_SetOutputBackground()`), and is no longer counted. Unless `ELA_SetOutputAsync()` is
+ * enabled, this is always zero between calls. Snapshots of the log left in a batch (see
+ * `ELA_SetOutputLogInterval()`) are not counted until it is full.
+ *
+ * @return int The number of outputs
+ *
+ * @note For calling from Fortran, use `ELA_OutputPending(out)` where \p out is the return value
+ */
+int ELA_OutputPending();
+
+/**
+ * @brief Complete and write any output started asynchronously, left in a batch, or queued for the
+ * background thread
+ *
+ * When this returns, all files are written, and any containers are closed.
+ *
+ * @see ELA_SetOutputAsync(), ELA_SetOutputLogInterval(), and ELA_SetOutputBackground()
+ *
+ * @note Must be called on all processors.
+ */
+void ELA_OutputFlush();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,109 @@
+#include "ELA_Reader.h"
+#include "reader/trackingdata.h"
+
+#include <exception>
+#include <string>
+
+struct ELA_Reader {
+    reader::TrackingData data;
+};
+
+struct ELA_Matrix {
+    reader::Matrix matrix;
+};
+
+struct ELA_Vector {
+    reader::Vector vector;
+};
+
+// the error of the last call that failed
+static thread_local std::string lastError;
+
+// call f, returning the status of the C API
+template <class F>
+static int handleErrors(F f)
+{
+    try {
+        f();
+    }
+    catch (const std::exception& e) {
+        lastError = e.what();
+        return 1;
+    }
+    return 0;
+}
+
+int ELA_ReaderOpen(const char* folder, ELA_Reader** reader)
+{
+    return handleErrors([&]() { *reader = new ELA_Reader{reader::TrackingData(folder)}; });
+}
+
+void ELA_ReaderClose(ELA_Reader* reader)
+{
+    delete reader;
+}
+
+size_t ELA_ReaderGetSnapshotCount(const ELA_Reader* reader)
+{
+    return reader->data.getSnapshots().size();
+}
+
+int ELA_ReaderGetSnapshot(const ELA_Reader* reader, size_t i, ELA_SnapshotInfo* info)
+{
+    return handleErrors([&]() {
+        const auto& snapshot = reader->data.getSnapshots().at(i);
+        *info = ELA_SnapshotInfo{snapshot.t_num, snapshot.rc, snapshot.time};
+    });
+}
+
+int ELA_ReaderGetVTM(const ELA_Reader* reader, int t_num, ELA_Matrix** matrix)
+{
+    return handleErrors([&]() {
+        *matrix = new ELA_Matrix{reader->data.getTrackingMatrix(t_num)};
+    });
+}
+
+int ELA_ReaderGetV(const ELA_Reader* reader, int t_num, ELA_Vector** vector)
+{
+    return handleErrors([&]() {
+        *vector = new ELA_Vector{reader->data.getVolumeVector(t_num)};
+    });
+}
+
+int ELA_ReaderCompose(
+    const ELA_Reader* reader, int from, int to, int normalize, double drop_tolerance,
+    ELA_Matrix** product
+)
+{
+    return handleErrors([&]() {
+        *product =
+            new ELA_Matrix{reader->data.compose(from, to, normalize != 0, drop_tolerance)};
+    });
+}
+
+void ELA_MatrixGetView(const ELA_Matrix* matrix, ELA_MatrixView* view)
+{
+    const auto& v = matrix->matrix.view();
+    *view = ELA_MatrixView{v.rc, v.nnz, v.rowEnd, v.columnIndex, v.values};
+}
+
+void ELA_MatrixFree(ELA_Matrix* matrix)
+{
+    delete matrix;
+}
+
+void ELA_VectorGetValues(const ELA_Vector* vector, uint32_t* rc, const double** values)
+{
+    *rc = vector->vector.size();
+    *values = vector->vector.data();
+}
+
+void ELA_VectorFree(ELA_Vector* vector)
+{
+    delete vector;
+}
+
+const char* ELA_ReaderGetError(void)
+{
+    return lastError.c_str();
+}
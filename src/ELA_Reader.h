@@ -0,0 +1,158 @@
+#ifndef ELA_READER_H
+#define ELA_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Provides functions to read the files written by ELA_Output.h, for post-processing
+ *
+ * These are in the separate `flexELA_reader` library, which does not need MPI to be initialized.
+ * The files are mapped into memory rather than read, so the arrays of a volume tracking matrix or
+ * volume vector point into the file where possible (see `reader::Matrix`).
+ *
+ * Each function returns `0` on success. Otherwise, it returns non-zero and the error is given by
+ * `ELA_ReaderGetError()`.
+ *
+ * For more information on the formating of these files, see [Output Files](OutputFiles.html).
+ *
+ * @file
+ */
+
+/** @brief The output written to a folder */
+typedef struct ELA_Reader ELA_Reader;
+
+/** @brief A volume tracking matrix, or a product of them */
+typedef struct ELA_Matrix ELA_Matrix;
+
+/** @brief A volume vector */
+typedef struct ELA_Vector ELA_Vector;
+
+/** @brief A snapshot with a volume tracking matrix */
+typedef struct {
+    /** @brief The snapshot index \f$ n \f$ */
+    int t_num;
+
+    /** @brief The row count \f$ M^{n} \f$ */
+    uint32_t rc;
+
+    /** @brief The snapshot time \f$ t^{n} \f$ */
+    double time;
+} ELA_SnapshotInfo;
+
+/**
+ * @brief The arrays of a matrix in CSR format
+ *
+ * As in the [file](OutputFiles.html#volumetrackingmatrix), the zero that formally starts
+ * `row_index` is omitted. Row `i` is label `i+1`, while the column indices are the labels.
+ */
+typedef struct {
+    /** @brief The row count */
+    uint32_t rc;
+
+    /** @brief The number of non-zeros */
+    uint32_t nnz;
+
+    /** @brief The end of each row (RC values) */
+    const uint32_t* row_index;
+
+    /** @brief The column indices (NNZ values) */
+    const uint32_t* column_index;
+
+    /** @brief The values (NNZ values) */
+    const double* values;
+} ELA_MatrixView;
+
+/**
+ * @brief Open the output written to \p folder
+ *
+ * Only the list of snapshots is read, the rest of the files are read when asked for.
+ *
+ * @param folder The folder passed to `ELA_OutputWriteVTM()`, etc.
+ * @param[out] reader Set to the opened output, free with `ELA_ReaderClose()`
+ */
+int ELA_ReaderOpen(const char* folder, ELA_Reader** reader);
+
+/** @brief Free \p reader, matrices and vectors read from it stay valid */
+void ELA_ReaderClose(ELA_Reader* reader);
+
+/** @brief The number of snapshots with a volume tracking matrix */
+size_t ELA_ReaderGetSnapshotCount(const ELA_Reader* reader);
+
+/**
+ * @brief Get snapshot \p i, in the order written
+ *
+ * @param reader The output
+ * @param i The snapshot, less than `ELA_ReaderGetSnapshotCount()`
+ * @param[out] info Set to the snapshot
+ */
+int ELA_ReaderGetSnapshot(const ELA_Reader* reader, size_t i, ELA_SnapshotInfo* info);
+
+/**
+ * @brief Read the volume tracking matrix \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$
+ *
+ * @param reader The output
+ * @param t_num The snapshot index \f$ n \f$
+ * @param[out] matrix Set to the matrix, free with `ELA_MatrixFree()`
+ */
+int ELA_ReaderGetVTM(const ELA_Reader* reader, int t_num, ELA_Matrix** matrix);
+
+/**
+ * @brief Read the volume vector \f$\mathbf{v}^{n}\f$
+ *
+ * @param reader The output
+ * @param t_num The snapshot index \f$ n \f$
+ * @param[out] vector Set to the vector, free with `ELA_VectorFree()`
+ */
+int ELA_ReaderGetV(const ELA_Reader* reader, int t_num, ELA_Vector** vector);
+
+/**
+ * @brief Compose the volume tracking matrices from snapshot \p from to \p to
+ *
+ * Computes \f$\mathbf{Q}^{(m-1\rightarrow m)}\cdots\mathbf{Q}^{(k\rightarrow k+1)}\f$, where
+ * \f$k\f$ is \p from and \f$m\f$ is \p to, reading a single matrix at a time.
+ *
+ * @param reader The output
+ * @param from The earlier snapshot index
+ * @param to The later snapshot index
+ * @param normalize If non-zero, the rows of each matrix are divided by their sums, so entry
+ * \f$(i,j)\f$ of the product is the fraction of blob \f$i\f$ at \p to that came from blob \f$j\f$
+ * at \p from
+ * @param drop_tolerance Entries with magnitude at most this are dropped from each partial product
+ * @param[out] product Set to the product, free with `ELA_MatrixFree()`
+ */
+int ELA_ReaderCompose(
+    const ELA_Reader* reader, int from, int to, int normalize, double drop_tolerance,
+    ELA_Matrix** product
+);
+
+/** @brief Get the arrays of \p matrix, valid until it is freed */
+void ELA_MatrixGetView(const ELA_Matrix* matrix, ELA_MatrixView* view);
+
+/** @brief Free \p matrix */
+void ELA_MatrixFree(ELA_Matrix* matrix);
+
+/**
+ * @brief Get the values of \p vector, valid until it is freed
+ *
+ * @param vector The vector
+ * @param[out] rc Set to the row count \f$ M^{n} \f$
+ * @param[out] values Set to the volume of each label (RC values)
+ */
+void ELA_VectorGetValues(const ELA_Vector* vector, uint32_t* rc, const double** values);
+
+/** @brief Free \p vector */
+void ELA_VectorFree(ELA_Vector* vector);
+
+/** @brief The error of the last function that failed on this thread */
+const char* ELA_ReaderGetError(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
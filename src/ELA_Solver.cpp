@@ -45,9 +45,16 @@ void ELA_SolverDilateLabels(const double* u_div)
 
         for (auto& sVector : ela::dom->s[n]) {
             // s=s+c*u
-            sVector.add(*(cVector++), *(u++));
+            if (*u != 0.0 && !cVector->isEmpty()) {
+                sVector.add(*cVector, *u);
+                ela::dom->markChanged(n, sVector);
+            }
+            ++cVector;
+            ++u;
         }
     }
+
+    ela::invalidateGhosts();
 }
 
 void ELA_SolverNormalizeLabel(const double* vof_in)
@@ -64,13 +71,17 @@ void ELA_SolverNormalizeLabel(const double* vof_in)
             const svec::Value& fInv = 1.0 - *(f++);
 
             // remove very small (compared to 1-f) values of s
-            sVector.chop(fInv);
+            bool changed = sVector.chop(fInv);
 
             // ensure sum(s)=1-f
             // ELA paper eq. 47
-            sVector.normalize(fInv);
+            changed |= sVector.normalize(fInv);
+
+            if (changed) ela::dom->markChanged(n, sVector);
         }
     }
+
+    ela::invalidateGhosts();
 }
 
 void ELA_SolverFilterLabels(const double& tol, const double* vof_in)
@@ -83,18 +94,25 @@ void ELA_SolverFilterLabels(const double& tol, const double* vof_in)
         auto v = vofField.begin();
         for (auto& sVector : ela::dom->s[n]) {
             // f_air=1-f_water
-            if (*v <= tol) sVector.normalize();
+            bool changed = (*v <= tol && sVector.normalize());
+
+            if ((1 - *v) <= tol && !sVector.isEmpty()) {
+                sVector.clear();
+                changed = true;
+            }
 
-            if ((1 - *v) <= tol) sVector.clear();
+            if (changed) ela::dom->markChanged(n, sVector);
 
             ++v;
         }
     }
+
+    ela::invalidateGhosts();
 }
 
 void advectRow(
-    const fields::Helper<svec::SVector>& sRow, const fields::Helper<const double>& fluxRow,
-    const fields::Helper<const double>& deltaRow
+    const int& n, const fields::Helper<svec::SVector>& sRow,
+    const fields::Helper<const double>& fluxRow, const fields::Helper<const double>& deltaRow
 )
 {
     // Calculate the normalized SVector
@@ -131,6 +149,9 @@ void advectRow(
 
             // update s_{d+1} (subtraction)
             s_p.add(sNorm_loc, -flux_loc / del_p);
+
+            ela::dom->markChanged(n, s_0);
+            ela::dom->markChanged(n, s_p);
         }
     }
 }
@@ -145,24 +166,22 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
     const auto fluxField = ela::wrapField<const double>(flux);
     const auto deltaRow = ela::wrapRow<const double>(delta, d);
 
-#ifdef ELA_USE_MPI
-    // update ghost cells in each direction
-    const domain::Face face = static_cast<domain::Face>(d);
-
-    ela::dom->updateGhost(face);
-    ela::dom->updateGhost(getOppositeFace(face));
-#endif
-
     // for convience, create references to domain size
     auto& ni = ela::dom->ni;
     auto& nj = ela::dom->nj;
     auto& nk = ela::dom->nk;
-    auto& nn = ela::dom->nn;
+
+#ifdef ELA_USE_MPI
+    // the layers of valid ghost cells, more than one if some are left from a deep halo exchange
+    const int L = ela::dom->getSweepGhosts(d);
+#else
+    const int L = 1;
+#endif
 
     // the slice of deltaRow is the same every iteration
     const auto deltaRowSlice = deltaRow.slice(
-        (d == 0 ? -1 : 0), (d == 0 ? ni + 1 : 1), (d == 1 ? -1 : 0), (d == 1 ? nj + 1 : 1),
-        (d == 2 ? -1 : 0), (d == 2 ? nk + 1 : 1)
+        (d == 0 ? -L : 0), (d == 0 ? ni + L : 1), (d == 1 ? -L : 0), (d == 1 ? nj + L : 1),
+        (d == 2 ? -L : 0), (d == 2 ? nk + L : 1)
     );
 
     // confirm the cell sizes are valid
@@ -170,7 +189,8 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
         if (!std::isnormal(delta)) throw std::invalid_argument("Cell size delta is not normal");
     }
 
-    for (auto n = 0; n < nn; ++n) {
+    // advect a single ELA instance
+    auto advect = [&](const int& n) {
         auto& sField = ela::dom->s[n];
 
         switch (d) {
@@ -183,8 +203,8 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
                 for (auto k = 0; k < nk; k++) {
 #endif
                     advectRow(
-                        sField.slice(-1, ni + 1, j, j + 1, k, k + 1),
-                        fluxField.slice(-1, ni + 1, j, j + 1, k, k + 1), deltaRowSlice
+                        n, sField.slice(-L, ni + L, j, j + 1, k, k + 1),
+                        fluxField.slice(-L, ni + L, j, j + 1, k, k + 1), deltaRowSlice
                     );
                 }
             }
@@ -199,8 +219,8 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
                 for (auto k = 0; k < nk; k++) {
 #endif
                     advectRow(
-                        sField.slice(i, i + 1, -1, nj + 1, k, k + 1),
-                        fluxField.slice(i, i + 1, -1, nj + 1, k, k + 1), deltaRowSlice
+                        n, sField.slice(i, i + 1, -L, nj + L, k, k + 1),
+                        fluxField.slice(i, i + 1, -L, nj + L, k, k + 1), deltaRowSlice
                     );
                 }
             }
@@ -215,8 +235,8 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
                 for (auto j = 0; j < nj; j++) {
 #endif
                     advectRow(
-                        sField.slice(i, i + 1, j, j + 1, -1, nk + 1),
-                        fluxField.slice(i, i + 1, j, j + 1, -1, nk + 1), deltaRowSlice
+                        n, sField.slice(i, i + 1, j, j + 1, -L, nk + L),
+                        fluxField.slice(i, i + 1, j, j + 1, -L, nk + L), deltaRowSlice
                     );
                 }
             }
@@ -226,5 +246,15 @@ void ELA_SolverAdvectLabels(const int& d, const double* flux, const double* delt
             assert(false);
             __builtin_unreachable();
         }
+    };
+
+#ifdef ELA_USE_MPI
+    // update ghost cells in each direction, the flux determines which are upwind, and advect each
+    // ELA instance once its ghost cells are updated
+    ela::dom->updateGhostsThen(static_cast<domain::Face>(d), fluxField, advect);
+#else
+    for (auto n = 0; n < ela::dom->nn; ++n) {
+        advect(n);
     }
+#endif
 }
@@ -122,6 +122,10 @@ void ELA_SolverFilterLabels(const double& tol, const double* f);
  * the positive face. This routine requires that the flux on all faces is provided. This requires
  * one layer of padding cells on the negative face of the domain to be defined.
  *
+ * With ELA_SetHaloDepth() greater than one, consecutive calls in the same direction reuse the
+ * ghost cells of one exchange. A call in a different direction than the last always exchanges, so
+ * split sweeps (`0`, `1`, `2`, `0`, ...) do not benefit.
+ *
  * @param d The flux direction, `0`, `1`, or `2`
  * @param flux The scalar flux scaled by the timestep, \f$ \Delta t F \f$. NOTE: \f$ F > 0 \f$
  * corresponds to volume moving from the cell \f$ d+1 \f$ to the cell \f$ d \f$, which is typically
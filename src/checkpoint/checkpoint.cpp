@@ -1,6 +1,9 @@
 #include "checkpoint.h"
 #include "header.h"
 
+#include "../output/binarywriter.h"
+#include "../output/output.h"
+
 using namespace checkpoint;
 
 // binary file assumes size of various types
@@ -12,17 +15,17 @@ static_assert(sizeof(std::size_t) == 8);
 void checkpoint::create(const char* filename, const domain::Domain& dom)
 {
     // open file
-    std::ofstream output(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    output::BinaryWriter writer(filename, false, output::directIO);
 
     // write header
     const Header header = makeHeader();
-    output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    writer.write(header);
 
     // write domain size
-    output.write(reinterpret_cast<const char*>(dom.n), 3 * sizeof(int));
+    writer.write(dom.n, 3);
 
     // write number of ELA instances
-    output.write(reinterpret_cast<const char*>(&dom.nn), sizeof(int));
+    writer.write(dom.nn);
 
     // setup checksums
     svec::Label lCheckSum = 0;
@@ -32,29 +35,26 @@ void checkpoint::create(const char* filename, const domain::Domain& dom)
     for (auto n = 0; n < dom.nn; ++n) {
         // loop through all (non-ghost) cells
         for (const auto& s : dom.s[n]) {
-            const std::size_t& nnz = s.NNZ();
             // write number of non-zero elements
-            output.write(reinterpret_cast<const char*>(&nnz), sizeof(std::size_t));
+            writer.write(s.NNZ());
 
             // write label and value of each non-zero element
             for (const auto& elm : s) {
-                const svec::Label& l = elm.l;
-                output.write(reinterpret_cast<const char*>(&l), sizeof(svec::Label));
-                lCheckSum += l;
+                writer.write(elm.l);
+                lCheckSum += elm.l;
 
-                const svec::Value& v = elm.v;
-                output.write(reinterpret_cast<const char*>(&v), sizeof(svec::Value));
-                vCheckSum += v;
+                writer.write(elm.v);
+                vCheckSum += elm.v;
             }
         }
     }
 
     // write checksums
-    output.write(reinterpret_cast<const char*>(&lCheckSum), sizeof(svec::Label));
-    output.write(reinterpret_cast<const char*>(&vCheckSum), sizeof(svec::Value));
+    writer.write(lCheckSum);
+    writer.write(vCheckSum);
 
     // close file
-    output.close();
+    writer.close();
 }
 
 // load function for version 1 checkpoint
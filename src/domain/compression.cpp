@@ -1,43 +1,359 @@
 #include "compression.h"
 
 #include <cstring>
+#include <vector>
 
 using namespace domain;
 
-std::size_t domain::getCompressedSize(const fields::Helper<svec::SVector>& slice)
+/*
+Version 2 (compact) format
+--------------------------
+For each cell:
+    NNZ                         varint
+    label delta (x NNZ)         varint, from previous label in the cell (first is from 0)
+    value (x NNZ)               double (compact) or float (compactFloat)
+
+Varints are stored little-endian in groups of 7 bits, with the high bit set when more bytes
+follow (i.e., LEB128)
+*/
+
+// number of bytes used to store x as a varint
+static inline std::size_t varintSize(std::size_t x)
+{
+    std::size_t len = 1;
+    while (x >= 0x80) {
+        x >>= 7;
+        ++len;
+    }
+    return len;
+}
+
+static inline unsigned char* writeVarint(unsigned char* ptr, std::size_t x)
+{
+    while (x >= 0x80) {
+        *ptr++ = static_cast<unsigned char>(x | 0x80);
+        x >>= 7;
+    }
+    *ptr++ = static_cast<unsigned char>(x);
+    return ptr;
+}
+
+static inline const unsigned char* readVarint(const unsigned char* ptr, std::size_t& x)
+{
+    x = 0;
+    unsigned int shift = 0;
+    while (*ptr & 0x80) {
+        x |= static_cast<std::size_t>(*ptr++ & 0x7F) << shift;
+        shift += 7;
+    }
+    x |= static_cast<std::size_t>(*ptr++) << shift;
+    return ptr;
+}
+
+// size of a single value in the compressed data
+static inline std::size_t valueSize(const Encoding& encoding)
+{
+    return (encoding == Encoding::compactFloat ? sizeof(float) : sizeof(svec::Value));
+}
+
+std::size_t domain::getCompressedSize(
+    const fields::Helper<svec::SVector>& slice, const Encoding& encoding
+)
 {
     std::size_t len = 0;
+
+    if (encoding == Encoding::elements) {
+        for (const svec::SVector& s : slice) {
+            len += s.NNZ() + 1;
+        }
+        return len * sizeof(svec::Element);
+    }
+
+    const std::size_t vSize = valueSize(encoding);
     for (const svec::SVector& s : slice) {
-        len += s.NNZ() + 1;
+        len += varintSize(s.NNZ()) + s.NNZ() * vSize;
+
+        svec::Label prev = 0;
+        for (const auto& elm : s) {
+            len += varintSize(elm.l - prev);
+            prev = elm.l;
+        }
     }
-    return len * sizeof(svec::Element);
+    return len;
 }
 
-void domain::compress(void* const buff, const fields::Helper<svec::SVector>& slice)
+// compress a single cell, returns the end of the compressed data
+static inline unsigned char* compressCell(
+    unsigned char* ptr, const svec::SVector& s, const Encoding& encoding
+)
 {
-    auto ptr = reinterpret_cast<svec::Element*>(buff);
-
-    for (const auto& s : slice) {
+    if (encoding == Encoding::elements) {
         const auto& nnz = s.NNZ();
 
         // if there are non-zero elements, copy them into ptr
         if (nnz != 0) {
             std::memcpy(ptr, s.data(), nnz * sizeof(svec::Element));
-            ptr += nnz;
+            ptr += nnz * sizeof(svec::Element);
         }
 
         // add an element at the end to indicate the end
-        // TODO: could save some memory by only writing the label
-        *ptr++ = svec::END_ELEMENT;
+        std::memcpy(ptr, &svec::END_ELEMENT, sizeof(svec::Element));
+        return ptr + sizeof(svec::Element);
+    }
+
+    ptr = writeVarint(ptr, s.NNZ());
+
+    // labels as the difference from the previous label
+    svec::Label prev = 0;
+    for (const auto& elm : s) {
+        ptr = writeVarint(ptr, elm.l - prev);
+        prev = elm.l;
+    }
+
+    // values
+    if (encoding == Encoding::compactFloat) {
+        for (const auto& elm : s) {
+            const float v = static_cast<float>(elm.v);
+            std::memcpy(ptr, &v, sizeof(float));
+            ptr += sizeof(float);
+        }
+    }
+    else {
+        for (const auto& elm : s) {
+            std::memcpy(ptr, &elm.v, sizeof(svec::Value));
+            ptr += sizeof(svec::Value);
+        }
     }
+
+    return ptr;
 }
 
-void domain::decompress(const void* const buff, const fields::Helper<svec::SVector>& slice)
+// an upper bound on the space used by compressCell(), without traversing s
+static inline std::size_t getCompressedCellBound(const svec::SVector& s, const Encoding& encoding)
 {
-    auto ptr = reinterpret_cast<const svec::Element*>(buff);
+    if (encoding == Encoding::elements) {
+        return (s.NNZ() + 1) * sizeof(svec::Element);
+    }
+
+    // a varint uses at most one byte per 7 bits
+    constexpr std::size_t maxNNZSize = (8 * sizeof(std::size_t) + 6) / 7;
+    constexpr std::size_t maxLabelSize = (8 * sizeof(svec::Label) + 6) / 7;
+
+    return maxNNZSize + s.NNZ() * (maxLabelSize + valueSize(encoding));
+}
+
+std::size_t domain::getCompressedSizeBound(
+    const fields::Helper<svec::SVector>& slice, const Encoding& encoding
+)
+{
+    std::size_t len = 0;
+    for (const auto& s : slice) {
+        len += getCompressedCellBound(s, encoding);
+    }
+    return len;
+}
+
+std::size_t domain::compress(
+    void* const buff, const fields::Helper<svec::SVector>& slice, const Encoding& encoding
+)
+{
+    const auto start = reinterpret_cast<unsigned char*>(buff);
+    auto ptr = start;
+
+    for (const auto& s : slice) {
+        ptr = compressCell(ptr, s, encoding);
+    }
+
+    return ptr - start;
+}
+
+std::size_t domain::pack(
+    Buffer& buff, const fields::Helper<svec::SVector>& slice, const Encoding& encoding
+)
+{
+    const std::size_t start = buff.size();
+
+    for (const auto& s : slice) {
+        unsigned char* ptr = buff.grow(getCompressedCellBound(s, encoding));
+        buff.commit(compressCell(ptr, s, encoding));
+    }
+
+    return buff.size() - start;
+}
+
+// decompress a single cell, returns the end of the compressed data
+// elms is storage for the elements of a single cell, kept between calls
+static inline const unsigned char* decompressCell(
+    const unsigned char* ptr, svec::SVector& s, const Encoding& encoding,
+    std::vector<svec::Element>& elms
+)
+{
+    if (encoding == Encoding::elements) {
+        s = svec::SVector(reinterpret_cast<const svec::Element*>(ptr));
+        return ptr + (s.NNZ() + 1) * sizeof(svec::Element);
+    }
+
+    std::size_t nnz;
+    ptr = readVarint(ptr, nnz);
+
+    elms.resize(nnz + 1);
+
+    // labels
+    svec::Label l = 0;
+    for (std::size_t i = 0; i < nnz; ++i) {
+        std::size_t delta;
+        ptr = readVarint(ptr, delta);
+        l += static_cast<svec::Label>(delta);
+        elms[i].l = l;
+    }
+
+    // values
+    if (encoding == Encoding::compactFloat) {
+        for (std::size_t i = 0; i < nnz; ++i) {
+            float v;
+            std::memcpy(&v, ptr, sizeof(float));
+            elms[i].v = static_cast<svec::Value>(v);
+            ptr += sizeof(float);
+        }
+    }
+    else {
+        for (std::size_t i = 0; i < nnz; ++i) {
+            std::memcpy(&elms[i].v, ptr, sizeof(svec::Value));
+            ptr += sizeof(svec::Value);
+        }
+    }
+
+    elms[nnz] = svec::END_ELEMENT;
+    s = svec::SVector(elms.data());
+
+    return ptr;
+}
+
+void domain::decompress(
+    const void* const buff, const fields::Helper<svec::SVector>& slice, const Encoding& encoding
+)
+{
+    auto ptr = reinterpret_cast<const unsigned char*>(buff);
+    std::vector<svec::Element> elms;
 
     for (auto& s : slice) {
-        s = svec::SVector(ptr);
-        ptr += s.NNZ() + 1;
+        ptr = decompressCell(ptr, s, encoding, elms);
+    }
+}
+
+/*
+Masked format
+-------------
+    bitmap                      1 bit per cell, padded to a multiple of 8 bytes
+    cells                       the cells with their bit set, in the given encoding
+
+Bit (c % 8) of byte (c / 8) of the bitmap is set if cell c is included. The padding keeps
+Encoding::elements data aligned.
+*/
+
+// size of the bitmap for a slice with the given number of cells
+static inline std::size_t getBitmapSize(const std::size_t& cells)
+{
+    return (cells + 63) / 64 * 8;
+}
+
+std::size_t domain::getCompressedSizeBound(
+    const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding
+)
+{
+    assert(mask.size() == slice.size());
+
+    std::size_t len = getBitmapSize(slice.size());
+    auto m = mask.cbegin();
+    for (const auto& s : slice) {
+        if (*(m++)) len += getCompressedCellBound(s, encoding);
+    }
+    return len;
+}
+
+// write the masked format to ptr, with room ensured by reserve(ptr, len) before each write
+template <class Reserve>
+static inline unsigned char* compressMaskedImpl(
+    unsigned char* ptr, const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding, Reserve reserve
+)
+{
+    assert(mask.size() == slice.size());
+
+    // bitmap
+    const std::size_t bitmapSize = getBitmapSize(slice.size());
+    ptr = reserve(ptr, bitmapSize);
+    std::memset(ptr, 0, bitmapSize);
+    for (std::size_t c = 0; c < mask.size(); ++c) {
+        if (mask[c]) ptr[c / 8] |= static_cast<unsigned char>(1u << (c % 8));
+    }
+    ptr += bitmapSize;
+
+    // cells
+    auto m = mask.cbegin();
+    for (const auto& s : slice) {
+        if (*(m++)) {
+            ptr = reserve(ptr, getCompressedCellBound(s, encoding));
+            ptr = compressCell(ptr, s, encoding);
+        }
+    }
+
+    return ptr;
+}
+
+std::size_t domain::compressMasked(
+    void* const buff, const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding
+)
+{
+    const auto start = reinterpret_cast<unsigned char*>(buff);
+
+    // the caller provides enough space
+    const auto end = compressMaskedImpl(
+        start, slice, mask, encoding, [](unsigned char* ptr, const std::size_t&) { return ptr; }
+    );
+
+    return end - start;
+}
+
+std::size_t domain::packMasked(
+    Buffer& buff, const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding
+)
+{
+    const std::size_t start = buff.size();
+
+    const auto end = compressMaskedImpl(
+        buff.grow(0), slice, mask, encoding,
+        [&buff](unsigned char* ptr, const std::size_t& len) {
+            buff.commit(ptr);
+            return buff.grow(len);
+        }
+    );
+    buff.commit(end);
+
+    return buff.size() - start;
+}
+
+void domain::decompressMasked(
+    const void* const buff, const fields::Helper<svec::SVector>& slice, const Encoding& encoding,
+    const bool& keep
+)
+{
+    const auto bitmap = reinterpret_cast<const unsigned char*>(buff);
+    auto ptr = bitmap + getBitmapSize(slice.size());
+    std::vector<svec::Element> elms;
+
+    std::size_t c = 0;
+    for (auto& s : slice) {
+        if (bitmap[c / 8] & (1u << (c % 8))) {
+            ptr = decompressCell(ptr, s, encoding, elms);
+        }
+        else if (!keep) {
+            // not sent, so mark as stale
+            s.clear();
+        }
+        ++c;
     }
 }
@@ -2,8 +2,82 @@
 #define COMPRESSION_H
 
 #include "domain.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
 
 namespace domain {
+
+/**
+ * @brief A growable buffer of bytes for compressed data
+ *
+ * Memory is kept between uses, so once a Buffer has grown to the size of the typical message
+ * calling @ref clear() and reusing it does not allocate.
+ */
+class Buffer {
+  public:
+    /** @brief Pointer to the start of the data */
+    unsigned char* data() noexcept
+    {
+        return vec.data();
+    }
+
+    /** @brief Pointer to the start of the data */
+    const unsigned char* data() const noexcept
+    {
+        return vec.data();
+    }
+
+    /** @brief Number of bytes of data */
+    std::size_t size() const noexcept
+    {
+        return len;
+    }
+
+    /** @brief Set the size to zero, keeping the memory */
+    void clear() noexcept
+    {
+        len = 0;
+    }
+
+    /**
+     * @brief Set the size to \p newLen bytes
+     *
+     * The contents up to `min(size(),newLen)` are kept, any new bytes are uninitialized
+     */
+    void resize(const std::size_t& newLen)
+    {
+        if (newLen > vec.size()) vec.resize(std::max(newLen, 2 * vec.size()));
+        len = newLen;
+    }
+
+    /**
+     * @brief Ensure there is room for \p extra more bytes
+     *
+     * @return unsigned char* Pointer to the end of the data, where the next bytes can be written
+     */
+    unsigned char* grow(const std::size_t& extra)
+    {
+        if (len + extra > vec.size()) vec.resize(std::max(len + extra, 2 * vec.size()));
+        return vec.data() + len;
+    }
+
+    /**
+     * @brief Mark the data up to \p end (obtained from @ref grow()) as written
+     */
+    void commit(const unsigned char* end) noexcept
+    {
+        len = end - vec.data();
+        assert(len <= vec.size());
+    }
+
+  private:
+    std::vector<unsigned char> vec;
+    std::size_t len = 0;
+};
+
 /**
  * @brief The size of the compressed data (in bytes)
  *
@@ -11,25 +85,125 @@ namespace domain {
  * this is how much space will be used in @p buff
  *
  * @param[in] slice
+ * @param[in] encoding The format of the compressed data
  * @return std::size_t
  */
-std::size_t getCompressedSize(const fields::Helper<svec::SVector>& slice);
+std::size_t getCompressedSize(
+    const fields::Helper<svec::SVector>& slice, const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief An upper bound on the size of the compressed data (in bytes)
+ *
+ * Unlike @ref getCompressedSize(), only the NNZ of each cell is needed, so the labels and values
+ * of the @p slice are not read
+ *
+ * @param[in] slice
+ * @param[in] encoding The format of the compressed data
+ * @return std::size_t
+ */
+std::size_t getCompressedSizeBound(
+    const fields::Helper<svec::SVector>& slice, const Encoding& encoding = Encoding::elements
+);
 
 /**
  * @brief Compress the data in the @p slice
  *
  * @param[out] buff The buffer to fill with the compressed data
  * @param[in] slice The data to compress
+ * @param[in] encoding The format of the compressed data
+ * @return std::size_t The number of bytes written, the same as @ref getCompressedSize()
  */
-void compress(void* const buff, const fields::Helper<svec::SVector>& slice);
+std::size_t compress(
+    void* const buff, const fields::Helper<svec::SVector>& slice,
+    const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief Compress the data in the @p slice, appending it to @p buff
+ *
+ * Unlike @ref compress(), the compressed size does not need to be known beforehand. The @p slice
+ * is traversed once, with @p buff growing as needed.
+ *
+ * @param[inout] buff The buffer to append the compressed data to
+ * @param[in] slice The data to compress
+ * @param[in] encoding The format of the compressed data
+ * @return std::size_t The number of bytes appended, the same as @ref getCompressedSize()
+ */
+std::size_t pack(
+    Buffer& buff, const fields::Helper<svec::SVector>& slice,
+    const Encoding& encoding = Encoding::elements
+);
 
 /**
  * @brief Decompress the data in the @p buff
  *
  * @param[in] buff The buffer with the compressed data
  * @param[out] slice The slice to fill
+ * @param[in] encoding The format of the compressed data, must match that given to @ref compress()
+ */
+void decompress(
+    const void* const buff, const fields::Helper<svec::SVector>& slice,
+    const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief An upper bound on the size of the data compressed by @ref compressMasked()
+ *
+ * @param[in] slice
+ * @param[in] mask Which cells of the @p slice are included
+ * @param[in] encoding The format of the compressed data
+ * @return std::size_t
+ */
+std::size_t getCompressedSizeBound(
+    const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief Compress only the cells of the @p slice where @p mask is `true`
+ *
+ * The data starts with a bitmap of the @p mask, so @ref decompressMasked() does not need it.
+ *
+ * @param[out] buff The buffer to fill, must have room for @ref getCompressedSizeBound()
+ * @param[in] slice The data to compress
+ * @param[in] mask Which cells of the @p slice to include, in the order the @p slice is traversed
+ * @param[in] encoding The format of the compressed cells
+ * @return std::size_t The number of bytes written
+ */
+std::size_t compressMasked(
+    void* const buff, const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief @ref compressMasked(), appending to @p buff
+ *
+ * @param[inout] buff The buffer to append the compressed data to
+ * @param[in] slice The data to compress
+ * @param[in] mask Which cells of the @p slice to include, in the order the @p slice is traversed
+ * @param[in] encoding The format of the compressed cells
+ * @return std::size_t The number of bytes appended
+ */
+std::size_t packMasked(
+    Buffer& buff, const fields::Helper<svec::SVector>& slice, const std::vector<bool>& mask,
+    const Encoding& encoding = Encoding::elements
+);
+
+/**
+ * @brief Decompress the data from @ref compressMasked() or @ref packMasked()
+ *
+ * By default, cells of the @p slice that were not included are stale, and are cleared.
+ *
+ * @param[in] buff The buffer with the compressed data
+ * @param[inout] slice The slice to fill
+ * @param[in] encoding The format of the compressed cells
+ * @param[in] keep If true, cells that were not included are left unchanged
  */
-void decompress(const void* const buff, const fields::Helper<svec::SVector>& slice);
+void decompressMasked(
+    const void* const buff, const fields::Helper<svec::SVector>& slice,
+    const Encoding& encoding = Encoding::elements, const bool& keep = false
+);
 
 } // namespace domain
 
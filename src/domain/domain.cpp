@@ -2,10 +2,13 @@
 
 using namespace domain;
 
-Domain::Domain(const int& ni_in, const int& nj_in, const int& nk_in, const int& nn_in)
-    : n{ni_in, nj_in, nk_in}, nn(nn_in)
+Domain::Domain(
+    const int& ni_in, const int& nj_in, const int& nk_in, const int& nn_in, const int& ghosts_in
+)
+    : n{ni_in, nj_in, nk_in}, nn(nn_in), ghosts(ghosts_in)
 {
-    const int pad_s[6] = {1, 1, 1, 1, 1, 1}; // require one ghost cell for ela data
+    // require (at least) one ghost cell for ela data
+    const int pad_s[6] = {ghosts, ghosts, ghosts, ghosts, ghosts, ghosts};
     const int pad_c[6] = {0, 0, 0, 0, 0, 0}; // do not need ghost cells for dilation
 
     s.reserve(nn);
@@ -17,25 +20,37 @@ Domain::Domain(const int& ni_in, const int& nj_in, const int& nk_in, const int&
     }
 }
 
-fields::Helper<svec::SVector> domain::Domain::getGhost(const Face& f, const int& n)
+void domain::Domain::markChanged(const int& n)
 {
-    // check that n is not out of bounds
+    if (changed.empty()) return;
+
+    for (auto& bits : changed[n]) {
+        bits = allFaces;
+    }
+}
+
+fields::Helper<svec::SVector> domain::Domain::getGhost(
+    const Face& f, const int& n, const int& layers
+)
+{
+    // check that n and layers are not out of bounds
     assert(n >= 0 && n < nn);
+    assert(layers >= 1 && layers <= ghosts);
 
     switch (f) {
     case Face::iMinus:
-        return s[n].slice(-1, 0, 0, nj, 0, nk);
+        return s[n].slice(-layers, 0, 0, nj, 0, nk);
     case Face::jMinus:
-        return s[n].slice(0, ni, -1, 0, 0, nk);
+        return s[n].slice(0, ni, -layers, 0, 0, nk);
     case Face::kMinus:
-        return s[n].slice(0, ni, 0, nj, -1, 0);
+        return s[n].slice(0, ni, 0, nj, -layers, 0);
 
     case Face::iPlus:
-        return s[n].slice(ni, ni + 1, 0, nj, 0, nk);
+        return s[n].slice(ni, ni + layers, 0, nj, 0, nk);
     case Face::jPlus:
-        return s[n].slice(0, ni, nj, nj + 1, 0, nk);
+        return s[n].slice(0, ni, nj, nj + layers, 0, nk);
     case Face::kPlus:
-        return s[n].slice(0, ni, 0, nj, nk, nk + 1);
+        return s[n].slice(0, ni, 0, nj, nk, nk + layers);
 
     default: // should never happen
         assert(false);
@@ -43,25 +58,28 @@ fields::Helper<svec::SVector> domain::Domain::getGhost(const Face& f, const int&
     }
 }
 
-fields::Helper<svec::SVector> domain::Domain::getEdge(const Face& f, const int& n)
+fields::Helper<svec::SVector> domain::Domain::getEdge(
+    const Face& f, const int& n, const int& layers
+)
 {
-    // check that n is not out of bounds
+    // check that n and layers are not out of bounds
     assert(n >= 0 && n < nn);
+    assert(layers >= 1 && layers <= this->n[f % 3]);
 
     switch (f) {
     case Face::iMinus:
-        return s[n].slice(0, 1, 0, nj, 0, nk);
+        return s[n].slice(0, layers, 0, nj, 0, nk);
     case Face::jMinus:
-        return s[n].slice(0, ni, 0, 1, 0, nk);
+        return s[n].slice(0, ni, 0, layers, 0, nk);
     case Face::kMinus:
-        return s[n].slice(0, ni, 0, nj, 0, 1);
+        return s[n].slice(0, ni, 0, nj, 0, layers);
 
     case Face::iPlus:
-        return s[n].slice(ni - 1, ni, 0, nj, 0, nk);
+        return s[n].slice(ni - layers, ni, 0, nj, 0, nk);
     case Face::jPlus:
-        return s[n].slice(0, ni, nj - 1, nj, 0, nk);
+        return s[n].slice(0, ni, nj - layers, nj, 0, nk);
     case Face::kPlus:
-        return s[n].slice(0, ni, 0, nj, nk - 1, nk);
+        return s[n].slice(0, ni, 0, nj, nk - layers, nk);
 
     default: // should never happen
         assert(false);
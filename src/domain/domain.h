@@ -50,8 +50,9 @@ struct Domain {
      * @param nj \ref nj
      * @param nk \ref nk
      * @param nn \ref nn
+     * @param ghosts \ref ghosts
      */
-    Domain(const int& ni, const int& nj, const int& nk, const int& nn);
+    Domain(const int& ni, const int& nj, const int& nk, const int& nn, const int& ghosts = 1);
 
     /** @brief Storage for ni, nj, and nk*/
     const int n[3];
@@ -68,6 +69,9 @@ struct Domain {
     /** @brief Number of ELA instances*/
     const int nn;
 
+    /** @brief Number of layers of ghost cells around \ref s */
+    const int ghosts;
+
     /**
      * @brief Source vector field
      *
@@ -86,23 +90,58 @@ struct Domain {
      */
     std::vector<fields::Owner<svec::NormalizedSVector>> c;
 
+    /**
+     * @brief Which cells of \ref s changed since they were last sent through each \ref Face
+     *
+     * Bit `f` of a cell of `changed[n]` is set while the same cell of `s[n]` has changed since it
+     * was last sent through \ref Face `f`. Only allocated when the changes are needed, see
+     * HaloSettings::delta, otherwise empty.
+     */
+    std::vector<fields::Owner<unsigned char>> changed;
+
+    /**
+     * @brief Mark \p cell, a cell of \ref s `[n]`, as changed
+     *
+     * Must be called whenever a cell is changed, as the changes are not found otherwise. Does
+     * nothing if \ref changed is empty.
+     */
+    void markChanged(const int& n, const svec::SVector& cell)
+    {
+        if (!changed.empty()) *getChanged(n, cell) = allFaces;
+    }
+
+    /** @brief Mark every cell of \ref s `[n]` as changed */
+    void markChanged(const int& n);
+
+    /** @brief The bits of \ref changed `[n]` for \p cell, a cell of \ref s `[n]` */
+    unsigned char* getChanged(const int& n, const svec::SVector& cell)
+    {
+        return &changed[n].at(-ghosts, -ghosts, -ghosts) +
+               (&cell - &s[n].at(-ghosts, -ghosts, -ghosts));
+    }
+
+    /** @brief The bits of \ref changed for all faces */
+    static constexpr unsigned char allFaces = 0x3F;
+
     /**
      * @brief From \ref s `[n]`, returns ghost cells immediately adjacent to \ref Face \p f
      *
      * @param f The Face
      * @param n Which ELA instance. Required: `0<=n<`\ref nn
+     * @param layers How many layers of ghost cells. Required: `1<=layers<=`\ref ghosts
      * @return fields::Helper<svec::SVector>
      */
-    fields::Helper<svec::SVector> getGhost(const Face& f, const int& n);
+    fields::Helper<svec::SVector> getGhost(const Face& f, const int& n, const int& layers = 1);
 
     /**
      * @brief From \ref s `[n]`, returns cells in the domain immediately adjacent to \ref Face \p f
      *
      * @param f The Face
      * @param n Which ELA instance. Required: `0<=n<`\ref nn
+     * @param layers How many layers of cells
      * @return fields::Helper<svec::SVector>
      */
-    fields::Helper<svec::SVector> getEdge(const Face& f, const int& n);
+    fields::Helper<svec::SVector> getEdge(const Face& f, const int& n, const int& layers = 1);
 
     /**
      * @brief Determine if there is a neighboring domain on the \ref Face \p f
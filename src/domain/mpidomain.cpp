@@ -1,15 +1,28 @@
 #include "mpidomain.h"
 
 #include "compression.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 
 using namespace domain;
 
 MPIDomain::MPIDomain(
-    const int& ni, const int& nj, const int& nk, const int& nn, MPI_Comm comm_cart_in
+    const int& ni, const int& nj, const int& nk, const int& nn, MPI_Comm comm_cart_in,
+    const HaloSettings& settings_in
 )
-    : Domain(ni, nj, nk, nn), comm_cart(comm_cart_in)
+    : Domain(ni, nj, nk, nn, settings_in.depth), comm_cart(comm_cart_in), settings(settings_in),
+      send_buff(nn), recv_buff(nn)
 {
+    if (settings.depth < 1 || settings.depth > std::min({ni, nj, nk})) {
+        throw std::invalid_argument("Halo depth must be between one and the domain size");
+    }
+    if (settings.depth > 1 && settings.upwindOnly) {
+        throw std::invalid_argument("Halo depth greater than one cannot be upwind only");
+    }
+
     // confirm this is a cartesian communicator
     int status;
     MPI_Topo_test(comm_cart, &status);
@@ -26,102 +39,661 @@ MPIDomain::MPIDomain(
     int rank;
     MPI_Comm_rank(comm_cart, &rank);
     boss = (rank == 0);
+
+    // separate communicators so ghost cell and output messages cannot match any from the calling
+    // application, or each other
+    MPI_Comm_dup(comm_cart, &comm_halo);
+    MPI_Comm_dup(comm_cart, &comm_output);
+    MPI_Comm_dup(comm_cart, &comm_output_write);
+
+    if (settings.threads > 1) {
+        if (settings.backend != Backend::pointToPoint) {
+            throw std::invalid_argument("Halo threads require the point-to-point backend");
+        }
+
+        int provided;
+        MPI_Query_thread(&provided);
+        if (provided < MPI_THREAD_MULTIPLE) {
+            throw std::invalid_argument("Halo threads require MPI_THREAD_MULTIPLE");
+        }
+
+        pool = std::make_unique<WorkerPool>(std::min(settings.threads, nn));
+    }
+
+    if (settings.delta) {
+        const int pad[6] = {0, 0, 0, 0, 0, 0};
+        const int pad_s[6] = {ghosts, ghosts, ghosts, ghosts, ghosts, ghosts};
+
+        // every cell is sent through each face the first time
+        changed.reserve(nn);
+        for (auto n = 0; n < nn; ++n) {
+            changed.emplace_back(this->n, pad_s);
+            std::fill_n(
+                &changed[n].at(-ghosts, -ghosts, -ghosts), fields::getLength(this->n, pad_s),
+                allFaces
+            );
+        }
+
+        last_recv.reserve(6 * nn);
+        for (auto f = 0; f < 6; ++f) {
+            // the size of the face
+            int size[3] = {ni, nj, nk};
+            size[f % 3] = settings.depth;
+
+            for (auto n = 0; n < nn; ++n) {
+                last_recv.emplace_back(size, pad);
+            }
+        }
+
+        delta_mask.resize(nn);
+    }
+
+    if (settings.backend == Backend::neighborhood) {
+        // Ordering the sources by the opposite face means that when there are multiple edges
+        // between two processes, the n-th edge in the destinations of one matches the n-th edge
+        // in the sources of the other
+        std::vector<int> destinations;
+        std::vector<int> sources;
+
+        for (auto f = 0; f < 6; ++f) {
+            const Face face = static_cast<Face>(f);
+
+            graph_dest[f] = -1;
+            if (hasNeighbor(face)) {
+                graph_dest[f] = destinations.size();
+                destinations.push_back(neighbors[face]);
+            }
+
+            graph_source[f] = -1;
+            if (hasNeighbor(getOppositeFace(face))) {
+                graph_source[f] = sources.size();
+                sources.push_back(neighbors[getOppositeFace(face)]);
+            }
+        }
+
+        graph_outdegree = destinations.size();
+        graph_indegree = sources.size();
+
+        MPI_Dist_graph_create_adjacent(
+            comm_cart, graph_indegree, sources.data(), MPI_UNWEIGHTED, graph_outdegree,
+            destinations.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, false, &comm_graph
+        );
+    }
+
+    if (settings.backend == Backend::sharedMemory) {
+        MPI_Comm_split_type(comm_halo, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &comm_node);
+
+        int node;
+        MPI_Comm_rank(comm_node, &node);
+        if (settings.sharedRanks > 0) {
+            MPI_Comm comm_group;
+            MPI_Comm_split(comm_node, node / settings.sharedRanks, node, &comm_group);
+            MPI_Comm_free(&comm_node);
+            comm_node = comm_group;
+            MPI_Comm_rank(comm_node, &node);
+        }
+
+        // find which neighbors are on this node, a periodic boundary to this process uses messages
+        MPI_Group group_cart, group_node;
+        MPI_Comm_group(comm_cart, &group_cart);
+        MPI_Comm_group(comm_node, &group_node);
+        MPI_Group_translate_ranks(group_cart, 6, neighbors, group_node, node_rank);
+        MPI_Group_free(&group_cart);
+
+        for (auto f = 0; f < 6; ++f) {
+            if (!hasNeighbor(static_cast<Face>(f)) || node_rank[f] == node) {
+                node_rank[f] = MPI_UNDEFINED;
+            }
+        }
+
+        // the link used to send through face f is received by the neighbor at the opposite face
+        struct Key {
+            int sender;
+            int receiver;
+            int face;
+            SharedLink* link;
+        };
+        std::vector<Key> keys;
+        for (auto f = 0; f < 6; ++f) {
+            if (node_rank[f] == MPI_UNDEFINED) continue;
+
+            const Face face = static_cast<Face>(f);
+            link_send[f].sender = true;
+            keys.push_back({node, node_rank[f], f, &link_send[f]});
+            keys.push_back({node_rank[f], node, getOppositeFace(face), &link_recv[f]});
+        }
+        std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) {
+            return (a.sender != b.sender ? a.sender < b.sender : a.face < b.face);
+        });
+
+        // only the two processes of each link take part in creating its communicator
+        for (const auto& key : keys) {
+            const int ranks[2] = {key.sender, key.receiver};
+            MPI_Group group_link;
+            MPI_Group_incl(group_node, 2, ranks, &group_link);
+            MPI_Comm_create_group(comm_node, group_link, key.face, &key.link->comm);
+            MPI_Group_free(&group_link);
+
+            links.push_back(key.link);
+        }
+        MPI_Group_free(&group_node);
+    }
+}
+
+MPIDomain::~MPIDomain()
+{
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        if (comm_graph != MPI_COMM_NULL) MPI_Comm_free(&comm_graph);
+        for (auto link : links) {
+            link->free();
+        }
+        if (comm_node != MPI_COMM_NULL) MPI_Comm_free(&comm_node);
+        MPI_Comm_free(&comm_halo);
+        MPI_Comm_free(&comm_output);
+        MPI_Comm_free(&comm_output_write);
+    }
 }
 
 void MPIDomain::updateGhost(const Face& recv)
 {
-    const Face send = getOppositeFace(recv);
+    prepareEdges(getOppositeFace(recv));
+
+    switch (settings.backend) {
+    case Backend::pointToPoint:
+        updateGhostPointToPoint(recv);
+        break;
+    case Backend::neighborhood:
+        updateGhostNeighborhood(recv);
+        break;
+    case Backend::sharedMemory:
+        updateGhostSharedMemory(recv);
+        break;
+    default: // should never happen
+        assert(false);
+        __builtin_unreachable();
+    }
+}
+
+void MPIDomain::updateGhost(const Face& recv, const fields::Helper<const double>& flux)
+{
+    if (!settings.upwindOnly) {
+        updateGhost(recv);
+        return;
+    }
+
+    setUpwindMask(getOppositeFace(recv), flux);
+
+    masked = true;
+    updateGhost(recv);
+    masked = false;
+}
+
+void MPIDomain::invalidateGhosts()
+{
+    std::fill(ghost_valid, ghost_valid + 3, 0);
+}
+
+void MPIDomain::setUpwindMask(const Face& send, const fields::Helper<const double>& flux)
+{
+    // the flux on the boundary at send, which is the same face the neighbor uses for recv
+    const int d = send % 3;
+    const bool positive = (send >= iPlus);
+
+    int start[3] = {0, 0, 0};
+    int end[3] = {ni, nj, nk};
+    start[d] = (positive ? n[d] - 1 : -1);
+    end[d] = start[d] + 1;
+
+    const auto boundary = flux.slice(start[0], end[0], start[1], end[1], start[2], end[2]);
+
+    // a positive flux is from the d+1 cell into the d cell, so the neighbor needs the edge cell
+    // when the flux is into the neighbor
+    auto& mask = send_mask[send];
+    mask.resize(boundary.size());
+    auto m = mask.begin();
+    for (const auto& f : boundary) {
+        *(m++) = (positive ? f < 0.0 : f > 0.0);
+    }
+}
+
+void MPIDomain::prepareEdges(const Face& send)
+{
+    for (auto n = 0; n < nn; ++n) {
+        prepareEdge(send, n);
+    }
+}
+
+void MPIDomain::prepareEdge(const Face& send, const int& n)
+{
+    if (!settings.delta || !hasNeighbor(send)) return;
+
+    const auto edge = getEdge(send, n, settings.depth);
+    const unsigned char bit = 1 << send;
+    auto& mask = delta_mask[n];
+
+    mask.resize(edge.size());
+
+    // send the cells which changed since they were last sent through this face
+    std::size_t c = 0;
+    for (const auto& e : edge) {
+        unsigned char& bits = *getChanged(n, e);
+        mask[c] = (bits & bit) && (!masked || send_mask[send][c]);
+        if (mask[c]) bits &= ~bit;
+
+        ++c;
+    }
+}
 
-    // Figure out how big each buffer needs to be
-    std::size_t* send_len = new std::size_t[nn];
-    std::size_t* recv_len = new std::size_t[nn];
+const std::vector<bool>& MPIDomain::getEdgeMask(const Face& send, const int& n) const
+{
+    return (settings.delta ? delta_mask[n] : send_mask[send]);
+}
 
+std::size_t MPIDomain::packEdge(Buffer& buff, const Face& send, const int& n)
+{
+    if (masked || settings.delta) {
+        return packMasked(
+            buff, getEdge(send, n, settings.depth), getEdgeMask(send, n), settings.encoding
+        );
+    }
+    return pack(buff, getEdge(send, n, settings.depth), settings.encoding);
+}
+
+std::size_t MPIDomain::compressEdge(void* buff, const Face& send, const int& n)
+{
+    if (masked || settings.delta) {
+        return compressMasked(
+            buff, getEdge(send, n, settings.depth), getEdgeMask(send, n), settings.encoding
+        );
+    }
+    return compress(buff, getEdge(send, n, settings.depth), settings.encoding);
+}
+
+std::size_t MPIDomain::getEdgeSizeBound(const Face& send, const int& n)
+{
+    if (masked || settings.delta) {
+        return getCompressedSizeBound(
+            getEdge(send, n, settings.depth), getEdgeMask(send, n), settings.encoding
+        );
+    }
+    return getCompressedSizeBound(getEdge(send, n, settings.depth), settings.encoding);
+}
+
+void MPIDomain::unpackGhost(const void* buff, const Face& recv, const int& n)
+{
+    if (settings.delta) {
+        // patch the last data received, as the ghost cells may have been changed since
+        auto& received = last_recv[recv * nn + n];
+        decompressMasked(buff, received, settings.encoding, true);
+
+        const auto ghost = getGhost(recv, n, settings.depth);
+        std::copy(received.begin(), received.end(), ghost.begin());
+    }
+    else if (masked) {
+        decompressMasked(buff, getGhost(recv, n, settings.depth), settings.encoding);
+    }
+    else {
+        decompress(buff, getGhost(recv, n, settings.depth), settings.encoding);
+    }
+}
+
+void MPIDomain::updateGhostPointToPoint(const Face& recv)
+{
+    std::vector<MPI_Request> send_req(nn, MPI_REQUEST_NULL);
+
+    sendEdges(getOppositeFace(recv), send_req);
+    recvGhosts(recv);
+
+    // Wait for the send buffers to be free
+    MPI_Waitall(nn, send_req.data(), MPI_STATUSES_IGNORE);
+}
+
+void MPIDomain::sendEdges(const Face& send, std::vector<MPI_Request>& send_req)
+{
+    // Compress and send data, the size is not exchanged as it is found from the message
     if (hasNeighbor(send)) {
         for (auto n = 0; n < nn; ++n) {
-            send_len[n] = getCompressedSize(getEdge(send, n));
+            sendEdge(send, n, send_req[n]);
         }
     }
+}
 
-    MPI_Sendrecv(
-        send_len, nn * sizeof(std::size_t), MPI_BYTE, neighbors[send], nn, recv_len,
-        nn * sizeof(std::size_t), MPI_BYTE, neighbors[recv], nn, comm_cart, MPI_STATUS_IGNORE
-    );
+void MPIDomain::sendEdge(const Face& send, const int& n, MPI_Request& req)
+{
+    // Compress the data in a single pass
+    send_buff[n].clear();
+    packEdge(send_buff[n], send, n);
 
-    // Receive compressed data
-    void** recv_buff = new void*[nn];
-    MPI_Request* recv_req = new MPI_Request[nn];
+    // Start sending the compressed data, the tag is the ELA instance
+    MPI_Isend(
+        send_buff[n].data(), send_buff[n].size(), MPI_BYTE, neighbors[send], n, comm_halo, &req
+    );
+}
 
+void MPIDomain::recvGhosts(const Face& recv)
+{
+    // Receive and decompress data, in the order it arrives
     if (hasNeighbor(recv)) {
-        for (auto n = 0; n < nn; ++n) {
-            // Setup receive buffer
-            recv_buff[n] = malloc(recv_len[n]);
-
-            // Start receiving data
-            MPI_Irecv(
-                recv_buff[n], recv_len[n], MPI_BYTE, neighbors[recv], n, comm_cart, &recv_req[n]
-            );
+        for (auto count = 0; count < nn; ++count) {
+            recvGhost(recv, MPI_ANY_TAG);
         }
     }
-    else {
+}
+
+void MPIDomain::recvGhost(const Face& recv, const int& tag)
+{
+    MPI_Message message;
+    MPI_Status status;
+    MPI_Mprobe(neighbors[recv], tag, comm_halo, &message, &status);
+
+    // the tag is the ELA instance
+    const int& index = status.MPI_TAG;
+    int len;
+    MPI_Get_count(&status, MPI_BYTE, &len);
+
+    recv_buff[index].resize(len);
+    MPI_Mrecv(recv_buff[index].data(), len, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+
+    // decompress the data into the ghost cells
+    unpackGhost(recv_buff[index].data(), recv, index);
+}
+
+void MPIDomain::updateGhostInstance(const Face& recv, const int& n)
+{
+    const Face send = getOppositeFace(recv);
+
+    MPI_Request req = MPI_REQUEST_NULL;
+    if (hasNeighbor(send)) {
+        prepareEdge(send, n);
+        sendEdge(send, n, req);
+    }
+
+    // only match messages for this instance, as other threads may be receiving
+    if (hasNeighbor(recv)) recvGhost(recv, n);
+
+    MPI_Wait(&req, MPI_STATUS_IGNORE);
+}
+
+// MPI calls assume the type of std::size_t
+static_assert(std::is_same<std::size_t, unsigned long>::value);
+
+void MPIDomain::updateGhostNeighborhood(const Face& recv)
+{
+    startGhostNeighborhood(recv);
+    sendGhostNeighborhood(recv);
+    finishGhostNeighborhood(recv);
+}
+
+void MPIDomain::updateGhostPair(const Face& recv, const fields::Helper<const double>& flux)
+{
+    const Face other = getOppositeFace(recv);
+
+    if (settings.backend != Backend::neighborhood) {
+        updateGhost(recv, flux);
+        updateGhost(other, flux);
+        return;
+    }
+
+    if (settings.upwindOnly) {
+        setUpwindMask(other, flux);
+        setUpwindMask(recv, flux);
+        masked = true;
+    }
+
+    // The data of one face is compressed while the sizes of the other are exchanged, and both are
+    // exchanged at once. The collectives complete in the order they were started on every process
+    prepareEdges(other);
+    startGhostNeighborhood(recv);
+    prepareEdges(recv);
+    startGhostNeighborhood(other);
+
+    sendGhostNeighborhood(recv);
+    sendGhostNeighborhood(other);
+
+    finishGhostNeighborhood(recv);
+    finishGhostNeighborhood(other);
+
+    masked = false;
+}
+
+void MPIDomain::startGhostNeighborhood(const Face& recv)
+{
+    const Face send = getOppositeFace(recv);
+    auto& exchange = graph_exchange[recv];
+
+    // Only one destination and one source are used, each with the same face
+    const int& dest = graph_dest[send];
+
+    // Compress the data for all ELA instances into one buffer
+    exchange.send_len.assign(graph_outdegree * nn, 0);
+    exchange.recv_len.assign(graph_indegree * nn, 0);
+
+    exchange.send_buff.clear();
+    if (dest >= 0) {
         for (auto n = 0; n < nn; ++n) {
-            recv_req[n] = MPI_REQUEST_NULL;
+            exchange.send_len[dest * nn + n] = packEdge(exchange.send_buff, send, n);
         }
     }
 
-    // Send compressed data
-    void** send_buff = new void*[nn];
-    MPI_Request* send_req = new MPI_Request[nn];
+    // The collective needs the size of each instance before receiving
+    MPI_Ineighbor_alltoall(
+        exchange.send_len.data(), nn, MPI_UNSIGNED_LONG, exchange.recv_len.data(), nn,
+        MPI_UNSIGNED_LONG, comm_graph, &exchange.req
+    );
+}
 
-    if (hasNeighbor(send)) {
+void MPIDomain::sendGhostNeighborhood(const Face& recv)
+{
+    const Face send = getOppositeFace(recv);
+    auto& exchange = graph_exchange[recv];
+
+    const int& dest = graph_dest[send];
+    const int& source = graph_source[send];
+
+    MPI_Wait(&exchange.req, MPI_STATUS_IGNORE);
+
+    std::vector<int> send_count(graph_outdegree, 0);
+    std::vector<int> send_displ(graph_outdegree, 0);
+    std::vector<int> recv_count(graph_indegree, 0);
+    std::vector<int> recv_displ(graph_indegree, 0);
+
+    if (dest >= 0) send_count[dest] = exchange.send_buff.size();
+
+    std::size_t recv_total = 0;
+    if (source >= 0) {
         for (auto n = 0; n < nn; ++n) {
-            // Setup send buffer
-            send_buff[n] = malloc(send_len[n]);
+            recv_total += exchange.recv_len[source * nn + n];
+        }
+        recv_count[source] = recv_total;
+    }
+    exchange.recv_buff.resize(recv_total);
 
-            // Compress the data
-            compress(send_buff[n], getEdge(send, n));
+    // Start exchanging the compressed data, the counts are only needed until the call returns
+    MPI_Ineighbor_alltoallv(
+        exchange.send_buff.data(), send_count.data(), send_displ.data(), MPI_BYTE,
+        exchange.recv_buff.data(), recv_count.data(), recv_displ.data(), MPI_BYTE, comm_graph,
+        &exchange.req
+    );
+}
 
-            // Start sending the compressed data
-            MPI_Isend(
-                send_buff[n], send_len[n], MPI_BYTE, neighbors[send], n, comm_cart, &send_req[n]
-            );
+void MPIDomain::finishGhostNeighborhood(const Face& recv)
+{
+    auto& exchange = graph_exchange[recv];
+    const int& source = graph_source[getOppositeFace(recv)];
+
+    MPI_Wait(&exchange.req, MPI_STATUS_IGNORE);
+
+    // Decompress each instance into the ghost cells
+    if (source >= 0) {
+        const unsigned char* ptr = exchange.recv_buff.data();
+        for (auto n = 0; n < nn; ++n) {
+            unpackGhost(ptr, recv, n);
+            ptr += exchange.recv_len[source * nn + n];
         }
     }
+}
+
+void MPIDomain::updateGhostSharedMemory(const Face& recv)
+{
+    const Face send = getOppositeFace(recv);
+
+    // Grow the windows which were too small for the last exchange, only the pair of processes of
+    // each link take part
+    for (auto link : links) {
+        if (link->grow != 0) link->allocate();
+    }
+
+    std::vector<MPI_Request> send_req(nn + 1, MPI_REQUEST_NULL);
+    MPI_Request done = MPI_REQUEST_NULL;
+
+    // Neighbors on other nodes use messages
+    if (node_rank[send] != MPI_UNDEFINED) {
+        sendShared(send, send_req[nn]);
+    }
     else {
+        sendEdges(send, send_req);
+    }
+
+    if (node_rank[recv] != MPI_UNDEFINED) {
+        recvShared(recv, done);
+    }
+    else {
+        recvGhosts(recv);
+    }
+
+    // Wait for the send buffers to be free
+    MPI_Waitall(nn + 1, send_req.data(), MPI_STATUSES_IGNORE);
+    MPI_Wait(&done, MPI_STATUS_IGNORE);
+}
+
+void MPIDomain::sendShared(const Face& send, MPI_Request& req)
+{
+    auto& link = link_send[send];
+
+    // The data starts with the offset to each ELA instance
+    const std::size_t header = nn * sizeof(std::size_t);
+
+    std::size_t len = header;
+    for (auto n = 0; n < nn; ++n) {
+        len += getEdgeSizeBound(send, n);
+    }
+
+    // The tags follow those of the ELA instances, one for the data sent through each face and one
+    // for the reply of the neighbor
+    const int tag = nn + send;
+
+    if (len <= link.len) {
+        // Wait until the neighbor is done reading the last exchange
+        MPI_Wait(&link.done, MPI_STATUS_IGNORE);
+        MPI_Win_sync(link.win);
+
+        // Compress directly into the window
+        std::size_t* offset = reinterpret_cast<std::size_t*>(link.ptr);
+        std::size_t pos = header;
         for (auto n = 0; n < nn; ++n) {
-            send_req[n] = MPI_REQUEST_NULL;
+            offset[n] = pos;
+            pos += compressEdge(link.ptr + pos, send, n);
         }
+
+        // Make the data visible to the neighbor, an empty message means it is in the window
+        MPI_Win_sync(link.win);
+        MPI_Isend(nullptr, 0, MPI_BYTE, neighbors[send], tag, comm_halo, &req);
+        MPI_Irecv(nullptr, 0, MPI_BYTE, neighbors[send], tag + 6, comm_halo, &link.done);
+        return;
+    }
+
+    // Otherwise send the data as a message, after the length of window requested
+    auto& buff = send_buff[0];
+    std::vector<std::size_t> offset(nn);
+    buff.resize(sizeof(std::size_t) + header);
+    for (auto n = 0; n < nn; ++n) {
+        offset[n] = buff.size() - sizeof(std::size_t);
+        packEdge(buff, send, n);
     }
+    std::memcpy(buff.data(), &len, sizeof(std::size_t));
+    std::memcpy(buff.data() + sizeof(std::size_t), offset.data(), header);
 
-    // Decompress received data
-    int index;
-    MPI_Waitany(nn, recv_req, &index, MPI_STATUS_IGNORE);
-    while (index != MPI_UNDEFINED) {
-        // decompress the data into the ghost cells
-        decompress(recv_buff[index], getGhost(recv, index));
+    MPI_Isend(buff.data(), buff.size(), MPI_BYTE, neighbors[send], tag, comm_halo, &req);
+    link.grow = len;
+}
+
+void MPIDomain::recvShared(const Face& recv, MPI_Request& req)
+{
+    auto& link = link_recv[recv];
+    const int tag = nn + getOppositeFace(recv);
+
+    MPI_Message message;
+    MPI_Status status;
+    MPI_Mprobe(neighbors[recv], tag, comm_halo, &message, &status);
 
-        // free up memory
-        free(recv_buff[index]);
+    int len;
+    MPI_Get_count(&status, MPI_BYTE, &len);
 
-        // wait for next
-        MPI_Waitany(nn, recv_req, &index, MPI_STATUS_IGNORE);
+    recv_buff[0].resize(len);
+    MPI_Mrecv(recv_buff[0].data(), len, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+
+    if (len == 0) {
+        // Decompress directly from the window of the neighbor, then let it write the next exchange
+        MPI_Win_sync(link.win);
+        unpackGhosts(link.ptr, recv);
+        MPI_Win_sync(link.win);
+
+        MPI_Isend(nullptr, 0, MPI_BYTE, neighbors[recv], tag + 6, comm_halo, &req);
+        return;
     }
-    delete[] recv_buff;
-    delete[] recv_req;
 
-    // Cleanup the send buffer
-    MPI_Waitany(nn, send_req, &index, MPI_STATUS_IGNORE);
-    while (index != MPI_UNDEFINED) {
-        // free up memory
-        free(send_buff[index]);
+    // The window is grown by both processes before the next exchange
+    std::memcpy(&link.grow, recv_buff[0].data(), sizeof(std::size_t));
+    unpackGhosts(recv_buff[0].data() + sizeof(std::size_t), recv);
+}
 
-        // wait for next
-        MPI_Waitany(nn, send_req, &index, MPI_STATUS_IGNORE);
+void MPIDomain::unpackGhosts(const unsigned char* base, const Face& recv)
+{
+    std::vector<std::size_t> offset(nn);
+    std::memcpy(offset.data(), base, nn * sizeof(std::size_t));
+
+    for (auto n = 0; n < nn; ++n) {
+        unpackGhost(base + offset[n], recv, n);
     }
-    delete[] send_buff;
-    delete[] send_req;
+}
+
+void MPIDomain::SharedLink::allocate()
+{
+    if (win != MPI_WIN_NULL) {
+        MPI_Wait(&done, MPI_STATUS_IGNORE);
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+    }
+
+    // grow geometrically, keeping the part aligned
+    constexpr std::size_t align = alignof(std::max_align_t);
+    len = std::max(grow, 2 * len);
+    len = (len + align - 1) / align * align;
+    grow = 0;
 
-    delete[] send_len;
-    delete[] recv_len;
+    unsigned char* base;
+    MPI_Win_allocate_shared((sender ? len : 0), 1, MPI_INFO_NULL, comm, &base, &win);
+
+    // a passive target epoch for the lifetime of the window, synchronized with MPI_Win_sync()
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    MPI_Aint size;
+    int disp_unit;
+    void* part;
+    MPI_Win_shared_query(win, 0, &size, &disp_unit, &part);
+    ptr = reinterpret_cast<unsigned char*>(part);
+}
+
+void MPIDomain::SharedLink::free()
+{
+    MPI_Wait(&done, MPI_STATUS_IGNORE);
+    if (win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+    }
+    MPI_Comm_free(&comm);
 }
 
 template <>
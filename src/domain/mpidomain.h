@@ -3,7 +3,15 @@
 
 #include <mpi.h>
 
+#include "compression.h"
 #include "domain.h"
+#include "settings.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
 
 namespace domain {
 
@@ -23,8 +31,18 @@ class MPIDomain : public Domain {
      * @param nk \ref nk
      * @param nn \ref nn
      * @param comm_cart MPI Cartesian Communicator
+     * @param settings How ghost cells are exchanged
      */
-    MPIDomain(const int& ni, const int& nj, const int& nk, const int& nn, MPI_Comm comm_cart);
+    MPIDomain(
+        const int& ni, const int& nj, const int& nk, const int& nn, MPI_Comm comm_cart,
+        const HaloSettings& settings = HaloSettings()
+    );
+
+    ~MPIDomain();
+
+    // the communicators and shared window are owned, and freed in ~MPIDomain()
+    MPIDomain(const MPIDomain&) = delete;
+    MPIDomain& operator=(const MPIDomain&) = delete;
 
     /**
      * @brief @copybrief Domain::hasNeighbor()
@@ -45,6 +63,7 @@ class MPIDomain : public Domain {
     /**
      * @brief Update the ghost cell adjacent to \ref Face \p recv
      *
+     * - All HaloSettings::depth layers of ghost cells are updated
      * - This will do nothing to the ghost cells if \ref hasNeighbor() is false for \p recv
      * - All processes must call this, as the current processes may have to send data regardless of
      * whether or not it is receiving data.
@@ -54,20 +73,269 @@ class MPIDomain : public Domain {
      */
     void updateGhost(const Face& recv);
 
+    /**
+     * @brief Update the ghost cells adjacent to \ref Face \p recv that are upwind sources
+     *
+     * With HaloSettings::upwindOnly, only the ghost cells where the \p flux on the boundary is into
+     * the domain are updated. The other ghost cells are not needed for advection, and are cleared
+     * to mark them as stale. Otherwise, this is the same as updateGhost(const Face&).
+     *
+     * @param recv
+     * @param flux The flux normal to \p recv, with the convention of ELA_SolverAdvectLabels()
+     */
+    void updateGhost(const Face& recv, const fields::Helper<const double>& flux);
+
+    /**
+     * @brief Update the ghost cells adjacent to \ref Face \p recv and its opposite, then call
+     * `work(n)` for each ELA instance `n`
+     *
+     * With HaloSettings::threads greater than one, the ELA instances are divided among that many
+     * threads, which are kept for the lifetime of the MPIDomain. Each thread exchanges the ghost
+     * cells of its instances with point-to-point messages, and calls \p work for an instance as
+     * soon as its ghost cells arrive, so \p work must be safe to call concurrently for different
+     * instances. If \p work throws, the ghost cells of the other instances are still exchanged, and
+     * the first exception is rethrown once every thread is done. Otherwise, this is the same as
+     * calling updateGhost() for both faces before \p work.
+     *
+     * As \p work is expected to advect in the direction of \p recv, afterwards one less layer of
+     * ghost cells is valid in that direction, and none in the other directions. With
+     * HaloSettings::depth greater than one, no ghost cells are exchanged while some layers are
+     * still valid, see getSweepGhosts().
+     *
+     * @param recv
+     * @param flux The flux normal to \p recv, see updateGhost()
+     * @param work Called with the index of each ELA instance
+     */
+    template <class Work>
+    void updateGhostsThen(const Face& recv, const fields::Helper<const double>& flux, Work work);
+
     /** @brief @copybrief Domain::getMax() */
     template <class T>
     T getMax(const T& in) const;
 
+    /**
+     * @brief The number of layers of ghost cells which will be valid for the next
+     * updateGhostsThen() in direction \p d
+     *
+     * A sweep with \f$L\f$ valid layers of ghost cells can update the ghost cells up to
+     * \f$L-1\f$ cells from the domain, in addition to the cells in the domain.
+     *
+     * Validity is only kept in the direction of the last sweep: the ghost cells of the other
+     * directions are copies of cells that sweep changed, and cannot be advected locally without
+     * the corner ghost cells, which are not exchanged. So after a sweep in direction \f$d\f$, the
+     * next sweep in any other direction exchanges all HaloSettings::depth layers, and deep halos
+     * give no benefit for split sweeps which change direction every call.
+     *
+     * @param d The direction, `0`, `1`, or `2`
+     */
+    int getSweepGhosts(const int& d) const
+    {
+        return (ghost_valid[d] > 0 ? ghost_valid[d] : settings.depth);
+    }
+
+    /**
+     * @brief Mark all layers of ghost cells as out of date
+     *
+     * Must be called whenever the cells in \ref s are changed other than through
+     * updateGhostsThen(), so the next sweep exchanges ghost cells.
+     */
+    void invalidateGhosts();
+
     /** @brief Get the MPI communicator */
     MPI_Comm getMPIComm() const
     {
         return comm_cart;
     }
 
+    /** @brief Get the MPI communicator for the reductions of the output */
+    MPI_Comm getOutputComm() const
+    {
+        return comm_output;
+    }
+
+    /**
+     * @brief Get the MPI communicator for writing the output collectively, apart from the
+     * reductions, which may be left running
+     */
+    MPI_Comm getOutputWriteComm() const
+    {
+        return comm_output_write;
+    }
+
   private:
+    /** @brief updateGhost() using Backend::pointToPoint */
+    void updateGhostPointToPoint(const Face& recv);
+
+    /** @brief updateGhost() using Backend::neighborhood */
+    void updateGhostNeighborhood(const Face& recv);
+
+    /**
+     * @brief Update the ghost cells adjacent to \ref Face \p recv and its opposite with the
+     * upwind masks from \p flux, as updateGhost() for each face
+     *
+     * With Backend::neighborhood the exchanges of both faces are in progress at once.
+     */
+    void updateGhostPair(const Face& recv, const fields::Helper<const double>& flux);
+
+    /**
+     * @brief Compress the edges sent for \ref Face \p recv and start exchanging their sizes, the
+     * first stage of updateGhostNeighborhood()
+     */
+    void startGhostNeighborhood(const Face& recv);
+
+    /** @brief Start exchanging the data once the sizes from startGhostNeighborhood() arrive */
+    void sendGhostNeighborhood(const Face& recv);
+
+    /** @brief Complete the exchange from sendGhostNeighborhood(), decompressing the data */
+    void finishGhostNeighborhood(const Face& recv);
+
+    /** @brief updateGhost() using Backend::sharedMemory */
+    void updateGhostSharedMemory(const Face& recv);
+
+    /** @brief Compress and start sending the edge at Face \p send, for each ELA instance */
+    void sendEdges(const Face& send, std::vector<MPI_Request>& send_req);
+
+    /** @brief Compress and start sending the edge at Face \p send, for ELA instance \p n */
+    void sendEdge(const Face& send, const int& n, MPI_Request& req);
+
+    /** @brief Receive and decompress the ghost cells at Face \p recv, for each ELA instance */
+    void recvGhosts(const Face& recv);
+
+    /** @brief Receive and decompress the ghost cells at Face \p recv, for the message \p tag */
+    void recvGhost(const Face& recv, const int& tag);
+
+    /** @brief Update the ghost cells at Face \p recv for ELA instance \p n only */
+    void updateGhostInstance(const Face& recv, const int& n);
+
+    /** @brief Set the cells sent from Face \p send with HaloSettings::upwindOnly */
+    void setUpwindMask(const Face& send, const fields::Helper<const double>& flux);
+
+    /** @brief Find the cells to send from the edge at Face \p send, when they are masked */
+    void prepareEdges(const Face& send);
+
+    /** @brief prepareEdges() for ELA instance \p n */
+    void prepareEdge(const Face& send, const int& n);
+
+    /** @brief The cells to send from the edge at Face \p send for ELA instance \p n */
+    const std::vector<bool>& getEdgeMask(const Face& send, const int& n) const;
+
+    /** @brief Compress the edge at Face \p send for ELA instance \p n, appending to \p buff */
+    std::size_t packEdge(Buffer& buff, const Face& send, const int& n);
+
+    /** @brief Compress the edge at Face \p send for ELA instance \p n into \p buff */
+    std::size_t compressEdge(void* buff, const Face& send, const int& n);
+
+    /** @brief An upper bound on the bytes used by compressEdge() */
+    std::size_t getEdgeSizeBound(const Face& send, const int& n);
+
+    /** @brief Decompress the data from packEdge() or compressEdge() into the ghost cells */
+    void unpackGhost(const void* buff, const Face& recv, const int& n);
+
+    /**
+     * @brief Compress the edges at Face \p send into the window shared with the neighbor, or
+     * into a message if they do not fit, see Backend::sharedMemory
+     */
+    void sendShared(const Face& send, MPI_Request& req);
+
+    /** @brief Decompress the ghost cells at Face \p recv sent by sendShared() */
+    void recvShared(const Face& recv, MPI_Request& req);
+
+    /** @brief Decompress the ghost cells at Face \p recv from the offsets and data at \p base */
+    void unpackGhosts(const unsigned char* base, const Face& recv);
+
     MPI_Comm comm_cart;
+    const HaloSettings settings;
     int neighbors[6];
     bool boss;
+
+    // duplicate of comm_cart used for exchanging ghost cells
+    MPI_Comm comm_halo;
+
+    // duplicate of comm_cart used for the reductions of the output, which may be left running
+    MPI_Comm comm_output;
+
+    // duplicate of comm_cart used for writing the output collectively
+    MPI_Comm comm_output_write;
+
+    // the threads for HaloSettings::threads, kept between calls to updateGhostsThen()
+    std::unique_ptr<WorkerPool> pool;
+
+    // number of layers of ghost cells in each direction that are still valid
+    int ghost_valid[3] = {0, 0, 0};
+
+    // which cells of the edge at each face are sent, used in place of the whole edge when masked
+    // is true
+    std::vector<bool> send_mask[6];
+    bool masked = false;
+
+    // for HaloSettings::delta, the data last received at each face (index f*nn+n), as the ghost
+    // cells not sent keep it but may be changed by advection in between, and which cells of the
+    // edge of each ELA instance are sent, from Domain::changed
+    std::vector<fields::Owner<svec::SVector>> last_recv;
+    std::vector<std::vector<bool>> delta_mask;
+
+    // buffers for compressed ghost cell data for each ELA instance, kept between calls
+    std::vector<Buffer> send_buff;
+    std::vector<Buffer> recv_buff;
+
+    // graph communicator for Backend::neighborhood
+    MPI_Comm comm_graph = MPI_COMM_NULL;
+
+    // position of each face in the destinations and sources of comm_graph (-1 if no neighbor)
+    // data sent to neighbors[f] uses destination graph_dest[f], and the data received from
+    // neighbors[getOppositeFace(f)] uses source graph_source[f]
+    int graph_dest[6];
+    int graph_source[6];
+    int graph_outdegree = 0;
+    int graph_indegree = 0;
+
+    // an exchange with comm_graph, for the face receiving, kept between calls for the buffers
+    struct GraphExchange {
+        Buffer send_buff;
+        Buffer recv_buff;
+        std::vector<std::size_t> send_len;
+        std::vector<std::size_t> recv_len;
+        MPI_Request req = MPI_REQUEST_NULL;
+    };
+    GraphExchange graph_exchange[6];
+
+    // processes on the same node, for Backend::sharedMemory
+    MPI_Comm comm_node = MPI_COMM_NULL;
+
+    // rank of neighbors[f] in comm_node (MPI_UNDEFINED if not on this node, or this process)
+    int node_rank[6];
+
+    // a window shared by a process and one neighbor on the same node, with the part of the
+    // sender only
+    struct SharedLink {
+        // the sender and receiver, in that order
+        MPI_Comm comm = MPI_COMM_NULL;
+        bool sender = false;
+        MPI_Win win = MPI_WIN_NULL;
+        std::size_t len = 0;
+        unsigned char* ptr = nullptr;
+
+        // the length requested by the sender for the next exchange, zero if the window fits
+        std::size_t grow = 0;
+
+        // for the sender, the empty message from the receiver when it is done reading
+        MPI_Request done = MPI_REQUEST_NULL;
+
+        /** @brief (Re)allocate the window to the length requested, by both processes */
+        void allocate();
+
+        /** @brief Free the window and communicator, by both processes */
+        void free();
+    };
+
+    // the window used to send through each face, and to receive at each face
+    SharedLink link_send[6];
+    SharedLink link_recv[6];
+
+    // the links in order of the rank of the sender in comm_node, then the face sent through, which
+    // is the same for both processes of a link, so collectives on the links of different pairs
+    // cannot wait on each other
+    std::vector<SharedLink*> links;
 };
 
 constexpr bool MPIDomain::hasNeighbor(Face d) const
@@ -80,6 +348,68 @@ constexpr bool MPIDomain::isBoss() const
     return boss;
 }
 
+template <class Work>
+void MPIDomain::updateGhostsThen(
+    const Face& recv, const fields::Helper<const double>& flux, Work work
+)
+{
+    const Face other = getOppositeFace(recv);
+    const int d = recv % 3;
+    const int layers = getSweepGhosts(d);
+
+    if (ghost_valid[d] > 0) {
+        // the ghost cells from a previous exchange are still valid
+        for (auto n = 0; n < nn; ++n) {
+            work(n);
+        }
+    }
+    else if (settings.threads <= 1) {
+        updateGhostPair(recv, flux);
+
+        for (auto n = 0; n < nn; ++n) {
+            work(n);
+        }
+    }
+    else {
+        // the masks are shared by all instances, so set them before running the threads
+        if (settings.upwindOnly) {
+            setUpwindMask(other, flux);
+            setUpwindMask(recv, flux);
+            masked = true;
+        }
+
+        // an exception from any thread is rethrown here, once all are done
+        try {
+            pool->run([this, &recv, &other, &work](const int& t) {
+                std::exception_ptr error;
+                for (auto n = t; n < nn; n += pool->size()) {
+                    updateGhostInstance(recv, n);
+                    updateGhostInstance(other, n);
+
+                    // the neighbors wait for the other instances, so keep exchanging them
+                    try {
+                        work(n);
+                    }
+                    catch (...) {
+                        if (!error) error = std::current_exception();
+                    }
+                }
+                if (error) std::rethrow_exception(error);
+            });
+        }
+        catch (...) {
+            masked = false;
+            throw;
+        }
+
+        masked = false;
+    }
+
+    // the edge cells were changed, and the outer layer of ghost cells is no longer valid
+    invalidateGhosts();
+    ghost_valid[d] = layers - 1;
+}
+
 } // namespace domain
 
 #endif
@@ -0,0 +1,134 @@
+#ifndef DOMAIN_SETTINGS_H
+#define DOMAIN_SETTINGS_H
+
+namespace domain {
+
+/**
+ * @brief The format used to store compressed SVector data
+ *
+ * @see compress()
+ */
+enum class Encoding
+{
+    /**
+     * @brief Version 1 format
+     *
+     * The non-zero svec::Element of each cell are copied directly, followed by svec::END_ELEMENT.
+     */
+    elements,
+
+    /**
+     * @brief Version 2 format
+     *
+     * Each cell is stored as a varint NNZ, followed by the varint delta of each label from the
+     * previous label in the cell, followed by the raw values. A cell with a single small label
+     * takes 10 bytes rather than the 32 bytes of @ref elements.
+     */
+    compact,
+
+    /**
+     * @brief Version 2 format with values quantized to `float`
+     *
+     * Same as @ref compact but each value is stored as a `float`.
+     *
+     * @warning This is lossy, values are only accurate to single precision
+     */
+    compactFloat
+};
+
+/**
+ * @brief The MPI communication used to exchange ghost cells
+ *
+ */
+enum class Backend
+{
+    /** @brief Non-blocking point-to-point messages to each neighbor */
+    pointToPoint,
+
+    /**
+     * @brief A neighborhood collective
+     *
+     * A distributed graph communicator of the Cartesian neighbors is created with
+     * `MPI_Dist_graph_create_adjacent()`, and each exchange is done with
+     * `MPI_Ineighbor_alltoallv()`.
+     */
+    neighborhood,
+
+    /**
+     * @brief MPI-3 shared memory for neighbors on the same node
+     *
+     * For each face, a process and its neighbor on the same node share a window allocated with
+     * `MPI_Win_allocate_shared()`. The process compresses its edge directly into the window, and
+     * the neighbor decompresses straight from it, each exchange being synchronized with an empty
+     * message each way between the two. When the edge does not fit, it is sent as a message and
+     * the window is grown by the pair before the next exchange. Neighbors on other nodes use
+     * @ref pointToPoint.
+     */
+    sharedMemory
+};
+
+/**
+ * @brief Options controlling how ghost cells are exchanged between domains
+ *
+ */
+struct HaloSettings {
+    /** @brief The format used for compressed halo data */
+    Encoding encoding = Encoding::compact;
+
+    /** @brief The communication used to exchange halo data */
+    Backend backend = Backend::pointToPoint;
+
+    /**
+     * @brief Only exchange the ghost cells which are upwind sources
+     *
+     * When the flux is given to MPIDomain::updateGhost(), a ghost cell is only sent if the flux
+     * on its face is into the domain. The other ghost cells are stale.
+     */
+    bool upwindOnly = false;
+
+    /**
+     * @brief Only send the edge cells which changed since they were last sent
+     *
+     * The cells changed are tracked with Domain::changed, which every change to the cells must
+     * mark, and the receiver keeps a copy of the data last received, so only a bitmap and the
+     * changed cells are exchanged. Ghost cells that are not sent keep the last value received,
+     * including those skipped by @ref upwindOnly.
+     */
+    bool delta = false;
+
+    /**
+     * @brief Number of threads used to exchange the ghost cells of different ELA instances
+     *
+     * With more than one thread, the ghost cells of each ELA instance are exchanged and advected
+     * independently, see MPIDomain::updateGhostsThen(). This requires Backend::pointToPoint and
+     * that MPI was initialized with `MPI_THREAD_MULTIPLE`.
+     */
+    int threads = 1;
+
+    /**
+     * @brief Number of layers of ghost cells
+     *
+     * With \f$k\f$ layers, \f$k\f$ consecutive advection sweeps in the same direction (e.g.,
+     * substeps) need only one exchange, as the ghost cells still needed are updated locally. This
+     * cannot be combined with @ref upwindOnly.
+     *
+     * @warning A sweep in a different direction than the last always exchanges every layer, so
+     * there is no benefit for split sweeps which change direction every call, see
+     * MPIDomain::getSweepGhosts().
+     */
+    int depth = 1;
+
+    /**
+     * @brief The most processes of a node which exchange through shared memory with
+     * Backend::sharedMemory
+     *
+     * The processes of each node are divided in order of rank into groups of this size, and
+     * neighbors in different groups use @ref Backend::pointToPoint as if they were on different
+     * nodes. Zero for one group per node.
+     */
+    int sharedRanks = 0;
+};
+
+} // namespace domain
+
+#endif
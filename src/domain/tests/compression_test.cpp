@@ -1,4 +1,5 @@
 #include "../compression.h"
+#include <cstring>
 #include <gtest/gtest.h>
 
 constexpr int NI = 10;
@@ -77,3 +78,156 @@ TEST(DomainTests, CompressionRoundTrip)
 
     free(buff);
 }
+
+TEST(DomainTests, CompressionRoundTripCompact)
+{
+    Slice in = generateData();
+    Slice out = Slice(n, pad);
+
+    const std::size_t len = domain::getCompressedSize(in, domain::Encoding::compact);
+    ASSERT_LT(len, domain::getCompressedSize(in, domain::Encoding::elements));
+
+    void* buff = malloc(len);
+
+    domain::compress(buff, in, domain::Encoding::compact);
+    domain::decompress(buff, out, domain::Encoding::compact);
+
+    auto itrA = in.begin();
+    auto itrB = out.begin();
+
+    while (itrA != in.end()) {
+        ASSERT_EQ(itrA->NNZ(), itrB->NNZ());
+
+        for (std::size_t i = 0; i < itrA->NNZ(); i++) {
+            ASSERT_EQ(itrA->data()[i].v, itrB->data()[i].v);
+            ASSERT_EQ(itrA->data()[i].l, itrB->data()[i].l);
+        }
+
+        itrA++;
+        itrB++;
+    }
+
+    free(buff);
+}
+
+TEST(DomainTests, CompressionRoundTripCompactFloat)
+{
+    Slice in = generateData();
+    Slice out = Slice(n, pad);
+
+    void* buff = malloc(domain::getCompressedSize(in, domain::Encoding::compactFloat));
+
+    domain::compress(buff, in, domain::Encoding::compactFloat);
+    domain::decompress(buff, out, domain::Encoding::compactFloat);
+
+    auto itrA = in.begin();
+    auto itrB = out.begin();
+
+    while (itrA != in.end()) {
+        ASSERT_EQ(itrA->NNZ(), itrB->NNZ());
+
+        for (std::size_t i = 0; i < itrA->NNZ(); i++) {
+            ASSERT_FLOAT_EQ(itrA->data()[i].v, itrB->data()[i].v);
+            ASSERT_EQ(itrA->data()[i].l, itrB->data()[i].l);
+        }
+
+        itrA++;
+        itrB++;
+    }
+
+    free(buff);
+}
+
+TEST(DomainTests, CompressedSizeCompact)
+{
+    constexpr int n1[3] = {1, 1, 1};
+    Slice cell = Slice(n1, pad);
+
+    // single small label
+    cell.at(0, 0, 0) = svec::SVector(svec::Element{5, 0.25});
+    EXPECT_EQ(domain::getCompressedSize(cell, domain::Encoding::elements), 32);
+    EXPECT_EQ(domain::getCompressedSize(cell, domain::Encoding::compact), 10);
+    EXPECT_EQ(domain::getCompressedSize(cell, domain::Encoding::compactFloat), 6);
+
+    // large labels need more bytes, but deltas are small
+    cell.at(0, 0, 0) = svec::SVector(svec::Element{1000000, 0.25});
+    cell.at(0, 0, 0).add(svec::SVector(svec::Element{1000001, 0.5}));
+    EXPECT_EQ(domain::getCompressedSize(cell, domain::Encoding::compact), 1 + 3 + 1 + 2 * 8);
+
+    // empty cell
+    cell.at(0, 0, 0).clear();
+    EXPECT_EQ(domain::getCompressedSize(cell, domain::Encoding::compact), 1);
+}
+
+TEST(DomainTests, Pack)
+{
+    Slice in = generateData();
+
+    for (const auto encoding : {domain::Encoding::elements, domain::Encoding::compact}) {
+        const std::size_t len = domain::getCompressedSize(in, encoding);
+
+        std::vector<unsigned char> ref(len);
+        domain::compress(ref.data(), in, encoding);
+
+        // pack after some existing data, which should be kept
+        domain::Buffer buff;
+        buff.resize(3);
+        std::fill(buff.data(), buff.data() + 3, 7);
+
+        ASSERT_EQ(domain::pack(buff, in, encoding), len);
+        ASSERT_EQ(buff.size(), len + 3);
+        ASSERT_EQ(buff.data()[0], 7);
+        ASSERT_EQ(buff.data()[2], 7);
+        ASSERT_EQ(std::memcmp(buff.data() + 3, ref.data(), len), 0);
+
+        // reuse the buffer
+        buff.clear();
+        ASSERT_EQ(domain::pack(buff, in, encoding), len);
+        ASSERT_EQ(std::memcmp(buff.data(), ref.data(), len), 0);
+    }
+}
+
+TEST(DomainTests, CompressionRoundTripMasked)
+{
+    Slice in = generateData();
+
+    // skip every third cell
+    std::vector<bool> mask(in.size());
+    for (std::size_t c = 0; c < mask.size(); ++c) {
+        mask[c] = (c % 3 != 0);
+    }
+
+    for (const auto encoding : {domain::Encoding::elements, domain::Encoding::compact}) {
+        Slice out = generateData();
+
+        domain::Buffer buff;
+        const std::size_t len = domain::packMasked(buff, in, mask, encoding);
+        ASSERT_LE(len, domain::getCompressedSizeBound(in, mask, encoding));
+
+        std::vector<unsigned char> ref(domain::getCompressedSizeBound(in, mask, encoding));
+        ASSERT_EQ(domain::compressMasked(ref.data(), in, mask, encoding), len);
+        ASSERT_EQ(std::memcmp(buff.data(), ref.data(), len), 0);
+
+        domain::decompressMasked(buff.data(), out, encoding);
+
+        auto itrA = in.begin();
+        auto itrB = out.begin();
+
+        for (std::size_t c = 0; c < mask.size(); ++c) {
+            if (mask[c]) {
+                ASSERT_EQ(itrA->NNZ(), itrB->NNZ());
+
+                for (std::size_t i = 0; i < itrA->NNZ(); i++) {
+                    ASSERT_EQ(itrA->data()[i].v, itrB->data()[i].v);
+                    ASSERT_EQ(itrA->data()[i].l, itrB->data()[i].l);
+                }
+            }
+            else {
+                ASSERT_TRUE(itrB->isEmpty());
+            }
+
+            itrA++;
+            itrB++;
+        }
+    }
+}
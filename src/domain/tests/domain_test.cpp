@@ -1,6 +1,11 @@
 #include "../domain.h"
+#include "../workerpool.h"
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
 constexpr int NI = 10;
 constexpr int NJ = 12;
 constexpr int NK = 14;
@@ -149,3 +154,44 @@ TEST(DomainTests, getOppositeFace)
     ASSERT_EQ(dir::kMinus, domain::getOppositeFace(dir::kPlus));
     ASSERT_EQ(dir::kPlus, domain::getOppositeFace(dir::kMinus));
 }
+
+TEST(DomainTests, WorkerPool)
+{
+    domain::WorkerPool pool(3);
+    ASSERT_EQ(pool.size(), 3);
+
+    // each part runs once, on a different thread, and the same threads are used every time
+    std::vector<std::thread::id> first(3);
+    for (auto run = 0; run < 4; ++run) {
+        std::vector<std::thread::id> ids(3);
+        std::atomic<int> count = 0;
+        pool.run([&](const int& t) {
+            ids[t] = std::this_thread::get_id();
+            ++count;
+        });
+
+        EXPECT_EQ(count, 3);
+        EXPECT_EQ(ids[0], std::this_thread::get_id());
+        if (run == 0) first = ids;
+        EXPECT_EQ(ids, first);
+    }
+    EXPECT_NE(first[1], first[2]);
+
+    // an error from any part is rethrown once all are done, and the pool can still be used
+    std::atomic<int> count = 0;
+    auto fail = [&](const int& t) {
+        ++count;
+        if (t == 2) throw std::runtime_error("failed");
+    };
+    EXPECT_THROW(pool.run(fail), std::runtime_error);
+    EXPECT_EQ(count, 3);
+
+    pool.run([&](const int&) { ++count; });
+    EXPECT_EQ(count, 6);
+
+    // a pool of one runs on the calling thread only
+    domain::WorkerPool single(1);
+    std::thread::id id;
+    single.run([&](const int&) { id = std::this_thread::get_id(); });
+    EXPECT_EQ(id, std::this_thread::get_id());
+}
@@ -1,3 +1,4 @@
+#include <array>
 #include <gtest/gtest.h>
 #include <mpi.h>
 
@@ -46,7 +47,8 @@ class MPIEnvironment : public ::testing::Environment {
     {
         char** argv;
         int argc = 0;
-        ASSERT_EQ(MPI_Init(&argc, &argv), MPI_SUCCESS);
+        int provided;
+        ASSERT_EQ(MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided), MPI_SUCCESS);
     }
 
     virtual void TearDown()
@@ -138,3 +140,453 @@ TEST(MPIDomainTests, Basic)
 
     // TODO: should add more testing
 }
+
+// fill the (non-ghost) cells of d with data that depends on the rank
+void fillRandom(domain::MPIDomain& d)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &count);
+    srand(count);
+    for (auto n = 0; n < d.nn; n++) {
+        for (auto& s : d.s[n]) {
+            svec::Element* buff = generateRandomS();
+            s = svec::SVector(buff);
+            delete[] buff;
+        }
+    }
+}
+
+// check that the ghost cells adjacent to face f are the same in a and b
+void expectSameGhosts(domain::MPIDomain& a, domain::MPIDomain& b, const domain::Face& f)
+{
+    for (auto n = 0; n < a.nn; n++) {
+        auto ghostA = a.getGhost(f, n);
+        auto ghostB = b.getGhost(f, n);
+
+        auto itrA = ghostA.begin();
+        auto itrB = ghostB.begin();
+
+        while (itrA != ghostA.end()) {
+            ASSERT_EQ(itrA->NNZ(), itrB->NNZ());
+
+            for (std::size_t i = 0; i < itrA->NNZ(); i++) {
+                ASSERT_EQ(itrA->data()[i].v, itrB->data()[i].v);
+                ASSERT_EQ(itrA->data()[i].l, itrB->data()[i].l);
+            }
+
+            itrA++;
+            itrB++;
+        }
+    }
+}
+
+// run the same exchange with the default settings and with settings, and compare
+void compareWithDefault(const domain::HaloSettings& settings)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    for (auto f = 0; f < 6; ++f) {
+        const domain::Face face = static_cast<domain::Face>(f);
+
+        ref.updateGhost(face);
+        d.updateGhost(face);
+
+        expectSameGhosts(ref, d, face);
+    }
+}
+
+// as compareWithDefault(), exchanging both faces of each direction with updateGhostsThen()
+void comparePairsWithDefault(const domain::HaloSettings& settings)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    const int pad[6] = {1, 1, 1, 1, 1, 1};
+    std::vector<double> data(fields::getLength(d.n, pad), 1.0);
+    const fields::Helper<const double> flux(data.data(), d.n, pad);
+
+    for (auto f = 0; f < 3; ++f) {
+        const domain::Face face = static_cast<domain::Face>(f);
+
+        ref.updateGhost(face);
+        ref.updateGhost(getOppositeFace(face));
+        d.updateGhostsThen(face, flux, [](const int&) {});
+
+        expectSameGhosts(ref, d, face);
+        expectSameGhosts(ref, d, getOppositeFace(face));
+    }
+}
+
+TEST(MPIDomainTests, Neighborhood)
+{
+    domain::HaloSettings settings;
+    settings.backend = domain::Backend::neighborhood;
+
+    compareWithDefault(settings);
+    comparePairsWithDefault(settings);
+
+    settings.encoding = domain::Encoding::elements;
+    compareWithDefault(settings);
+    comparePairsWithDefault(settings);
+}
+
+// as compareWithDefault(), repeating each exchange with the edges growing between rounds, so the
+// data sometimes fits in the buffers from the last exchange and sometimes does not
+void compareRepeated(const domain::HaloSettings& settings)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    for (auto round = 0; round < 4; ++round) {
+        if (round == 2) {
+            // more labels in every cell
+            svec::Element buff[11];
+            for (auto i = 0; i < 10; i++) {
+                buff[i] = svec::Element{static_cast<svec::Label>(100 + 4 * i), 0.5};
+            }
+            buff[10] = svec::END_ELEMENT;
+            const svec::SVector extra(buff);
+
+            for (auto n = 0; n < NN; n++) {
+                for (auto& s : ref.s[n]) {
+                    s.add(extra);
+                }
+                for (auto& s : d.s[n]) {
+                    s.add(extra);
+                }
+            }
+        }
+
+        for (auto f = 0; f < 6; ++f) {
+            const domain::Face face = static_cast<domain::Face>(f);
+
+            ref.updateGhost(face);
+            d.updateGhost(face);
+
+            expectSameGhosts(ref, d, face);
+        }
+    }
+}
+
+TEST(MPIDomainTests, SharedMemory)
+{
+    domain::HaloSettings settings;
+    settings.backend = domain::Backend::sharedMemory;
+
+    compareWithDefault(settings);
+    compareRepeated(settings);
+
+    settings.encoding = domain::Encoding::elements;
+    compareWithDefault(settings);
+}
+
+// check that the ghost cells adjacent to face f in a match ref where the flux is into the domain,
+// and are stale (empty) otherwise
+void expectUpwindGhosts(
+    domain::MPIDomain& a, domain::MPIDomain& ref, const domain::Face& f,
+    const fields::Helper<const double>& flux
+)
+{
+    const int d = f % 3;
+    const bool positive = (f >= domain::Face::iPlus);
+
+    int start[3] = {0, 0, 0};
+    int end[3] = {NI, NJ, NK};
+    start[d] = (positive ? a.n[d] - 1 : -1);
+    end[d] = start[d] + 1;
+    const auto boundary = flux.slice(start[0], end[0], start[1], end[1], start[2], end[2]);
+
+    for (auto n = 0; n < a.nn; n++) {
+        auto ghostA = a.getGhost(f, n);
+        auto ghostRef = ref.getGhost(f, n);
+
+        auto itrA = ghostA.begin();
+        auto itrRef = ghostRef.begin();
+
+        for (const auto& flx : boundary) {
+            const bool upwind = (positive ? flx > 0.0 : flx < 0.0);
+
+            if (upwind) {
+                ASSERT_EQ(itrA->NNZ(), itrRef->NNZ());
+                for (std::size_t i = 0; i < itrA->NNZ(); i++) {
+                    ASSERT_EQ(itrA->data()[i].v, itrRef->data()[i].v);
+                    ASSERT_EQ(itrA->data()[i].l, itrRef->data()[i].l);
+                }
+            }
+            else {
+                ASSERT_TRUE(itrA->isEmpty());
+            }
+
+            itrA++;
+            itrRef++;
+        }
+    }
+}
+
+void compareUpwindOnly(const domain::HaloSettings& settings)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    int rank, coords[3];
+    MPI_Comm_rank(comm_cart, &rank);
+    MPI_Cart_coords(comm_cart, rank, 3, coords);
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    const int pad[6] = {1, 1, 1, 1, 1, 1};
+    std::vector<double> data(fields::getLength(d.n, pad));
+    const fields::Helper<double> fill(data.data(), d.n, pad);
+    const fields::Helper<const double> flux(data.data(), d.n, pad);
+
+    for (auto dir = 0; dir < 3; ++dir) {
+        // a flux of both signs and zero, which depends on the global position of the face so it
+        // matches across processes
+        for (auto i = -1; i <= NI; ++i) {
+            for (auto j = -1; j <= NJ; ++j) {
+                for (auto k = -1; k <= NK; ++k) {
+                    // global index, wrapped for periodic boundaries
+                    const int gi = (coords[0] * NI + i + dims[0] * NI) % (dims[0] * NI);
+                    const int gj = (coords[1] * NJ + j + dims[1] * NJ) % (dims[1] * NJ);
+                    const int gk = (coords[2] * NK + k + dims[2] * NK) % (dims[2] * NK);
+                    fill.at(i, j, k) = static_cast<double>((7 * gi + 3 * gj + 5 * gk) % 3) - 1.0;
+                }
+            }
+        }
+
+        for (const auto& face : {dir, dir + 3}) {
+            const domain::Face f = static_cast<domain::Face>(face);
+
+            ref.updateGhost(f);
+            d.updateGhost(f, flux);
+
+            if (d.hasNeighbor(f)) expectUpwindGhosts(d, ref, f, flux);
+        }
+    }
+}
+
+TEST(MPIDomainTests, UpwindOnly)
+{
+    domain::HaloSettings settings;
+    settings.upwindOnly = true;
+
+    compareUpwindOnly(settings);
+
+    settings.backend = domain::Backend::neighborhood;
+    compareUpwindOnly(settings);
+
+    settings.backend = domain::Backend::sharedMemory;
+    settings.encoding = domain::Encoding::elements;
+    compareUpwindOnly(settings);
+}
+
+// exchange twice with only some cells changed between, and compare to the default settings
+void compareDelta(const domain::HaloSettings& settings)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    for (auto f = 0; f < 6; ++f) {
+        const domain::Face face = static_cast<domain::Face>(f);
+
+        ref.updateGhost(face);
+        d.updateGhost(face);
+
+        expectSameGhosts(ref, d, face);
+    }
+
+    // change some cells, and the ghost cells as done by advection
+    svec::Element buff[3] = {{1, 0.25}, {5, 0.5}, svec::END_ELEMENT};
+    for (auto n = 0; n < NN; n++) {
+        for (const auto& [i, j, k] : {std::array<int, 3>{0, 0, 0}, {NI - 1, 2, NK - 1}}) {
+            ref.s[n].at(i, j, k) = svec::SVector(buff);
+            d.s[n].at(i, j, k) = svec::SVector(buff);
+            d.markChanged(n, d.s[n].at(i, j, k));
+        }
+
+        for (auto f = 0; f < 6; ++f) {
+            for (auto& s : d.getGhost(static_cast<domain::Face>(f), n)) {
+                s.clear();
+            }
+        }
+    }
+
+    for (auto f = 0; f < 6; ++f) {
+        const domain::Face face = static_cast<domain::Face>(f);
+
+        ref.updateGhost(face);
+        d.updateGhost(face);
+
+        expectSameGhosts(ref, d, face);
+    }
+}
+
+TEST(MPIDomainTests, Delta)
+{
+    domain::HaloSettings settings;
+    settings.delta = true;
+
+    compareDelta(settings);
+
+    settings.backend = domain::Backend::neighborhood;
+    compareDelta(settings);
+
+    settings.backend = domain::Backend::sharedMemory;
+    settings.encoding = domain::Encoding::elements;
+    compareDelta(settings);
+}
+
+TEST(MPIDomainTests, Threads)
+{
+    int provided;
+    MPI_Query_thread(&provided);
+    if (provided < MPI_THREAD_MULTIPLE) GTEST_SKIP() << "MPI_THREAD_MULTIPLE not provided";
+
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::HaloSettings settings;
+    settings.threads = 2;
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    const int pad[6] = {1, 1, 1, 1, 1, 1};
+    std::vector<double> data(fields::getLength(d.n, pad), 1.0);
+    const fields::Helper<const double> flux(data.data(), d.n, pad);
+
+    for (auto f = 0; f < 3; ++f) {
+        const domain::Face face = static_cast<domain::Face>(f);
+
+        ref.updateGhost(face);
+        ref.updateGhost(getOppositeFace(face));
+
+        std::vector<int> called(NN, 0);
+        d.updateGhostsThen(face, flux, [&](const int& n) { called[n]++; });
+
+        for (auto n = 0; n < NN; n++) {
+            ASSERT_EQ(called[n], 1);
+        }
+
+        expectSameGhosts(ref, d, face);
+        expectSameGhosts(ref, d, getOppositeFace(face));
+    }
+
+    // an exception from the work is rethrown, after the ghost cells of every instance are updated
+    fillRandom(ref);
+    fillRandom(d);
+    ref.updateGhost(domain::Face::jMinus);
+    ref.updateGhost(domain::Face::jPlus);
+
+    auto fail = [](const int& n) {
+        if (n == 0) throw std::runtime_error("work failed");
+    };
+    EXPECT_THROW(d.updateGhostsThen(domain::Face::jMinus, flux, fail), std::runtime_error);
+
+    expectSameGhosts(ref, d, domain::Face::jMinus);
+    expectSameGhosts(ref, d, domain::Face::jPlus);
+}
+
+TEST(MPIDomainTests, DeepHalo)
+{
+    MPI_Comm comm_cart;
+    ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+
+    domain::HaloSettings settings;
+    settings.depth = 2;
+
+    domain::MPIDomain ref = domain::MPIDomain(NI, NJ, NK, NN, comm_cart);
+    domain::MPIDomain d = domain::MPIDomain(NI, NJ, NK, NN, comm_cart, settings);
+
+    fillRandom(ref);
+    fillRandom(d);
+
+    const int pad[6] = {2, 2, 2, 2, 2, 2};
+    std::vector<double> data(fields::getLength(d.n, pad), 1.0);
+    const fields::Helper<const double> flux(data.data(), d.n, pad);
+
+    auto noWork = [](const int&) {};
+
+    // the layer adjacent to the domain is the same as with one layer
+    ref.updateGhost(domain::Face::iMinus);
+    ref.updateGhost(domain::Face::iPlus);
+    d.updateGhostsThen(domain::Face::iMinus, flux, noWork);
+    expectSameGhosts(ref, d, domain::Face::iMinus);
+    expectSameGhosts(ref, d, domain::Face::iPlus);
+
+    ASSERT_EQ(d.getSweepGhosts(0), 1);
+    ASSERT_EQ(d.getSweepGhosts(2), 2);
+
+    // periodic one processor wide, so both layers are from this domain
+    d.updateGhostsThen(domain::Face::kMinus, flux, noWork);
+    ASSERT_EQ(d.getSweepGhosts(0), 2);
+    ASSERT_EQ(d.getSweepGhosts(2), 1);
+
+    for (auto n = 0; n < NN; n++) {
+        for (auto layer = 1; layer <= 2; layer++) {
+            for (auto i = 0; i < NI; i++) {
+                for (auto j = 0; j < NJ; j++) {
+                    ASSERT_TRUE(d.s[n].at(i, j, -layer) == d.s[n].at(i, j, NK - layer));
+                    ASSERT_TRUE(d.s[n].at(i, j, NK + layer - 1) == d.s[n].at(i, j, layer - 1));
+                }
+            }
+        }
+    }
+
+    // the next sweep does not exchange, so changes to the ghost cells are kept
+    d.s[0].at(0, 0, -1).clear();
+    d.s[0].at(0, 0, NK - 1) = svec::SVector(svec::Element{3, 0.5});
+    d.updateGhostsThen(domain::Face::kMinus, flux, noWork);
+    ASSERT_TRUE(d.s[0].at(0, 0, -1).isEmpty());
+    ASSERT_EQ(d.getSweepGhosts(2), 2);
+
+    // until the ghost cells are invalidated
+    d.invalidateGhosts();
+    d.updateGhostsThen(domain::Face::kMinus, flux, noWork);
+    ASSERT_TRUE(d.s[0].at(0, 0, -1) == d.s[0].at(0, 0, NK - 1));
+}
+
+TEST(MPIDomainTests, SharedMemoryMixed)
+{
+    // pairs of processes share memory, and the others exchange as if on another node
+    domain::HaloSettings settings;
+    settings.backend = domain::Backend::sharedMemory;
+    settings.sharedRanks = 2;
+
+    compareWithDefault(settings);
+    compareRepeated(settings);
+
+    settings.delta = true;
+    compareDelta(settings);
+}
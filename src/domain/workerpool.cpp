@@ -0,0 +1,83 @@
+#include "workerpool.h"
+
+#include <algorithm>
+
+using namespace domain;
+
+WorkerPool::WorkerPool(const int& size)
+{
+    const int extra = std::max(size, 1) - 1;
+
+    threads.reserve(extra);
+    for (auto t = 1; t <= extra; ++t) {
+        threads.emplace_back(&WorkerPool::loop, this, t);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    started.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(const std::function<void(const int&)>& job_in)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &job_in;
+        running = threads.size();
+        error = nullptr;
+        ++generation;
+    }
+    started.notify_all();
+
+    std::exception_ptr own;
+    try {
+        job_in(0);
+    }
+    catch (...) {
+        own = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    job = nullptr;
+
+    if (!own) own = error;
+    error = nullptr;
+    if (own) std::rethrow_exception(own);
+}
+
+void WorkerPool::loop(const int& t)
+{
+    unsigned long done = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        started.wait(lock, [this, done] { return generation != done || stop; });
+        if (stop) return;
+
+        done = generation;
+        const auto& current = *job;
+        lock.unlock();
+
+        try {
+            current(t);
+        }
+        catch (...) {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            lock.unlock();
+        }
+
+        lock.lock();
+        if (--running == 0) finished.notify_one();
+    }
+}
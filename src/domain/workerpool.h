@@ -0,0 +1,72 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace domain {
+
+/**
+ * @brief A fixed set of threads, kept between calls, which run the same job together
+ *
+ * The calling thread takes part in each run(), so a pool of size \f$T\f$ starts \f$T-1\f$
+ * threads.
+ */
+class WorkerPool {
+  public:
+    /**
+     * @param size The number of threads running each job, including the calling thread, at least 1
+     */
+    explicit WorkerPool(const int& size);
+
+    /** @brief Stops the threads */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /** @brief The number of threads running each job, including the calling thread */
+    int size() const
+    {
+        return threads.size() + 1;
+    }
+
+    /**
+     * @brief Call `job(t)` for each `t` from `0` to size()-1 at once, each on a different thread,
+     * and wait for all to return
+     *
+     * `job(0)` runs on the calling thread.
+     *
+     * @throws The first exception thrown by any of the calls, once all have returned
+     */
+    void run(const std::function<void(const int&)>& job);
+
+  private:
+    /** @brief The loop of the thread running `job(t)` */
+    void loop(const int& t);
+
+    std::mutex mutex;
+
+    // signaled when a job starts or on stop, and when a thread finishes its part
+    std::condition_variable started;
+    std::condition_variable finished;
+
+    // the current job, counted so each thread runs it once, and the threads still running it
+    const std::function<void(const int&)>* job = nullptr;
+    unsigned long generation = 0;
+    int running = 0;
+    bool stop = false;
+
+    // the first exception thrown by the current job
+    std::exception_ptr error;
+
+    std::vector<std::thread> threads;
+};
+
+} // namespace domain
+
+#endif
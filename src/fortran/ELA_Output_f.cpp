@@ -1,5 +1,8 @@
 #include "fortran.h"
 #include <ELA_Output.h>
+#include <globalVariables.h>
+
+#include <vector>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +31,33 @@ void F90_NAME(ela_output, ELA_OUTPUT)(
     );
 }
 
+void F90_NAME(ela_outputall, ELA_OUTPUTALL)(
+    F90_IntArray labels, 
+    F90_RealArray f,
+    F90_RealArray dV, 
+    F90_Int t_num, 
+    F90_Real time, 
+    F90_CharArray folders,
+    F90_Int folder_len,
+    F90_Int write_log)
+{
+    // one folder of folder_len characters for each ELA instance
+    std::vector<const char*> folderPtrs;
+    for (auto n = 0; n < ela::dom->nn; ++n) {
+        folderPtrs.push_back(F90_PassCharArray(folders) + n * F90_PassInt(folder_len));
+    }
+
+    ELA_OutputAll(
+        F90_PassIntArray(labels),
+        F90_PassRealArray(f),
+        F90_PassRealArray(dV),
+        F90_PassInt(t_num),
+        F90_PassReal(time),
+        folderPtrs.data(),
+        F90_PassInt(write_log) != 0
+    );
+}
+
 void F90_NAME(ela_outputwritev, ELA_OUTPUTWRITEV)(
     F90_RealArray f, 
     F90_IntArray labels, 
@@ -78,6 +108,138 @@ void F90_NAME(ela_outputlog,ELA_OUTPUTLOG)(
     );
 }
 
+void F90_NAME(ela_outputgetvtm, ELA_OUTPUTGETVTM)(
+    F90_IntArray labels, 
+    F90_RealArray dV, 
+    F90_Int num,
+    F90_Int first_row,
+    F90_Int rc,
+    F90_Int nnz)
+{
+    ELA_OutputGetVTM(
+        F90_PassIntArray(labels),
+        F90_PassRealArray(dV),
+        F90_PassInt(num)-1,
+        first_row,
+        rc,
+        nnz,
+        nullptr,
+        nullptr,
+        nullptr
+    );
+}
+
+void F90_NAME(ela_outputcopyvtm, ELA_OUTPUTCOPYVTM)(
+    F90_IntArray row_index, 
+    F90_IntArray column_index, 
+    F90_RealArray values)
+{
+    ELA_OutputCopyVTM(
+        (uint32_t*) F90_PassIntArray(row_index),
+        (uint32_t*) F90_PassIntArray(column_index),
+        F90_PassRealArray(values)
+    );
+}
+
+void F90_NAME(ela_outputgetv, ELA_OUTPUTGETV)(
+    F90_RealArray f, 
+    F90_IntArray labels, 
+    F90_RealArray dV,
+    F90_Int rc)
+{
+    ELA_OutputGetV(
+        F90_PassRealArray(f),
+        F90_PassIntArray(labels),
+        F90_PassRealArray(dV),
+        rc,
+        nullptr
+    );
+}
+
+void F90_NAME(ela_outputcopyv, ELA_OUTPUTCOPYV)(F90_RealArray values)
+{
+    ELA_OutputCopyV(
+        F90_PassRealArray(values)
+    );
+}
+
+void F90_NAME(ela_setoutputasync,ELA_SETOUTPUTASYNC)(F90_Int async)
+{
+    ELA_SetOutputAsync(
+        F90_PassInt(async)
+    );
+}
+
+void F90_NAME(ela_setoutputdistributed,ELA_SETOUTPUTDISTRIBUTED)(F90_Int distributed)
+{
+    ELA_SetOutputDistributed(
+        F90_PassInt(distributed)
+    );
+}
+
+void F90_NAME(ela_setoutputloginterval,ELA_SETOUTPUTLOGINTERVAL)(F90_Int interval)
+{
+    ELA_SetOutputLogInterval(
+        F90_PassInt(interval)
+    );
+}
+
+void F90_NAME(ela_setoutputmatrixencoding,ELA_SETOUTPUTMATRIXENCODING)(F90_Int encoding)
+{
+    ELA_SetOutputMatrixEncoding(
+        F90_PassInt(encoding)
+    );
+}
+
+void F90_NAME(ela_setoutputcontainer,ELA_SETOUTPUTCONTAINER)(F90_Int container)
+{
+    ELA_SetOutputContainer(
+        F90_PassInt(container)
+    );
+}
+
+void F90_NAME(ela_setoutputevents,ELA_SETOUTPUTEVENTS)(F90_Int events)
+{
+    ELA_SetOutputEvents(
+        F90_PassInt(events)
+    );
+}
+
+void F90_NAME(ela_setoutputeventthresholds,ELA_SETOUTPUTEVENTTHRESHOLDS)(
+    F90_Real min_volume,
+    F90_Real min_fraction)
+{
+    ELA_SetOutputEventThresholds(
+        F90_PassReal(min_volume),
+        F90_PassReal(min_fraction)
+    );
+}
+
+void F90_NAME(ela_setoutputthreads,ELA_SETOUTPUTTHREADS)(F90_Int threads)
+{
+    ELA_SetOutputThreads(
+        F90_PassInt(threads)
+    );
+}
+
+void F90_NAME(ela_setoutputbackground,ELA_SETOUTPUTBACKGROUND)(F90_Int maxQueued)
+{
+    ELA_SetOutputBackground(
+        F90_PassInt(maxQueued)
+    );
+}
+
+void F90_NAME(ela_outputpending,ELA_OUTPUTPENDING)(
+    F90_Int out)
+{
+    *out = ELA_OutputPending();
+}
+
+void F90_NAME(ela_outputflush,ELA_OUTPUTFLUSH)()
+{
+    ELA_OutputFlush();
+}
+
 
 #ifdef __cplusplus
 }
@@ -6,6 +6,48 @@ extern "C" {
 #endif
 // clang-format off
 
+void F90_NAME(ela_sethaloencoding,ELA_SETHALOENCODING)(F90_Int encoding)
+{
+    ELA_SetHaloEncoding(
+        F90_PassInt(encoding)
+    );
+}
+
+void F90_NAME(ela_sethalobackend,ELA_SETHALOBACKEND)(F90_Int backend)
+{
+    ELA_SetHaloBackend(
+        F90_PassInt(backend)
+    );
+}
+
+void F90_NAME(ela_sethaloupwindonly,ELA_SETHALOUPWINDONLY)(F90_Int upwindOnly)
+{
+    ELA_SetHaloUpwindOnly(
+        F90_PassInt(upwindOnly)
+    );
+}
+
+void F90_NAME(ela_sethalodelta,ELA_SETHALODELTA)(F90_Int delta)
+{
+    ELA_SetHaloDelta(
+        F90_PassInt(delta)
+    );
+}
+
+void F90_NAME(ela_sethalothreads,ELA_SETHALOTHREADS)(F90_Int threads)
+{
+    ELA_SetHaloThreads(
+        F90_PassInt(threads)
+    );
+}
+
+void F90_NAME(ela_sethalodepth,ELA_SETHALODEPTH)(F90_Int depth)
+{
+    ELA_SetHaloDepth(
+        F90_PassInt(depth)
+    );
+}
+
 #ifdef ELA_USE_MPI
 void F90_NAME(ela_init,ELA_INIT)(
     F90_IntArray N, 
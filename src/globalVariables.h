@@ -6,6 +6,7 @@
 #else
 #include "domain/domain.h"
 #endif
+#include "domain/settings.h"
 
 namespace ela {
 
@@ -19,6 +20,8 @@ extern DomainType* dom;
 
 extern int inputPad[6];
 
+extern domain::HaloSettings haloSettings;
+
 template <class T>
 fields::Helper<T> wrapField(T* in)
 {
@@ -40,6 +43,25 @@ fields::Helper<T> wrapRow(T* in, const int& d)
     return fields::Helper<T>(in, n, pad);
 }
 
+/**
+ * @brief Mark the ghost cells of \ref dom as out of date, after the cells are changed
+ *
+ */
+inline void invalidateGhosts()
+{
+#ifdef ELA_USE_MPI
+    dom->invalidateGhosts();
+#endif
+}
+
+/**
+ * @brief Forget the output state kept between calls, e.g., the last volumes of the event
+ * detectors, so a new run does not depend on the last
+ *
+ * @note Pending output must be flushed first
+ */
+void resetOutput();
+
 } // namespace ela
 
 #endif
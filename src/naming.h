@@ -5,6 +5,15 @@ Settings for binary tracking data output files
     Name Format: {VOLUME_VECTOR_FILENAME}[{t_num}].{VOLUME_VECTOR_FILENAME_EXT}
     Name Format: {TIMELOG_FILENAME}.{TIMELOG_FILENAME_EXT}
 
+Settings for the binary tracking data container, see ELA_SetOutputContainer()
+-----------------------------------------------------------------------------
+    Name Format: {CONTAINER_FILENAME}.{CONTAINER_DATA_EXT}
+    Name Format: {CONTAINER_FILENAME}.{CONTAINER_INDEX_EXT}
+
+Settings for the binary event log, see ELA_SetOutputEvents()
+---------------------------------------------------------
+    Name Format: {EVENTS_FILENAME}.{EVENTS_FILENAME_EXT}
+
 Settings for ascii tracking data output files
 ---------------------------------------------
     Name Format: {TRACKING_LOG_FILENAME}
@@ -35,4 +44,24 @@ Settings for ascii tracking data output files
 
 #ifndef TIMELOG_FILENAME_EXT
 #define TIMELOG_FILENAME_EXT "bin"
-#endif
\ No newline at end of file
+#endif
+
+#ifndef CONTAINER_FILENAME
+#define CONTAINER_FILENAME "tracking"
+#endif
+
+#ifndef CONTAINER_DATA_EXT
+#define CONTAINER_DATA_EXT "dat"
+#endif
+
+#ifndef CONTAINER_INDEX_EXT
+#define CONTAINER_INDEX_EXT "idx"
+#endif
+
+#ifndef EVENTS_FILENAME
+#define EVENTS_FILENAME "events"
+#endif
+
+#ifndef EVENTS_FILENAME_EXT
+#define EVENTS_FILENAME_EXT "bin"
+#endif
@@ -1,86 +1,209 @@
 #include "asciilog.h"
 
+#include <algorithm>
+
 using namespace output;
 
 #ifdef ELA_USE_MPI
 ASCIILog::ASCIILog(MPI_Comm comm_in)
-    : comm(comm_in),
+    : comm(comm_in), started(false), request(MPI_REQUEST_NULL),
 #else
 ASCIILog::ASCIILog()
     :
 #endif
-      maxLabel(0), maxValue(0.0), minValue(std::numeric_limits<svec::Value>::max()), maxNNZ(0),
-      volELA(0), volVOF(0)
+      stats(1)
 {
 }
 
 void output::ASCIILog::addCell(const svec::SVector& s, const double dV, const double f)
 {
-    maxLabel = std::max(maxLabel, s.getMaxLabel());
-    maxValue = std::max(maxValue, s.getMaxValue());
-    minValue = std::min(minValue, s.getMinValue());
+    addCell(stats.size() - 1, s, dV, f);
+}
+
+void output::ASCIILog::addCell(
+    const std::size_t& snapshot, const svec::SVector& s, const double dV, const double f
+)
+{
+    auto& st = stats[snapshot];
+
+    st.maxLabel = std::max(st.maxLabel, s.getMaxLabel());
+    st.maxValue = std::max(st.maxValue, s.getMaxValue());
+    st.minValue = std::min(st.minValue, s.getMinValue());
 
-    volELA += dV * s.sum();
-    volVOF += dV * f;
+    st.volELA += dV * s.sum();
+    st.volVOF += dV * f;
 
-    maxNNZ = std::max(maxNNZ, s.NNZ());
+    st.maxNNZ = std::max(st.maxNNZ, s.NNZ());
 }
 
-// MPI calls assume the types of svec
-static_assert(std::is_same<svec::Label, unsigned int>::value);
-static_assert(std::is_same<svec::Value, double>::value);
-static_assert(std::is_same<std::size_t, unsigned long>::value);
+// combine the statistics a in with those in b
+static void combine(const LogStatistics& a, LogStatistics& b)
+{
+    b.maxLabel = std::max(a.maxLabel, b.maxLabel);
+    b.maxValue = std::max(a.maxValue, b.maxValue);
+    b.minValue = std::min(a.minValue, b.minValue);
+    b.maxNNZ = std::max(a.maxNNZ, b.maxNNZ);
+    b.volELA = a.volELA + b.volELA;
+    b.volVOF = a.volVOF + b.volVOF;
+}
+
+void output::ASCIILog::merge(const ASCIILog& part)
+{
+    assert(part.stats.size() <= stats.size());
+
+    const std::size_t offset = stats.size() - part.stats.size();
+    for (std::size_t n = 0; n < part.stats.size(); ++n) {
+        combine(part.stats[n], stats[offset + n]);
+    }
+}
+
+void output::ASCIILog::startSnapshot()
+{
+    stats.emplace_back();
+}
+
+#ifdef ELA_USE_MPI
+// combine the statistics in with those in inout
+static void reduceStatistics(void* in, void* inout, int* len, MPI_Datatype*)
+{
+    const auto a = reinterpret_cast<const LogStatistics*>(in);
+    const auto b = reinterpret_cast<LogStatistics*>(inout);
+
+    for (auto i = 0; i < *len; ++i) {
+        combine(a[i], b[i]);
+    }
+}
+
+// the MPI datatype and reduction of LogStatistics, created on first use and freed by freeTypes()
+static MPI_Datatype statisticsType = MPI_DATATYPE_NULL;
+static MPI_Op statisticsOp = MPI_OP_NULL;
+
+// the MPI datatype of LogStatistics
+static MPI_Datatype getStatisticsType()
+{
+    if (statisticsType == MPI_DATATYPE_NULL) {
+        MPI_Type_contiguous(sizeof(LogStatistics), MPI_BYTE, &statisticsType);
+        MPI_Type_commit(&statisticsType);
+    }
+    return statisticsType;
+}
+
+// the reduction of LogStatistics
+static MPI_Op getStatisticsOp()
+{
+    if (statisticsOp == MPI_OP_NULL) MPI_Op_create(&reduceStatistics, 1, &statisticsOp);
+    return statisticsOp;
+}
+
+void output::ASCIILog::freeTypes()
+{
+    if (statisticsType != MPI_DATATYPE_NULL) MPI_Type_free(&statisticsType);
+    if (statisticsOp != MPI_OP_NULL) MPI_Op_free(&statisticsOp);
+}
+#endif
 
 void output::ASCIILog::finalize()
+{
+    startFinalize();
+    while (!continueFinalize()) {
+    }
+}
+
+void output::ASCIILog::startFinalize()
 {
 #ifdef ELA_USE_MPI
     // figure out the rank
     MPI_Comm_rank(comm, &rank);
+
+    // all statistics of all snapshots at once
+    const int count = static_cast<int>(stats.size());
     if (rank == 0) {
-        // clang-format off
-        MPI_Reduce(MPI_IN_PLACE, &maxLabel, 1, MPI_UNSIGNED,      MPI_MAX, 0, comm);
-        MPI_Reduce(MPI_IN_PLACE, &maxValue, 1, MPI_DOUBLE,        MPI_MAX, 0, comm);
-        MPI_Reduce(MPI_IN_PLACE, &minValue, 1, MPI_DOUBLE,        MPI_MIN, 0, comm);
-        MPI_Reduce(MPI_IN_PLACE, &maxNNZ,   1, MPI_UNSIGNED_LONG, MPI_MAX, 0, comm);
-        MPI_Reduce(MPI_IN_PLACE, &volELA,   1, MPI_DOUBLE,        MPI_SUM, 0, comm);
-        MPI_Reduce(MPI_IN_PLACE, &volVOF,   1, MPI_DOUBLE,        MPI_SUM, 0, comm);
-        // clang-format on
+        MPI_Ireduce(
+            MPI_IN_PLACE, stats.data(), count, getStatisticsType(), getStatisticsOp(), 0, comm,
+            &request
+        );
     }
     else {
-        // clang-format off
-        MPI_Reduce(&maxLabel,    nullptr,   1, MPI_UNSIGNED,      MPI_MAX, 0, comm);
-        MPI_Reduce(&maxValue,    nullptr,   1, MPI_DOUBLE,        MPI_MAX, 0, comm);
-        MPI_Reduce(&minValue,    nullptr,   1, MPI_DOUBLE,        MPI_MIN, 0, comm);
-        MPI_Reduce(&maxNNZ,      nullptr,   1, MPI_UNSIGNED_LONG, MPI_MAX, 0, comm);
-        MPI_Reduce(&volELA,      nullptr,   1, MPI_DOUBLE,        MPI_SUM, 0, comm);
-        MPI_Reduce(&volVOF,      nullptr,   1, MPI_DOUBLE,        MPI_SUM, 0, comm);
-        // clang-format on
+        MPI_Ireduce(
+            stats.data(), nullptr, count, getStatisticsType(), getStatisticsOp(), 0, comm, &request
+        );
     }
+    started = true;
 #endif
 }
 
-void output::ASCIILog::write(const char* filename, const double& time)
+bool output::ASCIILog::continueFinalize()
 {
 #ifdef ELA_USE_MPI
-    // Only rank==0 does anything
-    if (rank != 0) return;
+    int done;
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    return done;
+#else
+    return true;
 #endif
+}
+
+bool output::ASCIILog::hasCollectivesToStart() const
+{
+#ifdef ELA_USE_MPI
+    return !started;
+#else
+    return false;
+#endif
+}
+
+void output::ASCIILog::write(const char* filename, const double& time)
+{
+    assert(stats.size() == 1);
+    write(filename, &time);
+}
+
+std::string output::ASCIILog::formatLine(const std::size_t& n, const double& time) const
+{
+    const auto& st = stats[n];
 
     // format text
     constexpr std::size_t buffLength = 128;
     char buff[buffLength];
 
     snprintf(
-        buff, buffLength, "%15.6E%18u%18.7E%18.7E%18.7E%18.7E%9lu", time, maxLabel, 1.0 - maxValue,
-        minValue, (volELA - volVOF), (volELA - volVOF) / volVOF, maxNNZ
+        buff, buffLength, "%15.6E%18u%18.7E%18.7E%18.7E%18.7E%9lu", time, st.maxLabel,
+        1.0 - st.maxValue, st.minValue, (st.volELA - st.volVOF),
+        (st.volELA - st.volVOF) / st.volVOF, st.maxNNZ
     );
 
+    return std::string(buff);
+}
+
+void output::ASCIILog::write(const char* filename, const double* times)
+{
+#ifdef ELA_USE_MPI
+    // Only rank==0 does anything
+    if (rank != 0) return;
+#endif
+
     // Open file
     std::ofstream outputFile(filename, std::ios::out | std::ios::binary | std::ios::app);
 
-    // write
-    outputFile << std::string(buff) << std::endl;
+    for (std::size_t n = 0; n < stats.size(); ++n) {
+        // write
+        outputFile << formatLine(n, times[n]) << std::endl;
+    }
 
     // close file
     outputFile.close();
 }
+
+void output::ASCIILog::writeSnapshot(
+    const char* filename, const std::size_t& snapshot, const double& time
+)
+{
+#ifdef ELA_USE_MPI
+    // Only rank==0 does anything
+    if (rank != 0) return;
+#endif
+
+    std::ofstream outputFile(filename, std::ios::out | std::ios::binary | std::ios::app);
+    outputFile << formatLine(snapshot, time) << std::endl;
+    outputFile.close();
+}
@@ -6,9 +6,36 @@
 
 #include <cstdio>
 #include <limits>
+#include <string>
+#include <vector>
 
 namespace output {
 
+/**
+ * @brief The statistics of a single snapshot in the ASCIILog
+ *
+ * All are reduced together, see ASCIILog::startFinalize().
+ */
+struct LogStatistics {
+    // largest label
+    svec::Label maxLabel = 0;
+
+    // largest value in any s
+    svec::Value maxValue = 0.0;
+
+    // smallest (non-zero) value in any s
+    svec::Value minValue = std::numeric_limits<svec::Value>::max();
+
+    // max NNZ of any s
+    std::size_t maxNNZ = 0;
+
+    // sum of all ELA volume
+    double volELA = 0;
+
+    // sum of all VOF volume
+    double volVOF = 0;
+};
+
 class ASCIILog {
   public:
 #ifdef ELA_USE_MPI
@@ -19,33 +46,93 @@ class ASCIILog {
 
     void addCell(const svec::SVector& s, const double dV, const double f);
 
+    /** @brief Add a cell to \p snapshot, rather than the last */
+    void addCell(
+        const std::size_t& snapshot, const svec::SVector& s, const double dV, const double f
+    );
+
+    /**
+     * @brief Add the cells added to the snapshots of \p part to the same number of last snapshots
+     *
+     * @see VolumeTrackingMatrix::merge()
+     */
+    void merge(const ASCIILog& part);
+
+    /**
+     * @brief Start the statistics of another snapshot, later calls to addCell() add to it
+     *
+     * The statistics of all snapshots are reduced together by finalize().
+     */
+    void startSnapshot();
+
+#ifdef ELA_USE_MPI
+    /**
+     * @brief Free the MPI datatype and reduction of the statistics, which are created by the first
+     * startFinalize() and kept for the later ones
+     *
+     * @note No reductions may be in progress
+     */
+    static void freeTypes();
+#endif
+
+    /** @brief The number of snapshots, including the one being added to */
+    std::size_t getSnapshotCount() const
+    {
+        return stats.size();
+    }
+
     void finalize();
 
+    /**
+     * @brief Start the reductions of finalize() without waiting for them
+     *
+     * The statistics of every snapshot are reduced with a single reduction, using a user-defined
+     * `MPI_Op`.
+     *
+     * @note Under MPI this starts non-blocking collectives, so it and continueFinalize() must be
+     * called in the same order on every process, relative to other collectives on the
+     * communicator.
+     */
+    void startFinalize();
+
+    /**
+     * @brief Test if the reductions started by startFinalize() are complete, without blocking
+     *
+     * @return true Once the reductions are complete, and write() can be called
+     */
+    bool continueFinalize();
+
+    /**
+     * @brief Whether the reduction is still to be started by startFinalize()
+     *
+     * @see VolumeVector::hasCollectivesToStart()
+     */
+    bool hasCollectivesToStart() const;
+
+    /** @brief Write the line of the only snapshot, at \p time */
     void write(const char* filename, const double& time);
 
+    /** @brief Write a line for each snapshot, at \p times (one for each snapshot) */
+    void write(const char* filename, const double* times);
+
+    /** @brief Write the line of \p snapshot only, at \p time */
+    void writeSnapshot(const char* filename, const std::size_t& snapshot, const double& time);
+
   private:
 #ifdef ELA_USE_MPI
     const MPI_Comm comm;
     int rank;
-#endif
-
-    // largest label
-    svec::Label maxLabel;
 
-    // largest value in any s
-    svec::Value maxValue;
-
-    // smallest (non-zero) value in any s
-    svec::Value minValue;
-
-    // max NNZ of any s
-    std::size_t maxNNZ;
+    // whether the reduction is started, and its request
+    bool started;
+    MPI_Request request;
+#endif
 
-    // sum of all ELA volume
-    double volELA;
+    // the statistics of each snapshot
+    std::vector<LogStatistics> stats;
 
-    // sum of all VOF volume
-    double volVOF;
+    // the line of snapshot n, at time
+    std::string formatLine(const std::size_t& n, const double& time) const;
 };
 
 } // namespace output
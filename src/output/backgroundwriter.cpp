@@ -0,0 +1,71 @@
+#include "backgroundwriter.h"
+
+#include <algorithm>
+
+using namespace output;
+
+BackgroundWriter::BackgroundWriter(const std::size_t& maxQueued_in)
+    : maxQueued(std::max<std::size_t>(maxQueued_in, 1)), busy(false), stop(false),
+      thread(&BackgroundWriter::run, this)
+{
+}
+
+BackgroundWriter::~BackgroundWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    added.notify_one();
+    thread.join();
+}
+
+void BackgroundWriter::submit(std::function<void()> job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        removed.wait(lock, [this] { return jobs.size() < maxQueued; });
+        jobs.push_back(std::move(job));
+    }
+    added.notify_one();
+}
+
+void BackgroundWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    removed.wait(lock, [this] { return jobs.empty() && !busy; });
+
+    if (error) {
+        auto e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void BackgroundWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        added.wait(lock, [this] { return !jobs.empty() || stop; });
+        if (jobs.empty()) return;
+
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+        removed.notify_all();
+
+        try {
+            job();
+        }
+        catch (...) {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            lock.unlock();
+        }
+
+        lock.lock();
+        busy = false;
+        removed.notify_all();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef BACKGROUND_WRITER_H
+#define BACKGROUND_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace output {
+
+/**
+ * @brief Runs jobs (e.g., writing a file) in order on a background thread
+ *
+ * At most a fixed number of jobs wait in the queue, so the memory held by them is bounded. Once
+ * the queue is full, submit() blocks until the oldest job starts.
+ *
+ * @warning Jobs run on another thread, so must not make MPI calls.
+ */
+class BackgroundWriter {
+  public:
+    /**
+     * @param maxQueued The most jobs waiting to start, at least 1
+     */
+    explicit BackgroundWriter(const std::size_t& maxQueued);
+
+    /** @brief Waits for all jobs, then stops the thread */
+    ~BackgroundWriter();
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    /** @brief Add \p job to the end of the queue, waiting for room if it is full */
+    void submit(std::function<void()> job);
+
+    /**
+     * @brief Wait until every job submitted is complete
+     *
+     * @throws The first exception thrown by a job since the last wait(), if any
+     */
+    void wait();
+
+  private:
+    /** @brief The loop of the background thread */
+    void run();
+
+    const std::size_t maxQueued;
+
+    std::mutex mutex;
+
+    // signaled when a job is added or on stop, and when a job starts or finishes
+    std::condition_variable added;
+    std::condition_variable removed;
+
+    // jobs waiting to start, whether one is running, and whether to stop once the queue is empty
+    std::deque<std::function<void()>> jobs;
+    bool busy;
+    bool stop;
+
+    // the first exception thrown by a job
+    std::exception_ptr error;
+
+    std::thread thread;
+};
+
+} // namespace output
+
+#endif
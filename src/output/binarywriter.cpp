@@ -0,0 +1,135 @@
+#include "binarywriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace output;
+
+// round x up to a multiple of BinaryWriter::alignment
+static std::size_t alignUp(const std::size_t& x)
+{
+    return (x + BinaryWriter::alignment - 1) / BinaryWriter::alignment * BinaryWriter::alignment;
+}
+
+BinaryWriter::BinaryWriter(
+    const char* filename, const bool& append, const bool& direct_in, const std::size_t& chunkSize
+)
+    : fd(-1), direct(false), offset(0), chunk(alignUp(std::max<std::size_t>(chunkSize, 1))),
+      buff(
+          static_cast<unsigned char*>(std::aligned_alloc(alignment, chunk)),
+          [](void* ptr) { std::free(ptr); }
+      ),
+      len(0)
+{
+    if (!buff) throw std::bad_alloc();
+
+    int flags = O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC);
+#ifdef O_DIRECT
+    // the end of an existing file may not be aligned
+    direct = (direct_in && !append);
+    if (direct) flags |= O_DIRECT;
+#endif
+
+    fd = ::open(filename, flags, 0644);
+#ifdef O_DIRECT
+    if (fd < 0 && direct) {
+        // not supported by the file system
+        direct = false;
+        fd = ::open(filename, flags & ~O_DIRECT, 0644);
+    }
+#endif
+    if (fd < 0) {
+        throw std::runtime_error(
+            "Unable to open " + std::string(filename) + ": " + std::strerror(errno)
+        );
+    }
+
+    if (append) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0) offset = st.st_size;
+    }
+}
+
+BinaryWriter::~BinaryWriter()
+{
+    // errors can not be reported here, call close() to get them
+    try {
+        close();
+    }
+    catch (const std::exception&) {
+    }
+}
+
+void BinaryWriter::writeBytes(const void* data, const std::size_t& n)
+{
+    auto ptr = static_cast<const unsigned char*>(data);
+    std::size_t remaining = n;
+
+    // large data goes straight to the file, unless it must be copied to be aligned
+    if (!direct && len == 0 && remaining >= chunk) {
+        writeToFile(ptr, remaining);
+        return;
+    }
+
+    while (remaining > 0) {
+        const std::size_t count = std::min(remaining, chunk - len);
+        std::memcpy(buff.get() + len, ptr, count);
+        len += count;
+        ptr += count;
+        remaining -= count;
+
+        if (len == chunk) {
+            writeToFile(buff.get(), len);
+            len = 0;
+        }
+    }
+}
+
+void BinaryWriter::flush()
+{
+    if (len == 0) return;
+
+#ifdef O_DIRECT
+    if (direct) {
+        // the remainder is not a full chunk, so can not be written directly
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_DIRECT);
+        direct = false;
+    }
+#endif
+
+    writeToFile(buff.get(), len);
+    len = 0;
+}
+
+void BinaryWriter::close()
+{
+    if (fd < 0) return;
+
+    flush();
+    ::close(fd);
+    fd = -1;
+}
+
+void BinaryWriter::writeToFile(const void* data, const std::size_t& n)
+{
+    auto ptr = static_cast<const char*>(data);
+    std::size_t remaining = n;
+
+    while (remaining > 0) {
+        const ssize_t written = ::pwrite(fd, ptr, remaining, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("Unable to write: ") + std::strerror(errno));
+        }
+        ptr += written;
+        offset += written;
+        remaining -= written;
+    }
+}
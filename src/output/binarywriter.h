@@ -0,0 +1,109 @@
+#ifndef BINARY_WRITER_H
+#define BINARY_WRITER_H
+
+#include <cstddef>
+#include <memory>
+
+namespace output {
+
+/**
+ * @brief Writes a binary file in large chunks
+ *
+ * Data is collected in an aligned buffer, and written with `pwrite()` once a chunk is full, so a
+ * file made of many small values is written with a few large writes. Data larger than a chunk is
+ * written directly, without copying.
+ *
+ * Optionally, full chunks bypass the page cache with `O_DIRECT` (where supported), which
+ * requires the buffer, chunk size and file offset to be aligned. The remainder at the end of the
+ * file is written without it. `O_DIRECT` is not used when appending.
+ */
+class BinaryWriter {
+  public:
+    /** @brief The default size of a chunk (in bytes) */
+    static constexpr std::size_t defaultChunkSize = 1 << 22;
+
+    /** @brief The alignment of the buffer and chunks, suitable for `O_DIRECT` */
+    static constexpr std::size_t alignment = 4096;
+
+    /**
+     * @brief Open \p filename for writing
+     *
+     * @throws std::runtime_error If the file can not be opened
+     *
+     * @param filename The file to write
+     * @param append If true, data is added to the end of the file, else the file is truncated
+     * @param direct If true, use `O_DIRECT`
+     * @param chunkSize The size of a chunk (in bytes), rounded up to a multiple of \ref alignment
+     */
+    BinaryWriter(
+        const char* filename, const bool& append = false, const bool& direct = false,
+        const std::size_t& chunkSize = defaultChunkSize
+    );
+
+    /** @brief Calls close(), ignoring any errors */
+    ~BinaryWriter();
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    /**
+     * @brief Write \p len bytes from \p data
+     *
+     * @throws std::runtime_error If a chunk can not be written
+     */
+    void writeBytes(const void* data, const std::size_t& len);
+
+    /** @brief Write \p count values from \p data */
+    template <class T>
+    void write(const T* data, const std::size_t& count)
+    {
+        writeBytes(data, count * sizeof(T));
+    }
+
+    /** @brief Write a single value */
+    template <class T>
+    void write(const T& x)
+    {
+        writeBytes(&x, sizeof(T));
+    }
+
+    /** @brief The position in the file of the next byte written */
+    long long tell() const noexcept
+    {
+        return offset + static_cast<long long>(len);
+    }
+
+    /** @brief Write any buffered data to the file */
+    void flush();
+
+    /**
+     * @brief Flush and close the file, further writes are not allowed
+     *
+     * @throws std::runtime_error If the data can not be written
+     */
+    void close();
+
+  private:
+    /** @brief Write \p len bytes at the end of the file */
+    void writeToFile(const void* data, const std::size_t& len);
+
+    // the file descriptor, or -1 once closed
+    int fd;
+
+    // whether O_DIRECT is in use
+    bool direct;
+
+    // where the next write goes in the file
+    long long offset;
+
+    // the size of a chunk
+    const std::size_t chunk;
+
+    // the buffer (a single chunk) and how much of it is used
+    std::unique_ptr<unsigned char, void (*)(void*)> buff;
+    std::size_t len;
+};
+
+} // namespace output
+
+#endif
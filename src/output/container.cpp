@@ -0,0 +1,169 @@
+#include "container.h"
+#include "matrixencoding.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace output;
+
+/*
+Container format (version 1)
+----------------------------
+Data file:
+    magic                       "ELAD"
+    version                     uint32_t
+    snapshots                   each the same bytes as the file it replaces
+
+Index file:
+    magic                       "ELAI"
+    version                     uint32_t
+    entries                     ContainerEntry (40 bytes), one for each snapshot, in the order
+                                written
+*/
+
+ContainerWriter::ContainerWriter(std::string dataFilename_in, std::string indexFilename_in)
+    : dataFilename(std::move(dataFilename_in)), indexFilename(std::move(indexFilename_in))
+{
+}
+
+// write the header of a new file
+static void writeHeader(BinaryWriter& file, const char (&magic)[4])
+{
+    if (file.tell() != 0) return;
+
+    file.write(magic, sizeof(magic));
+    file.write(containerVersion);
+}
+
+void ContainerWriter::open()
+{
+    if (data) return;
+
+    data = std::make_unique<BinaryWriter>(dataFilename.c_str(), true);
+    writeHeader(*data, containerDataMagic);
+
+    // the index is written an entry at a time, so only needs a small buffer
+    index = std::make_unique<BinaryWriter>(
+        indexFilename.c_str(), true, false, sizeof(ContainerEntry)
+    );
+    writeHeader(*index, containerIndexMagic);
+}
+
+void ContainerWriter::close()
+{
+    if (!data) return;
+
+    data->close();
+    index->close();
+    data.reset();
+    index.reset();
+}
+
+// check the header of a file of a container
+static void readHeader(std::ifstream& file, const char (&magic)[4], const char* filename)
+{
+    char fileMagic[sizeof(magic)];
+    Int_BinType version;
+    file.read(fileMagic, sizeof(fileMagic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+    if (!file || std::memcmp(fileMagic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(std::string(filename) + " is not a container file");
+    }
+    if (version != containerVersion) {
+        throw std::runtime_error(
+            std::string(filename) + " has unsupported container version " + std::to_string(version)
+        );
+    }
+}
+
+ContainerReader::ContainerReader(const char* dataFilename_in, const char* indexFilename)
+    : dataFilename(dataFilename_in)
+{
+    std::ifstream data(dataFilename, std::ios::binary);
+    if (!data) throw std::runtime_error("Unable to open " + dataFilename);
+    readHeader(data, containerDataMagic, dataFilename_in);
+
+    std::ifstream index(indexFilename, std::ios::binary | std::ios::ate);
+    if (!index) throw std::runtime_error("Unable to open " + std::string(indexFilename));
+
+    // only complete entries
+    const auto fileSize = static_cast<std::size_t>(index.tellg());
+    index.seekg(0);
+    readHeader(index, containerIndexMagic, indexFilename);
+
+    entries.resize(
+        fileSize > containerHeaderSize
+            ? (fileSize - containerHeaderSize) / sizeof(ContainerEntry)
+            : 0
+    );
+    index.read(
+        reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(ContainerEntry)
+    );
+    if (!index) throw std::runtime_error("Unable to read " + std::string(indexFilename));
+}
+
+std::size_t ContainerReader::find(const SnapshotKind& kind, const int& t_num) const
+{
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].kind == static_cast<Int_BinType>(kind) &&
+            entries[i].t_num == static_cast<Int_BinType>(t_num)) {
+            return i;
+        }
+    }
+    return entries.size();
+}
+
+std::vector<char> ContainerReader::readSnapshot(
+    const std::size_t& i, const SnapshotKind& kind
+) const
+{
+    const auto& entry = getEntry(i);
+    if (entry.kind != static_cast<Int_BinType>(kind)) {
+        throw std::runtime_error("Snapshot " + std::to_string(i) + " is of a different kind");
+    }
+
+    std::vector<char> bytes(entry.size);
+
+    std::ifstream data(dataFilename, std::ios::binary);
+    data.seekg(static_cast<std::streamoff>(entry.offset));
+    data.read(bytes.data(), bytes.size());
+    if (!data) throw std::runtime_error("Unable to read snapshot " + std::to_string(i));
+
+    return bytes;
+}
+
+// copy count values of T from ptr, advancing it
+template <class T>
+static void readValues(const char*& ptr, std::vector<T>& values, const std::size_t& count)
+{
+    values.resize(count);
+    if (count != 0) std::memcpy(values.data(), ptr, count * sizeof(T));
+    ptr += count * sizeof(T);
+}
+
+void ContainerReader::readTrackingMatrix(
+    const std::size_t& i, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+) const
+{
+    const auto bytes = readSnapshot(i, SnapshotKind::trackingMatrix);
+
+    // either version of the file
+    decodeMatrix(bytes.data(), bytes.size(), rowIndex, columnIndex, values);
+}
+
+void ContainerReader::readVolumeVector(const std::size_t& i, std::vector<Fp_BinType>& values) const
+{
+    const auto bytes = readSnapshot(i, SnapshotKind::volumeVector);
+    const auto& entry = entries[i];
+
+    if (bytes.size() != sizeof(Int_BinType) + entry.rc * sizeof(Fp_BinType)) {
+        throw std::runtime_error("Snapshot " + std::to_string(i) + " has the wrong size");
+    }
+
+    // skip RC, which is in the entry
+    const char* ptr = bytes.data() + sizeof(Int_BinType);
+    readValues(ptr, values, entry.rc);
+}
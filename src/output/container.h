@@ -0,0 +1,198 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include "binarywriter.h"
+#include "output.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace output {
+
+/** @brief The kind of snapshot in a container */
+enum class SnapshotKind : Int_BinType
+{
+    /** @brief A volume tracking matrix, as in `afwd_[n].bin` */
+    trackingMatrix = 0,
+
+    /** @brief A volume vector, as in `v_[n].bin` */
+    volumeVector = 1
+};
+
+/**
+ * @brief The entry of a snapshot in the index of a container
+ *
+ * The layout has no padding, and is the same in the index file.
+ */
+struct ContainerEntry {
+    /** @brief The SnapshotKind */
+    Int_BinType kind;
+
+    /** @brief The snapshot index, \f$n\f$ */
+    Int_BinType t_num;
+
+    /** @brief The time of the snapshot, NaN if not known */
+    Fp_BinType time;
+
+    /** @brief The row count */
+    Int_BinType rc;
+
+    /** @brief The number of non-zeros, the row count for a volume vector */
+    Int_BinType nnz;
+
+    /** @brief Where the snapshot starts in the data file (in bytes) */
+    std::uint64_t offset;
+
+    /** @brief The size of the snapshot in the data file (in bytes) */
+    std::uint64_t size;
+};
+
+static_assert(sizeof(ContainerEntry) == 40, "ContainerEntry must not be padded");
+
+/** @brief The first bytes of the data file of a container */
+constexpr char containerDataMagic[4] = {'E', 'L', 'A', 'D'};
+
+/** @brief The first bytes of the index file of a container */
+constexpr char containerIndexMagic[4] = {'E', 'L', 'A', 'I'};
+
+/** @brief The version of the container format, following the magic bytes of each file */
+constexpr Int_BinType containerVersion = 1;
+
+/** @brief The size of the header of each file of a container (in bytes) */
+constexpr std::size_t containerHeaderSize = sizeof(containerDataMagic) + sizeof(Int_BinType);
+
+/**
+ * @brief Appends snapshots to a single data file, with an index of where each starts
+ *
+ * Each snapshot in the data file has the same bytes as the file it replaces (e.g.,
+ * `afwd_[n].bin`). Once a snapshot is written, its ContainerEntry is appended to the index, so a
+ * reader never sees an entry for a partly written snapshot.
+ *
+ * The files are opened by the first append() and kept open until close(), so there are no file
+ * opens per snapshot after the first. Existing files are appended to.
+ */
+class ContainerWriter {
+  public:
+    /**
+     * @param dataFilename The file the snapshots are written to
+     * @param indexFilename The file the index is written to
+     */
+    ContainerWriter(std::string dataFilename, std::string indexFilename);
+
+    ContainerWriter(const ContainerWriter&) = delete;
+    ContainerWriter& operator=(const ContainerWriter&) = delete;
+
+    /**
+     * @brief Append a snapshot, whose data is written by `write(BinaryWriter&)`
+     *
+     * @throws std::runtime_error If the files can not be written
+     *
+     * @param entry The entry of the snapshot, the offset and size are set here
+     * @param write Writes the data of the snapshot
+     */
+    template <class Write>
+    void append(ContainerEntry entry, Write write)
+    {
+        open();
+
+        // the data first, so the index is only written once it is complete
+        entry.offset = static_cast<std::uint64_t>(data->tell());
+        write(*data);
+        data->flush();
+        entry.size = static_cast<std::uint64_t>(data->tell()) - entry.offset;
+
+        index->write(entry);
+        index->flush();
+    }
+
+    /**
+     * @brief Close the files, a later append() opens them again
+     *
+     * @throws std::runtime_error If the files can not be written
+     */
+    void close();
+
+  private:
+    /** @brief Open the files, if not already, writing the headers of new files */
+    void open();
+
+    const std::string dataFilename;
+    const std::string indexFilename;
+
+    std::unique_ptr<BinaryWriter> data;
+    std::unique_ptr<BinaryWriter> index;
+};
+
+/**
+ * @brief Reads the snapshots written by ContainerWriter
+ *
+ * The index is read when constructed. An incomplete entry at the end of the index (e.g., if the
+ * writer was stopped while appending) is ignored.
+ */
+class ContainerReader {
+  public:
+    /**
+     * @throws std::runtime_error If the files can not be read, or are not containers
+     *
+     * @param dataFilename The file the snapshots were written to
+     * @param indexFilename The file the index was written to
+     */
+    ContainerReader(const char* dataFilename, const char* indexFilename);
+
+    /** @brief The number of snapshots */
+    std::size_t size() const noexcept
+    {
+        return entries.size();
+    }
+
+    /** @brief The entry of snapshot \p i, in the order written */
+    const ContainerEntry& getEntry(const std::size_t& i) const
+    {
+        return entries.at(i);
+    }
+
+    /**
+     * @brief The first snapshot of the \p kind at \p t_num
+     *
+     * @return std::size_t Its position, or size() if there is none
+     */
+    std::size_t find(const SnapshotKind& kind, const int& t_num) const;
+
+    /**
+     * @brief Read the volume tracking matrix of snapshot \p i in CSR format
+     *
+     * @throws std::runtime_error If snapshot \p i is not a volume tracking matrix, or can not be
+     * read
+     *
+     * @param[in] i The snapshot
+     * @param[out] rowIndex The row index, with the starting zero (RC+1 values)
+     * @param[out] columnIndex The column indices (NNZ values)
+     * @param[out] values The values (NNZ values)
+     */
+    void readTrackingMatrix(
+        const std::size_t& i, std::vector<Int_BinType>& rowIndex,
+        std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+    ) const;
+
+    /**
+     * @brief Read the volume vector of snapshot \p i
+     *
+     * @throws std::runtime_error If snapshot \p i is not a volume vector, or can not be read
+     *
+     * @param[in] i The snapshot
+     * @param[out] values The volume of each label (RC values)
+     */
+    void readVolumeVector(const std::size_t& i, std::vector<Fp_BinType>& values) const;
+
+  private:
+    /** @brief Read the data of snapshot \p i, checking it is of the \p kind */
+    std::vector<char> readSnapshot(const std::size_t& i, const SnapshotKind& kind) const;
+
+    const std::string dataFilename;
+    std::vector<ContainerEntry> entries;
+};
+
+} // namespace output
+
+#endif
@@ -0,0 +1,108 @@
+#include "events.h"
+#include "binarywriter.h"
+
+#include <algorithm>
+
+using namespace output;
+
+// an entry of the volume tracking matrix counted as a link, from parent (at n-1) to child (at n)
+struct Link {
+    Int_BinType child;
+    Int_BinType parent;
+    Fp_BinType volume;
+};
+
+std::vector<Event> EventDetector::detect(
+    const int& t_num, const double& time, const std::vector<Fp_BinType>& volumes,
+    const std::vector<Int_BinType>& rowIndex, const std::vector<Int_BinType>& columnIndex,
+    const std::vector<Fp_BinType>& values, const EventThresholds& thresholds
+)
+{
+    const std::size_t rc = rowIndex.size() - 1;
+
+    // the volume tracked to each child (by row) and from each parent (by label)
+    std::vector<Fp_BinType> rowSum(rc, 0.0);
+    std::vector<Fp_BinType> columnSum;
+    for (std::size_t i = 0; i < rc; ++i) {
+        for (auto k = rowIndex[i]; k < rowIndex[i + 1]; ++k) {
+            if (columnIndex[k] >= columnSum.size()) columnSum.resize(columnIndex[k] + 1, 0.0);
+            rowSum[i] += values[k];
+            columnSum[columnIndex[k]] += values[k];
+        }
+    }
+
+    // the links, by child, and the number of parents and children of each blob
+    std::vector<Link> links;
+    std::vector<Int_BinType> parents(rc, 0);
+    std::vector<Int_BinType> children(columnSum.size(), 0);
+    for (std::size_t i = 0; i < rc; ++i) {
+        for (auto k = rowIndex[i]; k < rowIndex[i + 1]; ++k) {
+            const Int_BinType j = columnIndex[k];
+            const Fp_BinType q = values[k];
+            if (q < thresholds.minVolume ||
+                q < thresholds.minFraction * std::min(rowSum[i], columnSum[j])) {
+                continue;
+            }
+
+            // row i is label i+1
+            links.push_back({static_cast<Int_BinType>(i + 1), j, q});
+            ++parents[i];
+            ++children[j];
+        }
+    }
+
+    std::vector<Event> events;
+    const Int_BinType T_NUM = static_cast<Int_BinType>(t_num);
+    auto add = [&](const EventKind& kind, const Int_BinType& label, const Int_BinType& partner,
+                   const Fp_BinType& volume) {
+        events.push_back({T_NUM, static_cast<Int_BinType>(kind), label, partner, time, volume});
+    };
+
+    for (const auto& link : links) {
+        if (parents[link.child - 1] > 1) {
+            add(EventKind::merge, link.child, link.parent, link.volume);
+        }
+    }
+
+    // by parent
+    std::stable_sort(links.begin(), links.end(), [](const Link& a, const Link& b) {
+        return a.parent < b.parent;
+    });
+    for (const auto& link : links) {
+        if (children[link.parent] > 1) {
+            add(EventKind::split, link.parent, link.child, link.volume);
+        }
+    }
+
+    // label l is at l-1 of the volume vector
+    for (std::size_t i = 0; i < std::min(rc, volumes.size()); ++i) {
+        if (parents[i] == 0 && volumes[i] > thresholds.minVolume) {
+            add(EventKind::birth, static_cast<Int_BinType>(i + 1), 0, volumes[i]);
+        }
+    }
+
+    if (hasPrevious) {
+        for (std::size_t i = 0; i < previousVolumes.size(); ++i) {
+            const std::size_t j = i + 1;
+            if ((j >= children.size() || children[j] == 0) &&
+                previousVolumes[i] > thresholds.minVolume) {
+                add(EventKind::death, static_cast<Int_BinType>(j), 0, previousVolumes[i]);
+            }
+        }
+    }
+
+    previousVolumes = volumes;
+    hasPrevious = true;
+
+    return events;
+}
+
+void output::writeEvents(const char* filename, const std::vector<Event>& events)
+{
+    if (events.empty()) return;
+
+    // Open file, note that this is in append mode
+    BinaryWriter outputFile(filename, true, false, events.size() * sizeof(Event));
+    outputFile.write(events.data(), events.size());
+    outputFile.close();
+}
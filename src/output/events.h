@@ -0,0 +1,118 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "output.h"
+
+#include <vector>
+
+namespace output {
+
+/** @brief The kind of an Event */
+enum class EventKind : Int_BinType
+{
+    /** @brief A blob came from two or more blobs */
+    merge = 0,
+
+    /** @brief A blob went to two or more blobs */
+    split = 1,
+
+    /** @brief A blob came from no blob */
+    birth = 2,
+
+    /** @brief A blob went to no blob */
+    death = 3
+};
+
+/**
+ * @brief A record of the event log
+ *
+ * A merge or split has a record for each of the blobs it involves, so the labels of every blob
+ * are known without the volume tracking matrix. The layout has no padding, and is the same in the
+ * file.
+ */
+struct Event {
+    /** @brief The snapshot index, \f$n\f$ */
+    Int_BinType t_num;
+
+    /** @brief The EventKind */
+    Int_BinType kind;
+
+    /**
+     * @brief The label of the blob: at \f$n\f$ for a merge or birth, at \f$n-1\f$ for a split or
+     * death
+     */
+    Int_BinType label;
+
+    /**
+     * @brief The label of the other blob of a merge (at \f$n-1\f$) or split (at \f$n\f$), zero
+     * for a birth or death
+     */
+    Int_BinType partner;
+
+    /** @brief The time of the snapshot, \f$t^{n}\f$ */
+    Fp_BinType time;
+
+    /**
+     * @brief The volume moved from one blob to the other for a merge or split, otherwise the
+     * volume of the blob
+     */
+    Fp_BinType volume;
+};
+
+static_assert(sizeof(Event) == 32, "Event must not be padded");
+
+/** @brief Which entries of the volume tracking matrix are counted as a link between blobs */
+struct EventThresholds {
+    /** @brief The least volume of a link, or of a blob to be born or die */
+    double minVolume = 0.0;
+
+    /**
+     * @brief The least volume of a link, as a fraction of the volume tracked to or from the
+     * smaller of its blobs (the sums of its row and column)
+     */
+    double minFraction = 0.0;
+};
+
+/**
+ * @brief Classifies the rows and columns of each volume tracking matrix into events
+ *
+ * The volume vector of each snapshot is kept until the next, to find the blobs that died.
+ */
+class EventDetector {
+  public:
+    /**
+     * @brief The events from the snapshot before to \p t_num
+     *
+     * On the first call, no deaths are found as there is no snapshot before.
+     *
+     * @param t_num The snapshot index, \f$n\f$
+     * @param time The time of the snapshot, \f$t^{n}\f$
+     * @param volumes The volume vector \f$\mathbf{v}^{n}\f$
+     * @param rowIndex The row index of \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$, with the starting
+     * zero
+     * @param columnIndex The column indices of \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$
+     * @param values The values of \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$
+     * @param thresholds The links counted
+     * @return The merges, then splits, births, and deaths, each in order of label
+     */
+    std::vector<Event> detect(
+        const int& t_num, const double& time, const std::vector<Fp_BinType>& volumes,
+        const std::vector<Int_BinType>& rowIndex, const std::vector<Int_BinType>& columnIndex,
+        const std::vector<Fp_BinType>& values, const EventThresholds& thresholds
+    );
+
+  private:
+    bool hasPrevious = false;
+    std::vector<Fp_BinType> previousVolumes;
+};
+
+/**
+ * @brief Append \p events to the event log \p filename, in a single write
+ *
+ * @throws std::runtime_error If the file can not be written
+ */
+void writeEvents(const char* filename, const std::vector<Event>& events);
+
+} // namespace output
+
+#endif
@@ -0,0 +1,344 @@
+#include "matrixencoding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace output;
+
+/*
+Version 2 volume tracking matrix format
+---------------------------------------
+    MAGIC                       "ELAM"
+    VERSION                     uint32_t, 2
+    RC                          uint32_t
+    NNZ                         uint32_t
+    VALUES_FORMAT               uint32_t, 0 for plain or 1 for shuffled
+    INDEX_SIZE                  uint64_t, in bytes
+    VALUES_SIZE                 uint64_t, in bytes
+    INDEX                       for each row: varint NNZ of the row, then varint delta of each
+                                column index from the previous in the row (first is from 0)
+    VALUES                      plain: double[NNZ]
+                                shuffled: byte b of every value, for b = 0..7, run-length encoded
+
+Varints are stored little-endian in groups of 7 bits, with the high bit set when more bytes
+follow (i.e., LEB128).
+
+The run-length encoding is a sequence of runs, each starting with a control byte c:
+    c < 128                     c+1 bytes follow, copied as is
+    c >= 128                    one byte follows, repeated c-125 (3 to 130) times
+
+A version 1 file starts with RC, which can not be the magic bytes in practice.
+*/
+
+// the size of the header, in bytes
+constexpr std::size_t headerSize =
+    sizeof(matrixMagic) + 4 * sizeof(Int_BinType) + 2 * sizeof(std::uint64_t);
+
+// the VALUES_FORMAT of the header
+constexpr Int_BinType plainValues = 0;
+constexpr Int_BinType shuffledValues = 1;
+
+// run lengths of the run-length encoding
+constexpr std::size_t minRepeat = 3;
+constexpr std::size_t maxRepeat = 130;
+constexpr std::size_t maxLiteral = 128;
+
+static inline void writeVarint(std::vector<unsigned char>& out, std::uint32_t x)
+{
+    while (x >= 0x80) {
+        out.push_back(static_cast<unsigned char>(x | 0x80));
+        x >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(x));
+}
+
+// read a varint from ptr, which must be before end
+static inline const unsigned char* readVarint(
+    const unsigned char* ptr, const unsigned char* const end, std::uint32_t& x
+)
+{
+    x = 0;
+    for (unsigned int shift = 0; shift < 32; shift += 7) {
+        if (ptr == end) throw std::runtime_error("Truncated volume tracking matrix index");
+
+        const unsigned char byte = *ptr++;
+        x |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return ptr;
+    }
+    throw std::runtime_error("Invalid varint in volume tracking matrix index");
+}
+
+// run-length encode the bytes
+static std::vector<unsigned char> encodeRuns(const std::vector<unsigned char>& in)
+{
+    std::vector<unsigned char> out;
+    out.reserve(in.size() + in.size() / maxLiteral + 1);
+
+    std::size_t i = 0;
+    std::size_t literalStart = 0;
+
+    // write the literals before i
+    auto flushLiterals = [&]() {
+        while (literalStart < i) {
+            const std::size_t count = std::min(i - literalStart, maxLiteral);
+            out.push_back(static_cast<unsigned char>(count - 1));
+            out.insert(out.end(), in.begin() + literalStart, in.begin() + literalStart + count);
+            literalStart += count;
+        }
+    };
+
+    while (i < in.size()) {
+        std::size_t run = 1;
+        while (i + run < in.size() && run < maxRepeat && in[i + run] == in[i]) {
+            ++run;
+        }
+
+        if (run >= minRepeat) {
+            flushLiterals();
+            out.push_back(static_cast<unsigned char>(run - minRepeat + 128));
+            out.push_back(in[i]);
+            i += run;
+            literalStart = i;
+        }
+        else {
+            i += run;
+        }
+    }
+    flushLiterals();
+
+    return out;
+}
+
+// decode the run-length encoded bytes, which must decode to exactly out.size() bytes
+static void decodeRuns(
+    const unsigned char* ptr, const unsigned char* const end, std::vector<unsigned char>& out
+)
+{
+    std::size_t i = 0;
+    while (ptr < end) {
+        const unsigned char c = *ptr++;
+
+        const std::size_t count = (c < 128 ? c + 1 : c - 128 + minRepeat);
+        if (i + count > out.size() || std::size_t(end - ptr) < (c < 128 ? count : 1)) {
+            throw std::runtime_error("Invalid volume tracking matrix values");
+        }
+
+        if (c < 128) {
+            std::memcpy(out.data() + i, ptr, count);
+            ptr += count;
+        }
+        else {
+            std::memset(out.data() + i, *ptr++, count);
+        }
+        i += count;
+    }
+
+    if (i != out.size()) throw std::runtime_error("Invalid volume tracking matrix values");
+}
+
+void output::writeCompactMatrix(
+    BinaryWriter& outputFile, const std::vector<svec::SVector>& rows, const int& rc,
+    const MatrixEncoding& encoding
+)
+{
+    assert(encoding != MatrixEncoding::plain);
+
+    // the index, and the values in order
+    std::vector<unsigned char> index;
+    std::vector<Fp_BinType> values;
+    for (auto i = 0; i < rc; ++i) {
+        writeVarint(index, static_cast<std::uint32_t>(rows[i].NNZ()));
+
+        svec::Label prev = 0;
+        for (const auto& elm : rows[i]) {
+            writeVarint(index, elm.l - prev);
+            prev = elm.l;
+            values.push_back(static_cast<Fp_BinType>(elm.v));
+        }
+    }
+    const Int_BinType NNZ = static_cast<Int_BinType>(values.size());
+
+    // shuffle the bytes of the values, then run-length encode
+    std::vector<unsigned char> shuffled;
+    if (encoding == MatrixEncoding::compactShuffled) {
+        std::vector<unsigned char> bytes(values.size() * sizeof(Fp_BinType));
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            unsigned char value[sizeof(Fp_BinType)];
+            std::memcpy(value, &values[i], sizeof(Fp_BinType));
+            for (std::size_t b = 0; b < sizeof(Fp_BinType); ++b) {
+                bytes[b * values.size() + i] = value[b];
+            }
+        }
+        shuffled = encodeRuns(bytes);
+    }
+
+    const std::uint64_t indexSize = index.size();
+    const std::uint64_t valuesSize =
+        (encoding == MatrixEncoding::compactShuffled ? shuffled.size()
+                                                      : values.size() * sizeof(Fp_BinType));
+
+    // header
+    outputFile.write(matrixMagic, sizeof(matrixMagic));
+    outputFile.write(matrixVersion);
+    outputFile.write(static_cast<Int_BinType>(rc));
+    outputFile.write(NNZ);
+    outputFile.write(encoding == MatrixEncoding::compactShuffled ? shuffledValues : plainValues);
+    outputFile.write(indexSize);
+    outputFile.write(valuesSize);
+
+    // data
+    outputFile.write(index.data(), index.size());
+    if (encoding == MatrixEncoding::compactShuffled) {
+        outputFile.write(shuffled.data(), shuffled.size());
+    }
+    else {
+        outputFile.write(values.data(), values.size());
+    }
+}
+
+// copy a value of T from ptr, advancing it
+template <class T>
+static void readValue(const char*& ptr, T& x)
+{
+    std::memcpy(&x, ptr, sizeof(T));
+    ptr += sizeof(T);
+}
+
+// copy count values of T from ptr, advancing it
+template <class T>
+static void readValues(const char*& ptr, std::vector<T>& values, const std::size_t& count)
+{
+    values.resize(count);
+    if (count != 0) std::memcpy(values.data(), ptr, count * sizeof(T));
+    ptr += count * sizeof(T);
+}
+
+// decode a version 1 file
+static void decodePlainMatrix(
+    const char* ptr, const std::size_t& size, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+)
+{
+    if (size < 2 * sizeof(Int_BinType)) {
+        throw std::runtime_error("Truncated volume tracking matrix");
+    }
+
+    Int_BinType RC, NNZ;
+    readValue(ptr, RC);
+    readValue(ptr, NNZ);
+
+    const std::size_t expected = (2 + std::size_t(RC) + NNZ) * sizeof(Int_BinType) +
+                                 std::size_t(NNZ) * sizeof(Fp_BinType);
+    if (size != expected) throw std::runtime_error("Volume tracking matrix has the wrong size");
+
+    // the starting zero is not stored
+    readValues(ptr, rowIndex, RC);
+    rowIndex.insert(rowIndex.begin(), 0);
+
+    readValues(ptr, columnIndex, NNZ);
+    readValues(ptr, values, NNZ);
+}
+
+void output::decodeMatrix(
+    const char* data, const std::size_t& size, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+)
+{
+    if (size < sizeof(matrixMagic) || std::memcmp(data, matrixMagic, sizeof(matrixMagic)) != 0) {
+        decodePlainMatrix(data, size, rowIndex, columnIndex, values);
+        return;
+    }
+
+    if (size < headerSize) throw std::runtime_error("Truncated volume tracking matrix");
+
+    const char* ptr = data + sizeof(matrixMagic);
+    Int_BinType version, RC, NNZ, valuesFormat;
+    std::uint64_t indexSize, valuesSize;
+    readValue(ptr, version);
+    readValue(ptr, RC);
+    readValue(ptr, NNZ);
+    readValue(ptr, valuesFormat);
+    readValue(ptr, indexSize);
+    readValue(ptr, valuesSize);
+
+    if (version != matrixVersion) {
+        throw std::runtime_error(
+            "Unsupported volume tracking matrix version " + std::to_string(version)
+        );
+    }
+    if (valuesFormat != plainValues && valuesFormat != shuffledValues) {
+        throw std::runtime_error("Unknown volume tracking matrix values format");
+    }
+    if (indexSize > size - headerSize || valuesSize != size - headerSize - indexSize) {
+        throw std::runtime_error("Volume tracking matrix has the wrong size");
+    }
+
+    // index
+    auto index = reinterpret_cast<const unsigned char*>(ptr);
+    const auto indexEnd = index + indexSize;
+
+    rowIndex.resize(std::size_t(RC) + 1);
+    columnIndex.resize(NNZ);
+    rowIndex[0] = 0;
+    std::size_t k = 0;
+    for (std::size_t i = 0; i < RC; ++i) {
+        std::uint32_t nnz;
+        index = readVarint(index, indexEnd, nnz);
+        if (k + nnz > NNZ) throw std::runtime_error("Invalid volume tracking matrix index");
+
+        std::uint32_t col = 0;
+        for (std::uint32_t j = 0; j < nnz; ++j) {
+            std::uint32_t delta;
+            index = readVarint(index, indexEnd, delta);
+            col += delta;
+            columnIndex[k++] = col;
+        }
+        rowIndex[i + 1] = static_cast<Int_BinType>(k);
+    }
+    if (k != NNZ || index != indexEnd) {
+        throw std::runtime_error("Invalid volume tracking matrix index");
+    }
+
+    // values
+    ptr += indexSize;
+    if (valuesFormat == plainValues) {
+        if (valuesSize != std::size_t(NNZ) * sizeof(Fp_BinType)) {
+            throw std::runtime_error("Volume tracking matrix has the wrong size");
+        }
+        readValues(ptr, values, NNZ);
+        return;
+    }
+
+    std::vector<unsigned char> bytes(std::size_t(NNZ) * sizeof(Fp_BinType));
+    const auto runs = reinterpret_cast<const unsigned char*>(ptr);
+    decodeRuns(runs, runs + valuesSize, bytes);
+
+    // unshuffle
+    values.resize(NNZ);
+    for (std::size_t i = 0; i < NNZ; ++i) {
+        unsigned char value[sizeof(Fp_BinType)];
+        for (std::size_t b = 0; b < sizeof(Fp_BinType); ++b) {
+            value[b] = bytes[b * NNZ + i];
+        }
+        std::memcpy(&values[i], value, sizeof(Fp_BinType));
+    }
+}
+
+void output::readMatrix(
+    const char* filename, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+)
+{
+    std::ifstream input(filename, std::ios::binary | std::ios::ate);
+    if (!input) throw std::runtime_error("Unable to open " + std::string(filename));
+
+    std::vector<char> bytes(static_cast<std::size_t>(input.tellg()));
+    input.seekg(0);
+    input.read(bytes.data(), bytes.size());
+    if (!input) throw std::runtime_error("Unable to read " + std::string(filename));
+
+    decodeMatrix(bytes.data(), bytes.size(), rowIndex, columnIndex, values);
+}
@@ -0,0 +1,88 @@
+#ifndef MATRIX_ENCODING_H
+#define MATRIX_ENCODING_H
+
+#include "../svector/svector.h"
+#include "binarywriter.h"
+#include "output.h"
+
+#include <vector>
+
+namespace output {
+
+/**
+ * @brief The format of a volume tracking matrix file
+ *
+ * @see VolumeTrackingMatrix::write()
+ */
+enum class MatrixEncoding
+{
+    /** @brief Version 1 format, CSR with `uint32_t` indices and `double` values */
+    plain,
+
+    /**
+     * @brief Version 2 format
+     *
+     * The NNZ of each row and the column indices are stored as varints, each column index as the
+     * difference from the previous in the row. Values are stored as `double`.
+     */
+    compact,
+
+    /**
+     * @brief Version 2 format with the values compressed
+     *
+     * Same as @ref compact, but the bytes of the values are shuffled (all the first bytes, then
+     * all the second bytes, ...) and run-length encoded. This is lossless.
+     */
+    compactShuffled
+};
+
+/** @brief The first bytes of a version 2 volume tracking matrix file */
+constexpr char matrixMagic[4] = {'E', 'L', 'A', 'M'};
+
+/** @brief The version of the format following the magic bytes */
+constexpr Int_BinType matrixVersion = 2;
+
+/**
+ * @brief Write a volume tracking matrix in the version 2 format
+ *
+ * @param outputFile Where to write
+ * @param rows The rows of the matrix, each sorted by column
+ * @param rc The number of rows
+ * @param encoding MatrixEncoding::compact or MatrixEncoding::compactShuffled
+ */
+void writeCompactMatrix(
+    BinaryWriter& outputFile, const std::vector<svec::SVector>& rows, const int& rc,
+    const MatrixEncoding& encoding
+);
+
+/**
+ * @brief Decode a volume tracking matrix, of either version, to CSR format
+ *
+ * @throws std::runtime_error If the data is not a valid volume tracking matrix
+ *
+ * @param[in] data The bytes of the file
+ * @param[in] size The number of bytes
+ * @param[out] rowIndex The row index, with the starting zero (RC+1 values)
+ * @param[out] columnIndex The column indices (NNZ values)
+ * @param[out] values The values (NNZ values)
+ */
+void decodeMatrix(
+    const char* data, const std::size_t& size, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+);
+
+/**
+ * @brief Read a volume tracking matrix file, of either version, in CSR format
+ *
+ * @throws std::runtime_error If the file can not be read, or is not a volume tracking matrix
+ *
+ * @see decodeMatrix()
+ */
+void readMatrix(
+    const char* filename, std::vector<Int_BinType>& rowIndex,
+    std::vector<Int_BinType>& columnIndex, std::vector<Fp_BinType>& values
+);
+
+} // namespace output
+
+#endif
@@ -23,6 +23,33 @@ typedef uint32_t Int_BinType;
 #define MPI_INT_BINTYPE MPI_UINT32_T
 #endif
 
+/** @brief Whether binary output files are written with `O_DIRECT`, see BinaryWriter */
+#ifdef ELA_DIRECT_IO
+constexpr bool directIO = true;
+#else
+constexpr bool directIO = false;
+#endif
+
+#ifdef ELA_USE_MPI
+/**
+ * @brief The tag for the messages of the next reduction
+ *
+ * Each call returns the next tag, so the tag is the same on every process as long as reductions
+ * are started in the same order. The tags only tell the reductions apart from each other, so their
+ * communicator must not be used for anything else (e.g., domain::MPIDomain::getOutputComm()).
+ */
+inline int getReductionTag()
+{
+    // the tag upper bound is at least this
+    constexpr int maxTag = 32767;
+
+    static int nextTag = 0;
+    const int tag = nextTag;
+    nextTag = (nextTag + 1) % (maxTag + 1);
+    return tag;
+}
+#endif
+
 } // namespace output
 
 #endif
\ No newline at end of file
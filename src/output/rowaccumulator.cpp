@@ -0,0 +1,106 @@
+#include "rowaccumulator.h"
+
+#include <algorithm>
+
+using namespace output;
+
+// slot of label l in a table of size 2^(64-shift), from Fibonacci hashing
+static inline std::size_t getSlot(const svec::Label& l, const unsigned int& shift)
+{
+    return static_cast<std::size_t>((std::uint64_t(l) * 0x9E3779B97F4A7C15ull) >> shift);
+}
+
+void RowAccumulator::add(const svec::SVector& s, const svec::Value& C)
+{
+    // quick exit, as SVector::add()
+    if (C == 0.0 || s.isEmpty()) return;
+
+    for (const auto& elm : s) {
+        insert(elm, C);
+    }
+}
+
+void RowAccumulator::merge(RowAccumulator& other)
+{
+    // nothing to add to, so take the table
+    if (count == 0) {
+        table.swap(other.table);
+        std::swap(shift, other.shift);
+        std::swap(count, other.count);
+        return;
+    }
+
+    for (const auto& elm : other.table) {
+        if (!elm.isEnd()) insert(elm, 1.0);
+    }
+
+    std::vector<svec::Element>().swap(other.table);
+    other.count = 0;
+    other.shift = 64;
+}
+
+void RowAccumulator::insert(const svec::Element& elm, const svec::Value& C)
+{
+    // keep the table at most half full
+    if (2 * (count + 1) > table.size()) grow();
+
+    const std::size_t mask = table.size() - 1;
+    std::size_t i = getSlot(elm.l, shift);
+    while (!table[i].isEnd() && table[i].l != elm.l) {
+        i = (i + 1) & mask;
+    }
+
+    if (table[i].isEnd()) {
+        table[i] = elm * C;
+        ++count;
+    }
+    else {
+        table[i].v = std::fma(elm.v, C, table[i].v);
+    }
+}
+
+void RowAccumulator::grow()
+{
+    std::vector<svec::Element> old(std::max<std::size_t>(2 * table.size(), 8), svec::END_ELEMENT);
+    old.swap(table);
+
+    shift = 64;
+    for (auto size = table.size(); size > 1; size >>= 1) {
+        --shift;
+    }
+
+    // re-insert, the labels are unique
+    const std::size_t mask = table.size() - 1;
+    for (const auto& elm : old) {
+        if (elm.isEnd()) continue;
+
+        std::size_t i = getSlot(elm.l, shift);
+        while (!table[i].isEnd()) {
+            i = (i + 1) & mask;
+        }
+        table[i] = elm;
+    }
+}
+
+svec::SVector RowAccumulator::release()
+{
+    // move the elements to the front, then sort them
+    table.erase(
+        std::remove_if(
+            table.begin(), table.end(), [](const svec::Element& elm) { return elm.isEnd(); }
+        ),
+        table.end()
+    );
+    std::sort(table.begin(), table.end(), [](const svec::Element& a, const svec::Element& b) {
+        return a.l < b.l;
+    });
+    table.push_back(svec::END_ELEMENT);
+
+    svec::SVector s(table.data());
+
+    std::vector<svec::Element>().swap(table);
+    count = 0;
+    shift = 64;
+
+    return s;
+}
@@ -0,0 +1,60 @@
+#ifndef ROW_ACCUMULATOR_H
+#define ROW_ACCUMULATOR_H
+
+#include "../svector/svector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace output {
+
+/**
+ * @brief Sums many SVector into one, e.g., a row of the volume tracking matrix
+ *
+ * SVector::add() merges into a sorted vector, so adding many vectors to a row with many elements
+ * costs \f$O(N)\f$ each, or worse when new labels are inserted. Instead, the elements are summed
+ * in an open-addressing hash table keyed by label, so each add() costs \f$O(\mathrm{NNZ})\f$ of
+ * the vector added. The elements are sorted once, by release().
+ *
+ * Each element is summed in the same order, and with the same operations, as SVector::add(), so
+ * the result is identical.
+ */
+class RowAccumulator {
+  public:
+    /** @brief Add \f$C\mathbf{s}\f$ */
+    void add(const svec::SVector& s, const svec::Value& C = 1.0);
+
+    /**
+     * @brief Add the sum of \p other, leaving it empty
+     *
+     * Each element is added once, so the result does not depend on the order of the table.
+     */
+    void merge(RowAccumulator& other);
+
+    /** @brief Number of non-zero elements */
+    std::size_t NNZ() const noexcept
+    {
+        return count;
+    }
+
+    /** @brief The sum as an SVector, leaving this empty */
+    svec::SVector release();
+
+  private:
+    /** @brief Add \f$C\f$ times the element to the table */
+    void insert(const svec::Element& elm, const svec::Value& C);
+
+    /** @brief Double the size of the table */
+    void grow();
+
+    // the table, with empty slots marked by svec::END_ELEMENT
+    std::vector<svec::Element> table;
+
+    // number of labels in the table, and the shift giving a slot from the hash of a label
+    std::size_t count = 0;
+    unsigned int shift = 64;
+};
+
+} // namespace output
+
+#endif
@@ -1,8 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <stdio.h>
+#include <stdexcept>
+#include <vector>
 
 #include "../asciilog.h"
+#include "../backgroundwriter.h"
+#include "../binarywriter.h"
+#include "../container.h"
+#include "../events.h"
+#include "../matrixencoding.h"
+#include "../rowaccumulator.h"
 #include "../vtm.h"
 #include "../vv.h"
 
@@ -50,6 +59,138 @@ bool RankEqual(const int& in)
 }
 #endif
 
+TEST(Output, BinaryWriter)
+{
+    if (!RankEqual(0)) return;
+
+    // a small chunk, so data is written in several chunks and also directly
+    constexpr std::size_t chunkSize = output::BinaryWriter::alignment;
+    std::vector<double> large(3 * chunkSize / sizeof(double) + 5);
+    for (std::size_t i = 0; i < large.size(); ++i) {
+        large[i] = 0.5 * i;
+    }
+
+    for (const bool direct : {false, true}) {
+        {
+            output::BinaryWriter writer("temp_writer.bin", false, direct, chunkSize);
+            writer.write(uint32_t(7));
+            writer.write(large.data(), large.size());
+            writer.close();
+        }
+        {
+            // starts with a partial chunk, then data larger than a chunk
+            output::BinaryWriter writer("temp_writer.bin", true, direct, chunkSize);
+            writer.write(large.data(), large.size());
+            writer.write(uint32_t(9));
+        }
+
+        std::ifstream input("temp_writer.bin", std::ios::binary);
+
+        uint32_t first;
+        input.read(reinterpret_cast<char*>(&first), sizeof(uint32_t));
+        EXPECT_EQ(first, 7);
+
+        for (auto n = 0; n < 2; ++n) {
+            std::vector<double> large_new(large.size());
+            input.read(reinterpret_cast<char*>(large_new.data()), large.size() * sizeof(double));
+            EXPECT_EQ(large_new, large);
+        }
+
+        uint32_t last;
+        input.read(reinterpret_cast<char*>(&last), sizeof(uint32_t));
+        EXPECT_EQ(last, 9);
+
+        // nothing more
+        EXPECT_EQ(input.peek(), EOF);
+    }
+}
+
+TEST(Output, BackgroundWriter)
+{
+    std::vector<int> order;
+
+    {
+        output::BackgroundWriter writer(1);
+
+        // jobs run in order, with at most one waiting
+        for (auto n = 0; n < 5; ++n) {
+            writer.submit([&order, n]() { order.push_back(n); });
+        }
+        writer.wait();
+        EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+
+        // an error is reported by wait
+        writer.submit([]() { throw std::runtime_error("failed"); });
+        writer.submit([&order]() { order.push_back(5); });
+        EXPECT_THROW(writer.wait(), std::runtime_error);
+        EXPECT_EQ(order.back(), 5);
+
+        // anything left is run before it is destroyed
+        writer.submit([&order]() { order.push_back(6); });
+    }
+
+    EXPECT_EQ(order.back(), 6);
+}
+
+TEST(Output, RowAccumulator)
+{
+    typedef svec::SVector S;
+    typedef svec::Element E;
+
+    output::RowAccumulator acc;
+    svec::SVector expected;
+
+    // many vectors, with labels repeated and in any order, to make the table grow
+    std::vector<svec::Element> elms;
+    for (auto n = 0u; n < 200; ++n) {
+        elms.clear();
+        for (auto k = 0u; k < n % 7; ++k) {
+            elms.push_back({(n * 37 + k * 101) % 250 + 1, 0.1 * (k + 1) + 0.001 * n});
+        }
+        std::sort(elms.begin(), elms.end(), [](const auto& a, const auto& b) { return a.l < b.l; });
+        elms.erase(
+            std::unique(
+                elms.begin(), elms.end(), [](const auto& a, const auto& b) { return a.l == b.l; }
+            ),
+            elms.end()
+        );
+        elms.push_back(svec::END_ELEMENT);
+
+        const svec::SVector s(elms.data());
+        const svec::Value C = 0.5 + 0.01 * n;
+        acc.add(s, C);
+        expected.add(s, C);
+    }
+    EXPECT_EQ(acc.NNZ(), expected.NNZ());
+
+    // identical to SVector::add()
+    const svec::SVector s = acc.release();
+    ASSERT_EQ(s.NNZ(), expected.NNZ());
+    for (auto a = s.begin(), b = expected.begin(); a != s.end(); ++a, ++b) {
+        EXPECT_EQ(a->l, b->l);
+        EXPECT_EQ(a->v, b->v);
+    }
+
+    // empty once released
+    EXPECT_EQ(acc.NNZ(), 0);
+    EXPECT_TRUE(acc.release().isEmpty());
+
+    // merging
+    output::RowAccumulator a, b;
+    a.add(S(E{1, 1.0}));
+    b.add(S(E{1, 2.0}));
+    b.add(S(E{3, 4.0}));
+    a.merge(b);
+    EXPECT_EQ(b.NNZ(), 0);
+
+    const svec::SVector merged = a.release();
+    ASSERT_EQ(merged.NNZ(), 2);
+    EXPECT_EQ(merged.data()[0].l, 1);
+    EXPECT_DOUBLE_EQ(merged.data()[0].v, 3.0);
+    EXPECT_EQ(merged.data()[1].l, 3);
+    EXPECT_DOUBLE_EQ(merged.data()[1].v, 4.0);
+}
+
 TEST(Output, VolumeVector)
 {
     constexpr int rowCount = 5;
@@ -90,21 +231,136 @@ TEST(Output, VolumeVector)
     }
 }
 
+TEST(Output, VolumeVectorDense)
+{
+    constexpr int rowCount = 4;
+#ifdef ELA_USE_MPI
+    output::VolumeVector vv = output::VolumeVector(rowCount, MPI_COMM_WORLD);
+
+    int nProc;
+    MPI_Comm_size(MPI_COMM_WORLD, &nProc);
+#else
+    output::VolumeVector vv = output::VolumeVector(rowCount);
+
+    const int nProc = 1;
+#endif
+
+    // every row is non-zero, so the whole vector is reduced
+    for (auto l = 1; l <= rowCount; ++l) {
+        vv.addCell(l, 0.5 * l);
+    }
+
+    vv.finalize();
+
+    vv.write("temp_dense_v.bin");
+
+    if (RankEqual(0)) {
+        std::ifstream input("temp_dense_v.bin", std::ios::binary);
+
+        uint32_t rowCount_new;
+        input.read(reinterpret_cast<char*>(&rowCount_new), sizeof(uint32_t));
+        ASSERT_EQ(rowCount_new, rowCount);
+
+        double vol_new[rowCount];
+        input.read(reinterpret_cast<char*>(vol_new), sizeof(double) * rowCount);
+        for (auto l = 1; l <= rowCount; ++l) {
+            EXPECT_DOUBLE_EQ(vol_new[l - 1], 0.5 * l * nProc);
+        }
+
+        input.close();
+    }
+}
+
+TEST(Output, AsyncFinalize)
+{
+    typedef svec::SVector S;
+    typedef svec::Element E;
+
+    // each process only knows about the labels it has
+    const int rowCount = (RankEqual(1) ? 5 : 2);
+#ifdef ELA_USE_MPI
+    output::VolumeVector vv = output::VolumeVector(rowCount, MPI_COMM_WORLD);
+    auto vtm = output::VolumeTrackingMatrix(rowCount, MPI_COMM_WORLD);
+#else
+    output::VolumeVector vv = output::VolumeVector(rowCount);
+    auto vtm = output::VolumeTrackingMatrix(rowCount);
+#endif
+
+    if (RankEqual(0)) vv.addCell(1, 0.5);
+    if (RankEqual(1)) vv.addCell(5, 0.25);
+    if (RankEqual(2)) vv.addCell(2, 10.0);
+
+    if (RankEqual(0)) vtm.addCell(2, 2.0, S(E{3, 1.0}));
+    if (RankEqual(1)) vtm.addCell(5, 1.0, S(E{1, 4.0}));
+    if (RankEqual(3)) vtm.addCell(2, 1.0, S(E{3, 0.5}));
+
+    // both are in progress at once
+    vv.startFinalize();
+    vtm.startFinalize();
+
+    bool vvDone = false, vtmDone = false;
+    while (!(vvDone && vtmDone)) {
+        vvDone = vv.continueFinalize();
+        vtmDone = vtm.continueFinalize();
+    }
+
+    vv.write("temp_async_v.bin");
+    vtm.write("temp_async_a.bin");
+
+    if (RankEqual(0)) {
+        std::ifstream input("temp_async_v.bin", std::ios::binary);
+
+        uint32_t rowCount_new;
+        input.read(reinterpret_cast<char*>(&rowCount_new), sizeof(uint32_t));
+        ASSERT_EQ(rowCount_new, 5);
+
+        double vol_new[5];
+        input.read(reinterpret_cast<char*>(vol_new), sizeof(double) * 5);
+        EXPECT_DOUBLE_EQ(vol_new[0], 0.5);
+        EXPECT_DOUBLE_EQ(vol_new[1], 10.0);
+        EXPECT_DOUBLE_EQ(vol_new[2], 0);
+        EXPECT_DOUBLE_EQ(vol_new[3], 0);
+        EXPECT_DOUBLE_EQ(vol_new[4], 0.25);
+
+        input.close();
+
+        input.open("temp_async_a.bin", std::ios::binary);
+
+        uint32_t header[2];
+        input.read(reinterpret_cast<char*>(header), 2 * sizeof(uint32_t));
+        ASSERT_EQ(header[0], 5); // ROW_COUNT
+        ASSERT_EQ(header[1], 2); // NNZ
+
+        uint32_t ROW_INDEX[5];
+        input.read(reinterpret_cast<char*>(ROW_INDEX), 5 * sizeof(uint32_t));
+        EXPECT_EQ(ROW_INDEX[0], 0);
+        EXPECT_EQ(ROW_INDEX[1], 1);
+        EXPECT_EQ(ROW_INDEX[4], 2);
+
+        uint32_t COL_INDEX[2];
+        input.read(reinterpret_cast<char*>(COL_INDEX), 2 * sizeof(uint32_t));
+        EXPECT_EQ(COL_INDEX[0], 3);
+        EXPECT_EQ(COL_INDEX[1], 1);
+
+        double VALUE[2];
+        input.read(reinterpret_cast<char*>(VALUE), 2 * sizeof(double));
+        EXPECT_DOUBLE_EQ(VALUE[0], 2.0 + 0.5);
+        EXPECT_DOUBLE_EQ(VALUE[1], 4.0);
+
+        input.close();
+    }
+}
+
 // builds the matrix from https://en.wikipedia.org/wiki/Sparse_matrix
 // | 10 | 20 |  0 |  0 |  0 |  0 |
 // |  0 | 30 |  0 | 40 |  0 |  0 |
 // |  0 |  0 | 50 | 60 | 70 |  0 |
 // |  0 |  0 |  0 |  0 |  0 | 80 |
-TEST(Output, VolumeTrackingMatrix)
+void fillSparseMatrix(output::VolumeTrackingMatrix& vtm)
 {
     typedef svec::SVector S;
     typedef svec::Element E;
 
-#ifdef ELA_USE_MPI
-    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
-#else
-    auto vtm = output::VolumeTrackingMatrix(4);
-#endif
     S s;
 
     if (RankEqual(0)) {
@@ -150,6 +406,16 @@ TEST(Output, VolumeTrackingMatrix)
         // should ignore 0
         vtm.addCell(1, 0.8, S(E{0, 5.0}));
     }
+}
+
+TEST(Output, VolumeTrackingMatrix)
+{
+#ifdef ELA_USE_MPI
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+#else
+    auto vtm = output::VolumeTrackingMatrix(4);
+#endif
+    fillSparseMatrix(vtm);
 
     vtm.finalize();
 
@@ -200,6 +466,368 @@ TEST(Output, VolumeTrackingMatrix)
     }
 }
 
+TEST(Output, VolumeTrackingMatrixMerge)
+{
+#ifdef ELA_USE_MPI
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+    auto merged = output::VolumeTrackingMatrix(2, MPI_COMM_WORLD);
+    auto partA = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+    auto partB = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+#else
+    auto vtm = output::VolumeTrackingMatrix(4);
+    auto merged = output::VolumeTrackingMatrix(2);
+    auto partA = output::VolumeTrackingMatrix(4);
+    auto partB = output::VolumeTrackingMatrix(4);
+#endif
+    // the same cells, with some added to each part
+    fillSparseMatrix(vtm);
+    vtm.addCell(3, 2.0, svec::SVector(svec::Element{4, 1.0}));
+
+    fillSparseMatrix(partA);
+    partB.addCell(3, 2.0, svec::SVector(svec::Element{4, 1.0}));
+
+    // merging grows the matrix to the size of the parts
+    merged.merge(partA);
+    merged.merge(partB);
+
+    vtm.finalize();
+    merged.finalize();
+    vtm.write("temp_a.bin");
+    merged.write("temp_b.bin");
+
+    if (RankEqual(0)) {
+        std::ifstream a("temp_a.bin", std::ios::binary), b("temp_b.bin", std::ios::binary);
+        const std::vector<char> bytesA(std::istreambuf_iterator<char>(a), {});
+        const std::vector<char> bytesB(std::istreambuf_iterator<char>(b), {});
+        EXPECT_FALSE(bytesA.empty());
+        EXPECT_EQ(bytesA, bytesB);
+
+        remove("temp_a.bin");
+        remove("temp_b.bin");
+    }
+}
+
+#ifdef ELA_USE_MPI
+TEST(Output, VolumeTrackingMatrixDistributed)
+{
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+    fillSparseMatrix(vtm);
+    vtm.finalize();
+    vtm.write("temp_a_root.bin");
+
+    // the row count is only known by some processes
+    auto vtmDist = output::VolumeTrackingMatrix(RankEqual(2) ? 4 : 3, MPI_COMM_WORLD, true);
+    fillSparseMatrix(vtmDist);
+    vtmDist.finalize();
+    vtmDist.write("temp_a_dist.bin");
+
+    if (RankEqual(0)) {
+        // should be the same file
+        std::ifstream root("temp_a_root.bin", std::ios::binary);
+        std::ifstream dist("temp_a_dist.bin", std::ios::binary);
+        std::vector<char> rootData(std::istreambuf_iterator<char>(root), {});
+        std::vector<char> distData(std::istreambuf_iterator<char>(dist), {});
+
+        ASSERT_EQ(rootData.size(), 2 * 4 + 4 * 4 + 8 * (4 + 8));
+        EXPECT_EQ(rootData, distData);
+    }
+}
+#endif
+
+TEST(Output, GetRows)
+{
+    // the matrix of fillSparseMatrix()
+    const std::vector<output::Int_BinType> rowIndex = {0, 2, 4, 7, 8};
+    const std::vector<output::Int_BinType> columnIndex = {1, 2, 2, 4, 3, 4, 5, 6};
+    const std::vector<output::Fp_BinType> values = {10, 20, 30, 40, 50, 60, 70, 80};
+
+    int firstRow;
+    std::vector<output::Int_BinType> rowIndexOut, columnIndexOut;
+    std::vector<output::Fp_BinType> valuesOut;
+
+#ifdef ELA_USE_MPI
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+#else
+    auto vtm = output::VolumeTrackingMatrix(4);
+#endif
+    fillSparseMatrix(vtm);
+    vtm.finalize();
+    vtm.getRows(firstRow, rowIndexOut, columnIndexOut, valuesOut);
+
+    // the whole matrix on root
+    EXPECT_EQ(firstRow, 0);
+    if (RankEqual(0)) {
+        EXPECT_EQ(rowIndexOut, rowIndex);
+        EXPECT_EQ(columnIndexOut, columnIndex);
+        EXPECT_EQ(valuesOut, values);
+    }
+    else {
+        EXPECT_EQ(rowIndexOut, std::vector<output::Int_BinType>(1, 0));
+        EXPECT_TRUE(valuesOut.empty());
+    }
+
+#ifdef ELA_USE_MPI
+    // a range of rows on each process
+    auto vtmDist = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD, true);
+    fillSparseMatrix(vtmDist);
+    vtmDist.finalize();
+    vtmDist.getRows(firstRow, rowIndexOut, columnIndexOut, valuesOut);
+
+    const int nRows = static_cast<int>(rowIndexOut.size()) - 1;
+    ASSERT_LE(firstRow + nRows, 4);
+    for (auto i = 0; i <= nRows; ++i) {
+        EXPECT_EQ(rowIndexOut[i], rowIndex[firstRow + i] - rowIndex[firstRow]);
+    }
+    for (std::size_t k = 0; k < valuesOut.size(); ++k) {
+        EXPECT_EQ(columnIndexOut[k], columnIndex[rowIndex[firstRow] + k]);
+        EXPECT_EQ(valuesOut[k], values[rowIndex[firstRow] + k]);
+    }
+
+    // every row is on some process
+    int totalRows;
+    MPI_Allreduce(&nRows, &totalRows, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    EXPECT_EQ(totalRows, 4);
+#endif
+
+    // the volume vector is also only on root
+#ifdef ELA_USE_MPI
+    auto vv = output::VolumeVector(3, MPI_COMM_WORLD);
+#else
+    auto vv = output::VolumeVector(3);
+#endif
+    if (RankEqual(1)) vv.addCell(3, 0.25);
+    vv.finalize();
+
+    std::vector<output::Fp_BinType> vvValues;
+    vv.getValues(vvValues);
+    if (RankEqual(0)) {
+        EXPECT_EQ(vvValues, std::vector<output::Fp_BinType>({0.0, 0.0, 0.25}));
+    }
+    else {
+        EXPECT_TRUE(vvValues.empty());
+    }
+}
+
+TEST(Output, MatrixEncoding)
+{
+#ifdef ELA_USE_MPI
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+#else
+    auto vtm = output::VolumeTrackingMatrix(4);
+#endif
+    fillSparseMatrix(vtm);
+
+    // a row with many repeated values, which compress well
+    if (RankEqual(0)) {
+        svec::SVector s;
+        for (svec::Label l = 1; l <= 1000; ++l) {
+            s.add(svec::SVector(svec::Element{3 * l, 0.25}));
+        }
+        vtm.addCell(2, 1.0, s);
+    }
+    vtm.finalize();
+
+    vtm.write("temp_a.bin");
+    vtm.write("temp_b.bin", output::MatrixEncoding::compact);
+    vtm.write("temp_c.bin", output::MatrixEncoding::compactShuffled);
+
+    if (RankEqual(0)) {
+        std::vector<output::Int_BinType> rowIndexA, columnIndexA, rowIndex, columnIndex;
+        std::vector<output::Fp_BinType> valuesA, values;
+        output::readMatrix("temp_a.bin", rowIndexA, columnIndexA, valuesA);
+        ASSERT_EQ(rowIndexA.size(), 5);
+        EXPECT_EQ(rowIndexA[4], 1008);
+
+        // both versions decode to the same matrix
+        for (const char* filename : {"temp_b.bin", "temp_c.bin"}) {
+            output::readMatrix(filename, rowIndex, columnIndex, values);
+            EXPECT_EQ(rowIndex, rowIndexA);
+            EXPECT_EQ(columnIndex, columnIndexA);
+            EXPECT_EQ(values, valuesA);
+        }
+
+        // and are smaller
+        auto readFile = [](const char* filename) {
+            std::ifstream input(filename, std::ios::binary);
+            return std::vector<char>(std::istreambuf_iterator<char>(input), {});
+        };
+        const auto a = readFile("temp_a.bin");
+        const auto b = readFile("temp_b.bin");
+        auto c = readFile("temp_c.bin");
+        EXPECT_LT(b.size(), a.size() * 4 / 5);
+        EXPECT_LT(c.size(), b.size() / 4);
+
+        // tagged with the version
+        EXPECT_TRUE(std::equal(c.begin(), c.begin() + 4, output::matrixMagic));
+
+        // truncated
+        EXPECT_THROW(
+            output::decodeMatrix(c.data(), c.size() - 1, rowIndex, columnIndex, values),
+            std::runtime_error
+        );
+        EXPECT_THROW(
+            output::decodeMatrix(a.data(), a.size() - 8, rowIndex, columnIndex, values),
+            std::runtime_error
+        );
+
+        remove("temp_a.bin");
+        remove("temp_b.bin");
+        remove("temp_c.bin");
+    }
+}
+
+TEST(Output, Container)
+{
+#ifdef ELA_USE_MPI
+    auto vtm = output::VolumeTrackingMatrix(4, MPI_COMM_WORLD);
+    auto vv = output::VolumeVector(3, MPI_COMM_WORLD);
+#else
+    auto vtm = output::VolumeTrackingMatrix(4);
+    auto vv = output::VolumeVector(3);
+#endif
+    fillSparseMatrix(vtm);
+    if (RankEqual(0)) vv.addCell(2, 1.5);
+    vtm.finalize();
+    vv.finalize();
+
+    // the files written separately
+    vtm.write("temp_a.bin");
+    vv.write("temp_b.bin");
+
+    remove("temp_c.dat");
+    remove("temp_c.idx");
+    {
+        output::ContainerWriter container("temp_c.dat", "temp_c.idx");
+        vtm.writeToContainer(container, 7, 0.5);
+        vv.writeToContainer(container, 7, 0.5);
+        container.close();
+
+        // appended to when opened again
+        vtm.writeToContainer(container, 8, 0.75);
+    }
+
+    if (RankEqual(0)) {
+        output::ContainerReader reader("temp_c.dat", "temp_c.idx");
+        ASSERT_EQ(reader.size(), 3);
+
+        const auto& entry = reader.getEntry(0);
+        EXPECT_EQ(
+            entry.kind, static_cast<output::Int_BinType>(output::SnapshotKind::trackingMatrix)
+        );
+        EXPECT_EQ(entry.t_num, 7);
+        EXPECT_DOUBLE_EQ(entry.time, 0.5);
+        EXPECT_EQ(entry.rc, 4);
+        EXPECT_EQ(entry.nnz, 8);
+        EXPECT_EQ(entry.offset, output::containerHeaderSize);
+
+        EXPECT_EQ(reader.find(output::SnapshotKind::volumeVector, 7), 1);
+        EXPECT_EQ(reader.find(output::SnapshotKind::trackingMatrix, 8), 2);
+        EXPECT_EQ(reader.find(output::SnapshotKind::volumeVector, 8), 3);
+
+        // each snapshot has the same bytes as the file
+        auto readFile = [](const char* filename) {
+            std::ifstream input(filename, std::ios::binary);
+            return std::vector<char>(std::istreambuf_iterator<char>(input), {});
+        };
+        const auto container = readFile("temp_c.dat");
+        const auto a = readFile("temp_a.bin");
+        const auto b = readFile("temp_b.bin");
+        ASSERT_EQ(reader.getEntry(1).size, b.size());
+        EXPECT_TRUE(std::equal(a.begin(), a.end(), container.begin() + entry.offset));
+        EXPECT_TRUE(std::equal(b.begin(), b.end(), container.begin() + reader.getEntry(1).offset));
+
+        // read back
+        std::vector<output::Int_BinType> rowIndex, columnIndex;
+        std::vector<output::Fp_BinType> values;
+        reader.readTrackingMatrix(2, rowIndex, columnIndex, values);
+        EXPECT_EQ(rowIndex, std::vector<output::Int_BinType>({0, 2, 4, 7, 8}));
+        EXPECT_EQ(columnIndex, std::vector<output::Int_BinType>({1, 2, 2, 4, 3, 4, 5, 6}));
+        EXPECT_DOUBLE_EQ(values[7], 80);
+
+        reader.readVolumeVector(1, values);
+        ASSERT_EQ(values.size(), 3);
+        EXPECT_DOUBLE_EQ(values[1], 1.5);
+
+        EXPECT_THROW(reader.readVolumeVector(0, values), std::runtime_error);
+
+        remove("temp_a.bin");
+        remove("temp_b.bin");
+        remove("temp_c.dat");
+        remove("temp_c.idx");
+    }
+}
+
+TEST(Output, Events)
+{
+    if (!RankEqual(0)) return;
+
+    using output::EventKind;
+    auto expectEvent = [](const output::Event& event, const int& t_num, const EventKind& kind,
+                          const int& label, const int& partner, const double& volume) {
+        EXPECT_EQ(event.t_num, t_num);
+        EXPECT_EQ(event.kind, static_cast<output::Int_BinType>(kind));
+        EXPECT_EQ(event.label, label);
+        EXPECT_EQ(event.partner, partner);
+        EXPECT_DOUBLE_EQ(event.volume, volume);
+    };
+
+    output::EventDetector detector;
+    output::EventThresholds thresholds;
+    thresholds.minVolume = 0.01;
+
+    // at n=0, all are born
+    auto events =
+        detector.detect(0, 0.0, {2.0, 3.0, 1.0, 5.0}, {0, 0, 0, 0, 0}, {}, {}, thresholds);
+    ASSERT_EQ(events.size(), 4);
+    expectEvent(events[3], 0, EventKind::birth, 4, 0, 5.0);
+
+    // blobs 1 and 2 merge into 1, 4 splits into 2 and 3, 3 dies, and 4 is born
+    // the link from 1 to 2 is too small
+    const std::vector<output::Int_BinType> rowIndex = {0, 2, 4, 5, 5};
+    const std::vector<output::Int_BinType> columnIndex = {1, 2, 1, 4, 4};
+    const std::vector<output::Fp_BinType> values = {2.0, 3.0, 0.001, 2.0, 3.0};
+    const std::vector<output::Fp_BinType> volumes = {5.0, 2.001, 3.0, 1.0};
+    events = detector.detect(1, 0.5, volumes, rowIndex, columnIndex, values, thresholds);
+    ASSERT_EQ(events.size(), 6);
+    expectEvent(events[0], 1, EventKind::merge, 1, 1, 2.0);
+    expectEvent(events[1], 1, EventKind::merge, 1, 2, 3.0);
+    expectEvent(events[2], 1, EventKind::split, 4, 2, 2.0);
+    expectEvent(events[3], 1, EventKind::split, 4, 3, 3.0);
+    expectEvent(events[4], 1, EventKind::birth, 4, 0, 1.0);
+    expectEvent(events[5], 1, EventKind::death, 3, 0, 1.0);
+    EXPECT_DOUBLE_EQ(events[5].time, 0.5);
+
+    // without the threshold, 1 also splits, and 1 and 4 merge into 2
+    output::EventDetector any;
+    any.detect(0, 0.0, {2.0, 3.0, 1.0, 5.0}, {0, 0, 0, 0, 0}, {}, {}, {});
+    EXPECT_EQ(any.detect(1, 0.5, volumes, rowIndex, columnIndex, values, {}).size(), 10);
+
+    // or the link is a small fraction of blob 1
+    thresholds.minVolume = 0.0;
+    thresholds.minFraction = 0.01;
+    output::EventDetector fraction;
+    fraction.detect(0, 0.0, {2.0, 3.0, 1.0, 5.0}, {0, 0, 0, 0, 0}, {}, {}, thresholds);
+    EXPECT_EQ(
+        fraction.detect(1, 0.5, volumes, rowIndex, columnIndex, values, thresholds).size(), 6
+    );
+
+    // appended to the log
+    remove("temp_events.bin");
+    output::writeEvents("temp_events.bin", events);
+    output::writeEvents("temp_events.bin", {});
+    output::writeEvents("temp_events.bin", events);
+
+    std::ifstream input("temp_events.bin", std::ios::binary);
+    std::vector<output::Event> read(12);
+    input.read(reinterpret_cast<char*>(read.data()), read.size() * sizeof(output::Event));
+    ASSERT_EQ(input.gcount(), static_cast<std::streamsize>(12 * sizeof(output::Event)));
+    EXPECT_EQ(input.peek(), EOF);
+    expectEvent(read[11], 1, EventKind::death, 3, 0, 1.0);
+    input.close();
+
+    remove("temp_events.bin");
+}
+
 TEST(Output, ASCIILog)
 {
     typedef svec::SVector S;
@@ -303,3 +931,130 @@ TEST(Output, ASCIILog)
         fclose(f);
     }
 }
+
+TEST(Output, ASCIILogSnapshots)
+{
+    typedef svec::SVector S;
+    typedef svec::Element E;
+
+#ifdef ELA_USE_MPI
+    output::ASCIILog log = output::ASCIILog(MPI_COMM_WORLD);
+#else
+    output::ASCIILog log = output::ASCIILog();
+#endif
+
+    // first snapshot
+    if (RankEqual(1)) log.addCell(S(E{3, 1.0}), 2.0, 1.0);
+    if (RankEqual(2)) log.addCell(S(E{1, 0.5}), 2.0, 1.0);
+
+    // second snapshot
+    log.startSnapshot();
+    if (RankEqual(0)) log.addCell(S(E{7, 0.25}), 4.0, 0.25);
+
+    ASSERT_EQ(log.getSnapshotCount(), 2);
+
+    log.finalize();
+
+    if (RankEqual(0)) {
+        std::remove("tracking_snapshots.log");
+    }
+
+    const double times[2] = {0.5, 1.5};
+    log.write("tracking_snapshots.log", times);
+
+    if (RankEqual(0)) {
+        FILE* f = std::fopen("tracking_snapshots.log", "r");
+        for (auto n = 0; n < 2; ++n) {
+            float time;
+            svec::Label maxLabel;
+            float minValue;
+            float maxValue;
+            float volError;
+            float volErrorRel;
+            std::size_t maxNNZ;
+
+            int status = fscanf(
+                f, "%15E%18u%18E%18E%18E%18E%9lu", &time, &maxLabel, &maxValue, &minValue,
+                &volError, &volErrorRel, &maxNNZ
+            );
+            if (status != 7) {
+                FAIL() << "Error reading tracking_snapshots.log";
+            }
+
+            ASSERT_FLOAT_EQ(time, times[n]);
+            ASSERT_EQ(maxLabel, (n == 0 ? 3 : 7));
+            ASSERT_FLOAT_EQ(minValue, (n == 0 ? 0.5 : 0.25));
+            ASSERT_FLOAT_EQ(volError, (n == 0 ? -1.0 : 0.0));
+            ASSERT_EQ(maxNNZ, 1);
+        }
+        fclose(f);
+    }
+}
+
+TEST(Output, ASCIILogInstances)
+{
+    typedef svec::SVector S;
+    typedef svec::Element E;
+
+#ifdef ELA_USE_MPI
+    output::ASCIILog log = output::ASCIILog(MPI_COMM_WORLD);
+    output::ASCIILog part = output::ASCIILog(MPI_COMM_WORLD);
+#else
+    output::ASCIILog log = output::ASCIILog();
+    output::ASCIILog part = output::ASCIILog();
+#endif
+
+    // a snapshot for each of two instances, added to in any order
+    log.startSnapshot();
+    part.startSnapshot();
+    if (RankEqual(0)) part.addCell(1, S(E{7, 0.25}), 4.0, 0.25);
+    if (RankEqual(1)) part.addCell(0, S(E{3, 1.0}), 2.0, 1.0);
+    log.merge(part);
+
+    log.finalize();
+
+    if (RankEqual(0)) {
+        std::remove("tracking_instance_0.log");
+        std::remove("tracking_instance_1.log");
+    }
+
+    log.writeSnapshot("tracking_instance_0.log", 0, 0.5);
+    log.writeSnapshot("tracking_instance_1.log", 1, 0.5);
+
+    if (RankEqual(0)) {
+        for (auto n = 0; n < 2; ++n) {
+            FILE* f = std::fopen(
+                n == 0 ? "tracking_instance_0.log" : "tracking_instance_1.log", "r"
+            );
+            ASSERT_NE(f, nullptr);
+
+            float time;
+            svec::Label maxLabel;
+            float minValue;
+            float maxValue;
+            float volError;
+            float volErrorRel;
+            std::size_t maxNNZ;
+
+            int status = fscanf(
+                f, "%15E%18u%18E%18E%18E%18E%9lu", &time, &maxLabel, &maxValue, &minValue,
+                &volError, &volErrorRel, &maxNNZ
+            );
+            if (status != 7) {
+                FAIL() << "Error reading tracking_instance log";
+            }
+
+            // a single line
+            char c;
+            EXPECT_NE(fscanf(f, " %c", &c), 1);
+            fclose(f);
+
+            ASSERT_FLOAT_EQ(time, 0.5);
+            ASSERT_EQ(maxLabel, (n == 0 ? 3 : 7));
+            ASSERT_FLOAT_EQ(minValue, (n == 0 ? 1.0 : 0.25));
+        }
+
+        std::remove("tracking_instance_0.log");
+        std::remove("tracking_instance_1.log");
+    }
+}
@@ -1,25 +1,27 @@
 #include "vtm.h"
+#include "binarywriter.h"
+#include "container.h"
 
+#include <algorithm>
 #include <cstring>
 
 using namespace output;
 
 #ifdef ELA_USE_MPI
-VolumeTrackingMatrix::VolumeTrackingMatrix(const int& rowCount, MPI_Comm comm_in)
-    : comm(comm_in),
+VolumeTrackingMatrix::VolumeTrackingMatrix(
+    const int& rowCount, MPI_Comm comm_in, const bool& distributed_in, MPI_Comm writeComm_in
+)
+    : comm(comm_in), nProc(0), distributed(distributed_in),
+      writeComm(writeComm_in == MPI_COMM_NULL ? comm_in : writeComm_in), reduceRows(true),
+      stage(0), first(0), mask(0), request(MPI_REQUEST_NULL),
 #else
 VolumeTrackingMatrix::VolumeTrackingMatrix(const int& rowCount)
     :
 #endif
-      rc(rowCount), row(new svec::SVector[rc])
+      rc(rowCount), accumulated(rc)
 {
 }
 
-VolumeTrackingMatrix::~VolumeTrackingMatrix()
-{
-    delete[] row;
-}
-
 void VolumeTrackingMatrix::addCell(
     const Int_BinType& label, const svec::Value& volume, const svec::SVector& s
 )
@@ -27,132 +29,480 @@ void VolumeTrackingMatrix::addCell(
     assert(label > 0 && label <= Int_BinType(rc));
 
     // TODO: need to later make sure we dont output column labels <= 0
-    row[label - 1].add(s, volume);
+    accumulated[label - 1].add(s, volume);
+}
+
+void VolumeTrackingMatrix::merge(VolumeTrackingMatrix& part)
+{
+    if (part.accumulated.size() > accumulated.size()) {
+        accumulated.resize(part.accumulated.size());
+        rc = static_cast<int>(accumulated.size());
+    }
+
+    for (std::size_t i = 0; i < part.accumulated.size(); ++i) {
+        accumulated[i].merge(part.accumulated[i]);
+    }
+    std::vector<RowAccumulator>().swap(part.accumulated);
+}
+
+void VolumeTrackingMatrix::mergeRow(const Int_BinType& label, RowAccumulator& row)
+{
+    assert(label > 0 && label <= Int_BinType(rc));
+    accumulated[label - 1].merge(row);
+}
+
+void VolumeTrackingMatrix::setRowCount(const int& rowCount)
+{
+    assert(rowCount >= rc);
+    rc = rowCount;
+#ifdef ELA_USE_MPI
+    reduceRows = false;
+#endif
 }
 
 void VolumeTrackingMatrix::finalize()
 {
+    startFinalize();
+    while (!continueFinalize()) {
+    }
+}
+
+void VolumeTrackingMatrix::startFinalize()
+{
+    // sort the accumulated rows
+    row.resize(accumulated.size());
+    for (std::size_t i = 0; i < row.size(); ++i) {
+        row[i] = accumulated[i].release();
+    }
+    std::vector<RowAccumulator>().swap(accumulated);
+
     // remove label = 0 from s
-    for (auto i = 0; i < rc; ++i) {
-        row[i].zeroEntry(0);
+    for (auto& s : row) {
+        s.zeroEntry(0);
     }
 
 #ifdef ELA_USE_MPI
     // figure out the rank and number of tasks
-    int nProc;
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &nProc);
 
-    int len = 0;
-    if (rank != 0) {
-        // calculate compressed size
-        for (const svec::SVector* s_ptr = row; s_ptr < row + rc; s_ptr++) {
-            len += s_ptr->NNZ() + 1;
+    if (distributed) {
+        // everyone needs the row count to split the rows
+        if (reduceRows) MPI_Iallreduce(MPI_IN_PLACE, &rc, 1, MPI_INT, MPI_MAX, comm, &request);
+        stage = 1;
+        return;
+    }
+
+    tag = getReductionTag();
+
+    mask = 1;
+    nextLevel();
+#endif
+}
+
+#ifdef ELA_USE_MPI
+void VolumeTrackingMatrix::nextLevel()
+{
+    // skip levels with no partner
+    while (mask < nProc && !(rank & mask) && rank + mask >= nProc) {
+        mask <<= 1;
+    }
+
+    // root is done
+    if (mask >= nProc) return;
+
+    // wait for more rows
+    if (!(rank & mask)) return;
+
+    // calculate compressed size
+    std::size_t len = 0;
+    for (const auto& s : row) {
+        len += s.NNZ() + 1;
+    }
+    buff.resize(len);
+
+    // compress rows
+    svec::Element* ptr = buff.data();
+    for (const auto& s : row) {
+        const auto& nnz = s.NNZ();
+
+        if (nnz != 0) {
+            std::memcpy(ptr, s.data(), nnz * sizeof(svec::Element));
+            ptr += nnz;
         }
 
-        // send to root
-        MPI_Reduce(&len, nullptr, 1, MPI_INT, MPI_MAX, 0, comm);
+        *ptr++ = svec::END_ELEMENT;
+    }
+
+    // send to parent
+    MPI_Isend(
+        buff.data(), len * sizeof(svec::Element), MPI_BYTE, rank - mask, tag, comm, &request
+    );
+}
+#endif
+
+bool VolumeTrackingMatrix::continueFinalize()
+{
+#ifdef ELA_USE_MPI
+    if (distributed) return continueDistributed();
+
+    if (mask >= nProc) return true;
+
+    int done;
+    if (rank & mask) {
+        // the parent has everything from this task once sent
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        if (!done) return false;
+        std::vector<svec::Element>().swap(buff);
+        mask = nProc;
+        return true;
+    }
+
+    // receive the rows of the child
+    MPI_Message message;
+    MPI_Status status;
+    MPI_Improbe(rank + mask, tag, comm, &done, &message, &status);
+    if (!done) return false;
+
+    int len;
+    MPI_Get_count(&status, MPI_BYTE, &len);
+    buff.resize(len / sizeof(svec::Element));
+    MPI_Mrecv(buff.data(), len, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+
+    // the child has higher ranks, so add after to be deterministic
+    const svec::Element* ptr = buff.data();
+    const svec::Element* const end = ptr + buff.size();
+    for (std::size_t i = 0; ptr < end; ++i) {
+        // decompress incoming data
+        svec::SVector s_recv = svec::SVector(ptr);
+        ptr += s_recv.NNZ() + 1;
+
+        // add to current row, the child may have more
+        if (i == row.size()) row.emplace_back();
+        row[i].add(s_recv);
     }
-    else {
-        // figure out max buffer size
-        MPI_Reduce(MPI_IN_PLACE, &len, 1, MPI_INT, MPI_MAX, 0, comm);
+    rc = std::max(rc, static_cast<int>(row.size()));
+
+    mask <<= 1;
+    nextLevel();
+
+    if (mask >= nProc) {
+        std::vector<svec::Element>().swap(buff);
+        return true;
     }
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool VolumeTrackingMatrix::hasCollectivesToStart() const
+{
+#ifdef ELA_USE_MPI
+    // the last is the exchange of the rows
+    return distributed && stage < 3;
+#else
+    return false;
+#endif
+}
+
+#ifdef ELA_USE_MPI
+// first row owned by process p when distributed
+static int getFirstRow(const int& p, const int& nProc, const int& rc)
+{
+    return static_cast<int>(static_cast<long long>(p) * rc / nProc);
+}
 
-    // allocate buffer
-    svec::Element* const buff = new svec::Element[len];
+bool VolumeTrackingMatrix::continueDistributed()
+{
+    if (stage == 4) return true;
 
-    if (rank != 0) {
-        // compress rows
-        svec::Element* ptr = buff;
-        for (const svec::SVector* s_ptr = row; s_ptr < row + rc; s_ptr++) {
-            const auto& nnz = s_ptr->NNZ();
+    int done;
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    if (!done) return false;
 
+    if (stage == 1) {
+        // compress rows, in order of the process which owns them
+        std::size_t len = 0;
+        for (const auto& s : row) {
+            len += s.NNZ() + 1;
+        }
+        buff.resize(len);
+
+        sendCounts.assign(nProc, 0);
+        sendDispls.assign(nProc, 0);
+        svec::Element* ptr = buff.data();
+        int p = 0;
+        for (auto i = 0; i < static_cast<int>(row.size()); ++i) {
+            while (i >= getFirstRow(p + 1, nProc, rc)) {
+                sendDispls[++p] = (ptr - buff.data()) * sizeof(svec::Element);
+            }
+
+            const auto& nnz = row[i].NNZ();
             if (nnz != 0) {
-                std::memcpy(ptr, s_ptr->data(), nnz * sizeof(svec::Element));
+                std::memcpy(ptr, row[i].data(), nnz * sizeof(svec::Element));
                 ptr += nnz;
             }
-
             *ptr++ = svec::END_ELEMENT;
+
+            sendCounts[p] += (nnz + 1) * sizeof(svec::Element);
+        }
+        while (p + 1 < nProc) {
+            sendDispls[++p] = len * sizeof(svec::Element);
         }
 
-        // send to boss
-        MPI_Send(buff, len * sizeof(svec::Element), MPI_BYTE, 0, 1, comm);
+        // rows are no longer needed
+        std::vector<svec::SVector>().swap(row);
+
+        // everyone needs to know how much they get
+        recvCounts.resize(nProc);
+        MPI_Ialltoall(
+            sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm, &request
+        );
+        stage = 2;
+        return false;
+    }
+
+    if (stage == 2) {
+        recvDispls.resize(nProc);
+        int total = 0;
+        for (auto p = 0; p < nProc; ++p) {
+            recvDispls[p] = total;
+            total += recvCounts[p];
+        }
+        recvBuff.resize(total / sizeof(svec::Element));
+
+        MPI_Ialltoallv(
+            buff.data(), sendCounts.data(), sendDispls.data(), MPI_BYTE, recvBuff.data(),
+            recvCounts.data(), recvDispls.data(), MPI_BYTE, comm, &request
+        );
+        stage = 3;
+        return false;
     }
-    else {
-        // for each other task
-        for (auto n = 1; n < nProc; ++n) {
-            // receive the data (go in order to be deterministic)
-            MPI_Recv(buff, len * sizeof(svec::Element), MPI_BYTE, n, 1, comm, MPI_STATUS_IGNORE);
 
-            svec::Element* ptr = buff;
-            for (svec::SVector* s_ptr = row; s_ptr < row + rc; s_ptr++) {
+    if (stage == 3) {
+        first = getFirstRow(rank, nProc, rc);
+        row.resize(getFirstRow(rank + 1, nProc, rc) - first);
+
+        // for each task (go in order to be deterministic)
+        for (auto p = 0; p < nProc; ++p) {
+            const svec::Element* ptr = recvBuff.data() + recvDispls[p] / sizeof(svec::Element);
+            const svec::Element* const end = ptr + recvCounts[p] / sizeof(svec::Element);
+            for (std::size_t i = 0; ptr < end; ++i) {
                 // decompress incoming data
                 svec::SVector s_recv = svec::SVector(ptr);
                 ptr += s_recv.NNZ() + 1;
 
                 // add to current row
-                (*s_ptr).add(s_recv);
+                row[i].add(s_recv);
             }
         }
+
+        // release the buffers
+        std::vector<svec::Element>().swap(buff);
+        std::vector<svec::Element>().swap(recvBuff);
+        stage = 4;
     }
 
-    delete[] buff;
-#endif
+    return true;
 }
 
-void output::VolumeTrackingMatrix::write(const char* filename)
+void VolumeTrackingMatrix::writeDistributed(const char* filename)
 {
+    const int nRows = static_cast<int>(row.size());
+
+    // ROW_INDEX for the rows of this task, relative to its first non-zero
+    std::vector<Int_BinType> ROW_INDEX(nRows);
+    Int_BinType nnz = 0;
+    for (auto i = 0; i < nRows; ++i) {
+        nnz += row[i].NNZ();
+        ROW_INDEX[i] = nnz;
+    }
+
+    // the first non-zero of this task, and the total
+    Int_BinType offset = 0;
+    MPI_Exscan(&nnz, &offset, 1, MPI_INT_BINTYPE, MPI_SUM, writeComm);
+    if (rank == 0) offset = 0;
+
+    Int_BinType NNZ;
+    MPI_Allreduce(&nnz, &NNZ, 1, MPI_INT_BINTYPE, MPI_SUM, writeComm);
+
+    for (auto& r : ROW_INDEX) {
+        r += offset;
+    }
+
+    // gather COLUMN_INDEX and VALUES
+    std::vector<Int_BinType> COLUMN_INDEX;
+    std::vector<Fp_BinType> VALUES;
+    COLUMN_INDEX.reserve(nnz);
+    VALUES.reserve(nnz);
+    for (const auto& s : row) {
+        for (const auto elm : s) {
+            COLUMN_INDEX.push_back(static_cast<Int_BinType>(elm.l));
+            VALUES.push_back(static_cast<Fp_BinType>(elm.v));
+        }
+    }
+
+    // where each section starts
+    constexpr MPI_Offset headerSize = 2 * sizeof(Int_BinType);
+    const MPI_Offset rowIndexStart = headerSize;
+    const MPI_Offset columnIndexStart = rowIndexStart + MPI_Offset(rc) * sizeof(Int_BinType);
+    const MPI_Offset valuesStart = columnIndexStart + MPI_Offset(NNZ) * sizeof(Int_BinType);
+    const MPI_Offset fileSize = valuesStart + MPI_Offset(NNZ) * sizeof(Fp_BinType);
+
+    // Open file
+    MPI_File file;
+    MPI_File_open(writeComm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    MPI_File_set_size(file, fileSize);
+
+    // Write ROW_COUNT and NNZ
+    const Int_BinType header[2] = {static_cast<Int_BinType>(rc), NNZ};
+    MPI_File_write_at_all(
+        file, 0, header, (rank == 0 ? 2 : 0), MPI_INT_BINTYPE, MPI_STATUS_IGNORE
+    );
+
+    // Write ROW_INDEX (excluding starting zero)
+    MPI_File_write_at_all(
+        file, rowIndexStart + MPI_Offset(first) * sizeof(Int_BinType), ROW_INDEX.data(), nRows,
+        MPI_INT_BINTYPE, MPI_STATUS_IGNORE
+    );
+
+    // Write COLUMN_INDEX
+    MPI_File_write_at_all(
+        file, columnIndexStart + MPI_Offset(offset) * sizeof(Int_BinType), COLUMN_INDEX.data(),
+        nnz, MPI_INT_BINTYPE, MPI_STATUS_IGNORE
+    );
+
+    // Write VALUES
+    MPI_File_write_at_all(
+        file, valuesStart + MPI_Offset(offset) * sizeof(Fp_BinType), VALUES.data(), nnz,
+        MPI_FP_BINTYPE, MPI_STATUS_IGNORE
+    );
+
+    // Close file
+    MPI_File_close(&file);
+}
+#endif
+
+void VolumeTrackingMatrix::getRows(
+    int& firstRow, std::vector<Int_BinType>& rowIndex, std::vector<Int_BinType>& columnIndex,
+    std::vector<Fp_BinType>& values
+) const
+{
+    firstRow = 0;
+    int nRows = rc;
 #ifdef ELA_USE_MPI
-    // Only rank==0 does anything
-    if (rank != 0) return;
+    if (distributed) {
+        firstRow = first;
+        nRows = static_cast<int>(row.size());
+    }
+    else if (rank != 0) {
+        // the rows are on root
+        nRows = 0;
+    }
 #endif
 
     // calculate ROW_INDEX
-    Int_BinType* const ROW_INDEX = new Int_BinType[rc + 1];
+    rowIndex.resize(nRows + 1);
+    rowIndex[0] = 0;
+    for (auto i = 0; i < nRows; ++i) {
+        rowIndex[i + 1] = rowIndex[i] + row[i].NNZ();
+    }
 
-    ROW_INDEX[0] = 0;
-    for (auto i = 0; i < rc; ++i) {
-        ROW_INDEX[i + 1] = ROW_INDEX[i] + row[i].NNZ();
+    // calculate COLUMN_INDEX and VALUES
+    columnIndex.clear();
+    values.clear();
+    columnIndex.reserve(rowIndex[nRows]);
+    values.reserve(rowIndex[nRows]);
+    for (auto i = 0; i < nRows; ++i) {
+        for (const auto elm : row[i]) {
+            columnIndex.push_back(static_cast<Int_BinType>(elm.l));
+            values.push_back(static_cast<Fp_BinType>(elm.v));
+        }
     }
+}
+
+void VolumeTrackingMatrix::writeTo(BinaryWriter& outputFile, const MatrixEncoding& encoding)
+{
+    if (encoding != MatrixEncoding::plain) {
+        writeCompactMatrix(outputFile, row, rc, encoding);
+        return;
+    }
+
+    int firstRow;
+    std::vector<Int_BinType> ROW_INDEX, COLUMN_INDEX;
+    std::vector<Fp_BinType> VALUES;
+    getRows(firstRow, ROW_INDEX, COLUMN_INDEX, VALUES);
 
     // total number of non-zeros
     const Int_BinType& NNZ = ROW_INDEX[rc];
 
-    // Open file
-    std::ofstream outputFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
-
     // Write ROW_COUNT
     Int_BinType ROW_COUNT = static_cast<Int_BinType>(rc);
-    outputFile.write(reinterpret_cast<const char*>(&(ROW_COUNT)), sizeof(Int_BinType));
+    outputFile.write(ROW_COUNT);
 
     // Write NNZ
-    outputFile.write(reinterpret_cast<const char*>(&(NNZ)), sizeof(Int_BinType));
+    outputFile.write(NNZ);
 
     // Write ROW_INDEX (excluding starting zero)
-    outputFile.write(reinterpret_cast<const char*>(ROW_INDEX + 1), rc * sizeof(Int_BinType));
-
-    delete[] ROW_INDEX;
+    outputFile.write(ROW_INDEX.data() + 1, rc);
 
     // Write COLUMN_INDEX
-    for (auto i = 0; i < rc; ++i) {
-        for (const auto elm : row[i]) {
-            Int_BinType column = static_cast<Int_BinType>(elm.l);
-            outputFile.write(reinterpret_cast<const char*>(&column), sizeof(Int_BinType));
-        }
-    }
+    outputFile.write(COLUMN_INDEX.data(), NNZ);
 
     // Write VALUES
-    for (auto i = 0; i < rc; ++i) {
-        for (const auto elm : row[i]) {
-            Fp_BinType value = static_cast<Fp_BinType>(elm.v);
-            outputFile.write(reinterpret_cast<const char*>(&value), sizeof(Fp_BinType));
-        }
+    outputFile.write(VALUES.data(), NNZ);
+}
+
+void output::VolumeTrackingMatrix::write(const char* filename, const MatrixEncoding& encoding)
+{
+#ifdef ELA_USE_MPI
+    // everyone writes their part
+    if (distributed) {
+        writeDistributed(filename);
+        return;
     }
 
+    // Only rank==0 does anything
+    if (rank != 0) return;
+#endif
+
+    // Open file
+    BinaryWriter outputFile(filename, false, directIO);
+
+    writeTo(outputFile, encoding);
+
     // Close file
     outputFile.close();
 }
 
+void VolumeTrackingMatrix::writeToContainer(
+    ContainerWriter& container, const int& t_num, const double& time,
+    const MatrixEncoding& encoding
+)
+{
+#ifdef ELA_USE_MPI
+    // the rows are on root
+    assert(!distributed);
+
+    // Only rank==0 does anything
+    if (rank != 0) return;
+#endif
+
+    Int_BinType NNZ = 0;
+    for (const auto& s : row) {
+        NNZ += s.NNZ();
+    }
+
+    container.append(
+        ContainerEntry{
+            static_cast<Int_BinType>(SnapshotKind::trackingMatrix),
+            static_cast<Int_BinType>(t_num), static_cast<Fp_BinType>(time),
+            static_cast<Int_BinType>(rc), NNZ, 0, 0},
+        [this, &encoding](BinaryWriter& outputFile) { writeTo(outputFile, encoding); }
+    );
+}
+
 void output::VolumeTrackingMatrix::writeToLog(
     const char* filename, const double& t_num, const double& time
 )
@@ -166,12 +516,15 @@ void output::VolumeTrackingMatrix::writeToLog(
     Int_BinType ROW_COUNT = static_cast<Int_BinType>(rc);
     Fp_BinType T = static_cast<Fp_BinType>(time);
 
+    // the whole record is appended in a single write
+    constexpr std::size_t recordSize = 2 * sizeof(Int_BinType) + sizeof(Fp_BinType);
+
     // Open file, note that this is in append mode
-    std::ofstream outputFile(filename, std::ios::out | std::ios::binary | std::ios::app);
+    BinaryWriter outputFile(filename, true, false, recordSize);
 
-    outputFile.write(reinterpret_cast<const char*>(&(T_NUM)), sizeof(Int_BinType));
-    outputFile.write(reinterpret_cast<const char*>(&(ROW_COUNT)), sizeof(Int_BinType));
-    outputFile.write(reinterpret_cast<const char*>(&(T)), sizeof(Fp_BinType));
+    outputFile.write(T_NUM);
+    outputFile.write(ROW_COUNT);
+    outputFile.write(T);
 
     // Close file
     outputFile.close();
@@ -2,35 +2,198 @@
 #define VTM_H
 
 #include "../svector/svector.h"
+#include "matrixencoding.h"
 #include "output.h"
+#include "rowaccumulator.h"
+
+#include <vector>
 
 namespace output {
 
+class BinaryWriter;
+class ContainerWriter;
+
 class VolumeTrackingMatrix {
   public:
 #ifdef ELA_USE_MPI
-    VolumeTrackingMatrix(const int& rowCount, MPI_Comm comm);
+    /**
+     * @param rowCount The number of rows known to this process
+     * @param comm The processes the matrix is summed over
+     * @param distributed If true, the rows are summed and written in parallel rather than on root
+     * @param writeComm The same processes as \p comm, for writing when distributed, so the
+     * collective writes are ordered apart from the reductions (\p comm if null)
+     */
+    VolumeTrackingMatrix(
+        const int& rowCount, MPI_Comm comm, const bool& distributed = false,
+        MPI_Comm writeComm = MPI_COMM_NULL
+    );
 #else
     VolumeTrackingMatrix(const int& rowCount);
 #endif
 
-    ~VolumeTrackingMatrix();
-
     void addCell(const Int_BinType& label, const svec::Value& volume, const svec::SVector& s);
 
+    /**
+     * @brief Add the cells added to \p part, leaving it empty
+     *
+     * Parts of the field can be added to separate matrices (e.g., on different threads), then
+     * merged. So long as the parts are the same and merged in the same order, the sums are too.
+     *
+     * @note Must be called before startFinalize()
+     */
+    void merge(VolumeTrackingMatrix& part);
+
+    /**
+     * @brief Add \p row, the sum of cells of \p label added elsewhere (e.g., over one block of the
+     * field), leaving it empty
+     *
+     * As merge(), but only for one row, so parts need only hold the rows they have cells of.
+     *
+     * @note Must be called before startFinalize()
+     */
+    void mergeRow(const Int_BinType& label, RowAccumulator& row);
+
+    /**
+     * @brief Set the row count to \p rowCount, the largest of any process, so startFinalize()
+     * need not reduce it (e.g., VolumeVector::getRowCount() of the same labels)
+     *
+     * @note Must be called before startFinalize()
+     */
+    void setRowCount(const int& rowCount);
+
     void finalize();
 
-    void write(const char* filename);
+    /**
+     * @brief Start the reductions of finalize() without waiting for them
+     *
+     * The rows are summed onto root along a binomial tree: at level \f$j\f$, each process with
+     * bit \f$j\f$ of its rank set sends its (partially summed) rows to the process \f$2^j\f$
+     * lower and is done. Root merges \f$\lceil \log_2 P \rceil\f$ messages, and the order of
+     * the sums depends only on the number of processes, so the result is deterministic.
+     *
+     * The row count may differ between processes, the largest is used.
+     *
+     * When distributed, the rows are instead split into a contiguous range for each process. The
+     * rows are exchanged with `MPI_Ialltoallv()`, each process sums the rows it owns, and write()
+     * writes each range collectively with MPI-IO. No process ever holds the whole matrix.
+     *
+     * @note Under MPI, startFinalize() must be called in the same order on every process, as the
+     * messages of each VolumeTrackingMatrix are matched by a tag from getReductionTag().
+     */
+    void startFinalize();
+
+    /**
+     * @brief Start the next level of the reductions started by startFinalize(), if the current
+     * level is complete
+     *
+     * Never blocks, so it is called until it returns true.
+     *
+     * @return true Once the reductions are complete, and write() can be called
+     */
+    bool continueFinalize();
+
+    /**
+     * @brief Whether the reductions have collectives left to start, including before
+     * startFinalize()
+     *
+     * Only when distributed, the rows are exchanged with collectives. Otherwise the tree only
+     * sends and receives messages, which are matched by tag.
+     *
+     * @see VolumeVector::hasCollectivesToStart()
+     */
+    bool hasCollectivesToStart() const;
+
+    /**
+     * @brief Write the volume tracking matrix file
+     *
+     * @param filename The file to write
+     * @param encoding The format of the file, ignored when distributed (which always writes
+     * MatrixEncoding::plain)
+     */
+    void write(const char* filename, const MatrixEncoding& encoding = MatrixEncoding::plain);
 
     void writeToLog(const char* filename, const double& t_num, const double& time);
 
+    /**
+     * @brief Get the rows of the matrix on this process in CSR format
+     *
+     * Unless distributed, the whole matrix is on root and the other processes have no rows. When
+     * distributed, each process has its range of rows.
+     *
+     * @note The reductions must be complete
+     *
+     * @param[out] firstRow The row of the matrix the first row is
+     * @param[out] rowIndex The row index, with the starting zero (one more than the number of rows)
+     * @param[out] columnIndex The column indices (NNZ values)
+     * @param[out] values The values (NNZ values)
+     */
+    void getRows(
+        int& firstRow, std::vector<Int_BinType>& rowIndex, std::vector<Int_BinType>& columnIndex,
+        std::vector<Fp_BinType>& values
+    ) const;
+
+    /**
+     * @brief Append the matrix to the \p container, as the snapshot \p t_num at \p time
+     *
+     * The snapshot has the same bytes as the file of write(), and the entry in the index
+     * replaces the record of writeToLog().
+     *
+     * @note Not supported when distributed
+     */
+    void writeToContainer(
+        ContainerWriter& container, const int& t_num, const double& time,
+        const MatrixEncoding& encoding = MatrixEncoding::plain
+    );
+
   private:
+    /** @brief Write the matrix to \p outputFile, in the format of the file */
+    void writeTo(BinaryWriter& outputFile, const MatrixEncoding& encoding);
+
 #ifdef ELA_USE_MPI
     const MPI_Comm comm;
     int rank;
+    int nProc;
+
+    const bool distributed;
+
+    // the communicator of writeDistributed()
+    const MPI_Comm writeComm;
+
+    // whether the row count is reduced by startFinalize(), false once set by setRowCount()
+    bool reduceRows;
+
+    /** @brief Move to the next level of the tree this process is part of, sending if its turn */
+    void nextLevel();
+
+    /** @brief continueFinalize() when distributed */
+    bool continueDistributed();
+
+    /** @brief write() when distributed */
+    void writeDistributed(const char* filename);
+
+    // when distributed, the stage of the exchange and the first row owned by this process
+    int stage;
+    int first;
+
+    // when distributed, the rows received, and the counts and offsets (in bytes) of the exchange
+    std::vector<svec::Element> recvBuff;
+    std::vector<int> sendCounts, sendDispls, recvCounts, recvDispls;
+
+    // the tag of the messages, the current level of the tree (as 2^level), and the send request
+    int tag;
+    int mask;
+    MPI_Request request;
+
+    // the compressed rows sent or received
+    std::vector<svec::Element> buff;
 #endif
-    const int rc;
-    svec::SVector* const row;
+    int rc;
+
+    // the rows, filled from the accumulated rows by startFinalize()
+    std::vector<svec::SVector> row;
+
+    // the rows summed by addCell()
+    std::vector<RowAccumulator> accumulated;
 };
 
 } // namespace output
@@ -1,23 +1,21 @@
 #include "vv.h"
+#include "binarywriter.h"
+#include "container.h"
+
+#include <algorithm>
+#include <cstddef>
 
 using namespace output;
 
 #ifdef ELA_USE_MPI
 VolumeVector::VolumeVector(const int& rowCount, MPI_Comm comm_in)
-    : comm(comm_in),
+    : comm(comm_in), nProc(0), stage(0), request(MPI_REQUEST_NULL),
 #else
 VolumeVector::VolumeVector(const int& rowCount)
     :
 #endif
-      rc(rowCount), v(new Fp_BinType[rc])
-{
-    // set all volumes to zero
-    std::fill(v, v + rowCount, 0);
-}
-
-VolumeVector::~VolumeVector()
+      rc(rowCount), v(rowCount, 0) // set all volumes to zero
 {
-    delete[] v;
 }
 
 void VolumeVector::addCell(const Int_BinType& label, const Fp_BinType& volume)
@@ -26,22 +24,224 @@ void VolumeVector::addCell(const Int_BinType& label, const Fp_BinType& volume)
     v[label - 1] += volume;
 }
 
+void VolumeVector::merge(const VolumeVector& part)
+{
+    if (part.v.size() > v.size()) {
+        v.resize(part.v.size(), 0);
+        rc = static_cast<Int_BinType>(v.size());
+    }
+
+    for (std::size_t i = 0; i < part.v.size(); ++i) {
+        v[i] += part.v[i];
+    }
+}
+
 void VolumeVector::finalize()
+{
+    startFinalize();
+    while (!continueFinalize()) {
+    }
+}
+
+void VolumeVector::startFinalize()
 {
 #ifdef ELA_USE_MPI
-    // figure out the rank
+    // figure out the rank and number of tasks
     MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nProc);
+
+    tag = getReductionTag();
+
+    // everyone needs the same number of rows, and to know if the volumes are sparse
+    sizes[0] = rc;
+    sizes[1] = static_cast<Int_BinType>(std::count_if(v.cbegin(), v.cend(), [](const auto& x) {
+        return x != 0;
+    }));
+    MPI_Iallreduce(MPI_IN_PLACE, sizes, 2, MPI_INT_BINTYPE, MPI_MAX, comm, &request);
+    stage = 1;
+#else
+    // do nothing
+#endif
+}
+
+bool VolumeVector::continueFinalize()
+{
+#ifdef ELA_USE_MPI
+    int done;
+
+    if (stage == 1) {
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        if (!done) return false;
+        rc = sizes[0];
+
+        if (2 * sizes[1] < rc) {
+            // only send the non-zero volumes
+            entries.clear();
+            for (Int_BinType i = 0; i < v.size(); ++i) {
+                if (v[i] != 0) entries.push_back(Entry{i + 1, v[i]});
+            }
+            std::vector<Fp_BinType>().swap(v);
 
-    // only boss needs the final list
-    if (rank == 0) {
-        MPI_Reduce(MPI_IN_PLACE, v, rc, MPI_FP_BINTYPE, MPI_SUM, 0, comm);
+            mask = 1;
+            stage = 3;
+            return nextLevel();
+        }
+
+        v.resize(rc, 0);
+
+        // only boss needs the final list
+        if (rank == 0) {
+            MPI_Ireduce(MPI_IN_PLACE, v.data(), rc, MPI_FP_BINTYPE, MPI_SUM, 0, comm, &request);
+        }
+        else {
+            MPI_Ireduce(v.data(), nullptr, rc, MPI_FP_BINTYPE, MPI_SUM, 0, comm, &request);
+        }
+        stage = 2;
+        return false;
     }
-    else {
-        MPI_Reduce(v, nullptr, rc, MPI_FP_BINTYPE, MPI_SUM, 0, comm);
+
+    if (stage == 2) {
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        return done;
+    }
+
+    if (stage == 3) {
+        if (mask >= nProc) return true;
+
+        if (rank & mask) {
+            // the parent has everything from this task once sent
+            MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+            if (!done) return false;
+            std::vector<Entry>().swap(entries);
+            mask = nProc;
+            return true;
+        }
+
+        // receive the volumes of the child
+        MPI_Message message;
+        MPI_Status status;
+        MPI_Improbe(rank + mask, tag, comm, &done, &message, &status);
+        if (!done) return false;
+
+        int len;
+        MPI_Get_count(&status, getEntryType(), &len);
+        recvEntries.resize(len);
+        MPI_Mrecv(recvEntries.data(), len, getEntryType(), &message, MPI_STATUS_IGNORE);
+
+        // merge the sorted lists, the child has higher ranks so add after to be deterministic
+        std::vector<Entry> merged;
+        merged.reserve(entries.size() + recvEntries.size());
+        auto a = entries.cbegin();
+        auto b = recvEntries.cbegin();
+        while (a != entries.cend() || b != recvEntries.cend()) {
+            if (b == recvEntries.cend() || (a != entries.cend() && a->l < b->l)) {
+                merged.push_back(*(a++));
+            }
+            else if (a == entries.cend() || b->l < a->l) {
+                merged.push_back(*(b++));
+            }
+            else {
+                merged.push_back(Entry{a->l, a->v + b->v});
+                ++a;
+                ++b;
+            }
+        }
+        entries.swap(merged);
+
+        mask <<= 1;
+        return nextLevel();
     }
+#endif
+
+    return true;
+}
+
+bool VolumeVector::hasCollectivesToStart() const
+{
+#ifdef ELA_USE_MPI
+    // the whole vector is reduced once the row count is known
+    return stage < 2;
 #else
-    // do nothing
+    return false;
+#endif
+}
+
+#ifdef ELA_USE_MPI
+// the MPI datatype of Entry, created on first use and freed by freeTypes()
+static MPI_Datatype entryType = MPI_DATATYPE_NULL;
+
+MPI_Datatype VolumeVector::getEntryType()
+{
+    if (entryType == MPI_DATATYPE_NULL) {
+        const int lengths[2] = {1, 1};
+        const MPI_Aint displacements[2] = {offsetof(Entry, l), offsetof(Entry, v)};
+        const MPI_Datatype types[2] = {MPI_INT_BINTYPE, MPI_FP_BINTYPE};
+
+        // the extent includes the padding, so arrays of Entry can be sent
+        MPI_Datatype type;
+        MPI_Type_create_struct(2, lengths, displacements, types, &type);
+        MPI_Type_create_resized(type, 0, sizeof(Entry), &entryType);
+        MPI_Type_free(&type);
+        MPI_Type_commit(&entryType);
+    }
+    return entryType;
+}
+
+void VolumeVector::freeTypes()
+{
+    if (entryType != MPI_DATATYPE_NULL) MPI_Type_free(&entryType);
+}
+
+bool VolumeVector::nextLevel()
+{
+    // skip levels with no partner
+    while (mask < nProc && !(rank & mask) && rank + mask >= nProc) {
+        mask <<= 1;
+    }
+
+    if (mask >= nProc) {
+        // root has all the volumes
+        v.assign(rc, 0);
+        for (const auto& e : entries) {
+            v[e.l - 1] = e.v;
+        }
+        std::vector<Entry>().swap(entries);
+        std::vector<Entry>().swap(recvEntries);
+        return true;
+    }
+
+    // send to parent
+    if (rank & mask) {
+        MPI_Isend(
+            entries.data(), entries.size(), getEntryType(), rank - mask, tag, comm, &request
+        );
+    }
+
+    return false;
+}
+#endif
+
+void VolumeVector::writeTo(BinaryWriter& outputFile)
+{
+    // Write ROW_COUNT
+    Int_BinType ROW_COUNT = static_cast<Int_BinType>(rc);
+    outputFile.write(ROW_COUNT);
+
+    // Write VALUE
+    outputFile.write(v.data(), rc);
+}
+
+void VolumeVector::getValues(std::vector<Fp_BinType>& values) const
+{
+#ifdef ELA_USE_MPI
+    // the volume vector is on root
+    if (rank != 0) {
+        values.clear();
+        return;
+    }
 #endif
+
+    values.assign(v.begin(), v.begin() + rc);
 }
 
 void VolumeVector::write(const char* filename)
@@ -52,15 +252,27 @@ void VolumeVector::write(const char* filename)
 #endif
 
     // Open file
-    std::ofstream outputFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
-
-    // Write ROW_COUNT
-    Int_BinType ROW_COUNT = static_cast<Int_BinType>(rc);
-    outputFile.write(reinterpret_cast<const char*>(&(ROW_COUNT)), sizeof(Int_BinType));
+    BinaryWriter outputFile(filename, false, directIO);
 
-    // Write VALUE
-    outputFile.write(reinterpret_cast<const char*>(v), sizeof(Fp_BinType) * rc);
+    writeTo(outputFile);
 
     // Close file
     outputFile.close();
 }
+
+void VolumeVector::writeToContainer(
+    ContainerWriter& container, const int& t_num, const double& time
+)
+{
+#ifdef ELA_USE_MPI
+    // Only rank==0 does anything
+    if (rank != 0) return;
+#endif
+
+    container.append(
+        ContainerEntry{
+            static_cast<Int_BinType>(SnapshotKind::volumeVector), static_cast<Int_BinType>(t_num),
+            static_cast<Fp_BinType>(time), rc, rc, 0, 0},
+        [this](BinaryWriter& outputFile) { writeTo(outputFile); }
+    );
+}
@@ -3,8 +3,13 @@
 
 #include "output.h"
 
+#include <vector>
+
 namespace output {
 
+class BinaryWriter;
+class ContainerWriter;
+
 class VolumeVector {
   public:
 #ifdef ELA_USE_MPI
@@ -13,21 +18,128 @@ class VolumeVector {
     VolumeVector(const int& rowCount);
 #endif
 
-    ~VolumeVector();
-
     void addCell(const Int_BinType& label, const Fp_BinType& volume);
 
+    /**
+     * @brief Add the cells added to \p part
+     *
+     * @see VolumeTrackingMatrix::merge()
+     * @note Must be called before startFinalize()
+     */
+    void merge(const VolumeVector& part);
+
     void finalize();
 
+    /**
+     * @brief Start the reductions of finalize() without waiting for them
+     *
+     * The row count may differ between processes, the largest is used.
+     *
+     * When every process has non-zero volumes for fewer than half of the rows, only the non-zero
+     * (label, volume) pairs are summed. They are merged onto root along a binomial tree, as in
+     * VolumeTrackingMatrix::startFinalize(). Otherwise the whole vector is reduced.
+     *
+     * @note Under MPI this starts non-blocking collectives, so it and continueFinalize() must be
+     * called in the same order on every process, relative to other collectives on the
+     * communicator.
+     */
+    void startFinalize();
+
+    /**
+     * @brief Start the next stage of the reductions started by startFinalize(), if the current
+     * stage is complete
+     *
+     * Never blocks, so it is called until it returns true.
+     *
+     * @return true Once the reductions are complete, and write() can be called
+     */
+    bool continueFinalize();
+
+    /**
+     * @brief Whether the reductions have collectives left to start, including before
+     * startFinalize()
+     *
+     * While true, continueFinalize() may start a collective, so must be called in the same order
+     * relative to other collectives on every process. Once false, it only tests and sends.
+     */
+    bool hasCollectivesToStart() const;
+
     void write(const char* filename);
 
+    /** @brief Get the row count, the largest of any process once the reductions are complete */
+    Int_BinType getRowCount() const
+    {
+        return rc;
+    }
+
+    /**
+     * @brief Get the volume vector, which is only on root (other processes get no values)
+     *
+     * @note The reductions must be complete
+     *
+     * @param[out] values The volume of each label (RC values)
+     */
+    void getValues(std::vector<Fp_BinType>& values) const;
+
+    /**
+     * @brief Append the volume vector to the \p container, as the snapshot \p t_num at \p time
+     *
+     * The snapshot has the same bytes as the file of write().
+     */
+    void writeToContainer(ContainerWriter& container, const int& t_num, const double& time);
+
+#ifdef ELA_USE_MPI
+    /**
+     * @brief Free the MPI datatype of the (label, volume) pairs, which is created by the first
+     * sparse reduction and kept for the later ones
+     *
+     * @note No reductions may be in progress
+     */
+    static void freeTypes();
+#endif
+
   private:
+    /** @brief Write the volume vector to \p outputFile, in the format of the file */
+    void writeTo(BinaryWriter& outputFile);
+
 #ifdef ELA_USE_MPI
     const MPI_Comm comm;
     int rank;
+
+    int nProc;
+
+    // the stage of the reductions, and its request
+    int stage;
+    MPI_Request request;
+
+    // the row count and largest number of non-zero volumes on any process
+    Int_BinType sizes[2];
+
+    /** @brief A non-zero volume */
+    struct Entry {
+        Int_BinType l;
+        Fp_BinType v;
+    };
+
+    /** @brief The MPI datatype of Entry, which only has its members (not the padding) */
+    static MPI_Datatype getEntryType();
+
+    /**
+     * @brief Move to the next level of the tree this process is part of, sending if its turn
+     *
+     * @return true Once the sparse reduction is complete
+     */
+    bool nextLevel();
+
+    // for the sparse reduction, the tag of the messages, the current level of the tree (as
+    // 2^level), and the non-zero volumes sent or received
+    int tag;
+    int mask;
+    std::vector<Entry> entries;
+    std::vector<Entry> recvEntries;
 #endif
-    const Int_BinType rc;
-    Fp_BinType* const v;
+    Int_BinType rc;
+    std::vector<Fp_BinType> v;
 };
 
 } // namespace output
@@ -0,0 +1,40 @@
+#include "mappedfile.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace reader;
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Unable to open " + filename);
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Unable to read " + filename);
+    }
+    length = static_cast<std::size_t>(status.st_size);
+
+    // an empty file can not be mapped
+    if (length != 0) {
+        void* const mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Unable to map " + filename);
+        }
+        ptr = static_cast<const char*>(mapped);
+    }
+
+    // the mapping does not need the file to stay open
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (ptr) ::munmap(const_cast<char*>(ptr), length);
+}
@@ -0,0 +1,48 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace reader {
+
+/**
+ * @brief A file mapped read-only into memory with `mmap()`
+ *
+ * Pages are only read from disk when first accessed, so mapping a large file is cheap. The
+ * mapping is removed when destroyed.
+ */
+class MappedFile {
+  public:
+    /**
+     * @brief Map all of \p filename
+     *
+     * @throws std::runtime_error If the file can not be opened or mapped
+     */
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    /** @brief The first byte of the file, `nullptr` if the file is empty */
+    const char* data() const noexcept
+    {
+        return ptr;
+    }
+
+    /** @brief The size of the file (in bytes), when it was mapped */
+    std::size_t size() const noexcept
+    {
+        return length;
+    }
+
+  private:
+    const char* ptr = nullptr;
+    std::size_t length = 0;
+};
+
+} // namespace reader
+
+#endif
@@ -0,0 +1,206 @@
+#include "matrix.h"
+#include "../output/matrixencoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace reader;
+
+// point to count values of T at ptr if aligned, else copy them to owned
+template <class T>
+static const T* mapOrCopy(const char* ptr, const std::size_t& count, std::vector<T>& owned)
+{
+    if (reinterpret_cast<std::uintptr_t>(ptr) % alignof(T) == 0) {
+        return reinterpret_cast<const T*>(ptr);
+    }
+
+    owned.resize(count);
+    if (count != 0) std::memcpy(owned.data(), ptr, count * sizeof(T));
+    return owned.data();
+}
+
+Matrix::Matrix(
+    std::vector<Int_BinType> rowIndex_in, std::vector<Int_BinType> columnIndex_in,
+    std::vector<Fp_BinType> values_in
+)
+    : rowIndex(std::move(rowIndex_in)),
+      columnIndex(std::move(columnIndex_in)),
+      values(std::move(values_in))
+{
+    assert(!rowIndex.empty() && rowIndex.back() == columnIndex.size());
+    assert(columnIndex.size() == values.size());
+
+    v.rc = static_cast<Int_BinType>(rowIndex.size() - 1);
+    v.nnz = static_cast<Int_BinType>(values.size());
+    v.rowEnd = rowIndex.data() + 1;
+    v.columnIndex = columnIndex.data();
+    v.values = values.data();
+}
+
+Matrix Matrix::map(
+    std::shared_ptr<const MappedFile> file, const char* data, const std::size_t& size
+)
+{
+    // version 2 files can only be decoded
+    if (size >= sizeof(output::matrixMagic) &&
+        std::memcmp(data, output::matrixMagic, sizeof(output::matrixMagic)) == 0) {
+        std::vector<Int_BinType> rowIndex, columnIndex;
+        std::vector<Fp_BinType> values;
+        output::decodeMatrix(data, size, rowIndex, columnIndex, values);
+        return Matrix(std::move(rowIndex), std::move(columnIndex), std::move(values));
+    }
+
+    if (size < 2 * sizeof(Int_BinType)) {
+        throw std::runtime_error("Truncated volume tracking matrix");
+    }
+
+    Matrix m;
+    std::memcpy(&m.v.rc, data, sizeof(Int_BinType));
+    std::memcpy(&m.v.nnz, data + sizeof(Int_BinType), sizeof(Int_BinType));
+
+    const std::size_t rc = m.v.rc, nnz = m.v.nnz;
+    if (size != (2 + rc + nnz) * sizeof(Int_BinType) + nnz * sizeof(Fp_BinType)) {
+        throw std::runtime_error("Volume tracking matrix has the wrong size");
+    }
+
+    const char* ptr = data + 2 * sizeof(Int_BinType);
+    m.v.rowEnd = mapOrCopy(ptr, rc, m.rowIndex);
+    ptr += rc * sizeof(Int_BinType);
+    m.v.columnIndex = mapOrCopy(ptr, nnz, m.columnIndex);
+    ptr += nnz * sizeof(Int_BinType);
+    m.v.values = mapOrCopy(ptr, nnz, m.values);
+
+    if (rc != 0 && m.v.rowEnd[rc - 1] != nnz) {
+        throw std::runtime_error("Volume tracking matrix has an invalid row index");
+    }
+
+    m.file = std::move(file);
+    return m;
+}
+
+Vector::Vector(std::vector<Fp_BinType> values_in) : values(std::move(values_in))
+{
+    rc = static_cast<Int_BinType>(values.size());
+    ptr = values.data();
+}
+
+Vector Vector::map(
+    std::shared_ptr<const MappedFile> file, const char* data, const std::size_t& size
+)
+{
+    Vector vec;
+    if (size < sizeof(Int_BinType)) throw std::runtime_error("Truncated volume vector");
+    std::memcpy(&vec.rc, data, sizeof(Int_BinType));
+
+    if (size != sizeof(Int_BinType) + std::size_t(vec.rc) * sizeof(Fp_BinType)) {
+        throw std::runtime_error("Volume vector has the wrong size");
+    }
+
+    vec.ptr = mapOrCopy(data + sizeof(Int_BinType), vec.rc, vec.values);
+    vec.file = std::move(file);
+    return vec;
+}
+
+// the sum of row i of a
+static inline Fp_BinType getRowSum(const MatrixView& a, const Int_BinType& i)
+{
+    Fp_BinType sum = 0.0;
+    for (auto k = a.rowBegin(i); k < a.rowEnd[i]; ++k) {
+        sum += a.values[k];
+    }
+    return sum;
+}
+
+// what to multiply row i of a by
+static inline Fp_BinType getRowScale(
+    const MatrixView& a, const Int_BinType& i, const bool& normalize
+)
+{
+    if (!normalize) return 1.0;
+
+    const Fp_BinType sum = getRowSum(a, i);
+    return (sum == 0.0 ? 1.0 : 1.0 / sum);
+}
+
+Matrix reader::normalizeRows(const MatrixView& a)
+{
+    std::vector<Int_BinType> rowIndex(std::size_t(a.rc) + 1, 0);
+    std::vector<Fp_BinType> values(a.nnz);
+    for (Int_BinType i = 0; i < a.rc; ++i) {
+        const Fp_BinType scale = getRowScale(a, i, true);
+        for (auto k = a.rowBegin(i); k < a.rowEnd[i]; ++k) {
+            values[k] = a.values[k] * scale;
+        }
+        rowIndex[i + 1] = a.rowEnd[i];
+    }
+
+    return Matrix(
+        std::move(rowIndex), std::vector<Int_BinType>(a.columnIndex, a.columnIndex + a.nnz),
+        std::move(values)
+    );
+}
+
+Matrix reader::multiply(
+    const MatrixView& a, const MatrixView& b, const bool& normalize, const double& dropTolerance
+)
+{
+    // the column count of b
+    Int_BinType cc = 0;
+    for (Int_BinType k = 0; k < b.nnz; ++k) {
+        cc = std::max(cc, b.columnIndex[k] + 1);
+    }
+
+    // a dense row of the product, and the columns in use
+    std::vector<Fp_BinType> row(cc, 0.0);
+    std::vector<bool> used(cc, false);
+    std::vector<Int_BinType> columns;
+
+    std::vector<Int_BinType> rowIndex(1, 0);
+    std::vector<Int_BinType> columnIndex;
+    std::vector<Fp_BinType> values;
+    rowIndex.reserve(std::size_t(a.rc) + 1);
+
+    for (Int_BinType i = 0; i < a.rc; ++i) {
+        const Fp_BinType scale = getRowScale(a, i, normalize);
+
+        // add the row of b of each label in row i of a
+        for (auto k = a.rowBegin(i); k < a.rowEnd[i]; ++k) {
+            const Int_BinType j = a.columnIndex[k];
+            if (j == 0 || j > b.rc) {
+                throw std::runtime_error(
+                    "Label " + std::to_string(j) + " is not a row of the right matrix"
+                );
+            }
+
+            const Fp_BinType C = a.values[k] * scale;
+            for (auto m = b.rowBegin(j - 1); m < b.rowEnd[j - 1]; ++m) {
+                const Int_BinType col = b.columnIndex[m];
+                if (!used[col]) {
+                    used[col] = true;
+                    columns.push_back(col);
+                }
+                row[col] += C * b.values[m];
+            }
+        }
+
+        // store in order, resetting the dense row
+        std::sort(columns.begin(), columns.end());
+        for (const auto& col : columns) {
+            if (std::abs(row[col]) > dropTolerance) {
+                columnIndex.push_back(col);
+                values.push_back(row[col]);
+            }
+            row[col] = 0.0;
+            used[col] = false;
+        }
+        columns.clear();
+
+        rowIndex.push_back(static_cast<Int_BinType>(values.size()));
+    }
+
+    return Matrix(std::move(rowIndex), std::move(columnIndex), std::move(values));
+}
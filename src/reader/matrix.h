@@ -0,0 +1,187 @@
+#ifndef READER_MATRIX_H
+#define READER_MATRIX_H
+
+#include "../output/output.h"
+#include "mappedfile.h"
+
+#include <memory>
+#include <vector>
+
+//! For reading the output files, without copying them into memory where possible
+namespace reader {
+
+using output::Fp_BinType;
+using output::Int_BinType;
+
+/**
+ * @brief A matrix in CSR format, as stored in a volume tracking matrix file
+ *
+ * As in the file, the zero that formally starts the row index is omitted, so row `i` is the
+ * entries `rowBegin(i)` to `rowEnd[i]`. Row `i` is label `i+1`, while the column indices are the
+ * labels themselves.
+ */
+struct MatrixView {
+    /** @brief The row count */
+    Int_BinType rc = 0;
+
+    /** @brief The number of non-zeros */
+    Int_BinType nnz = 0;
+
+    /** @brief The end of each row (RC values) */
+    const Int_BinType* rowEnd = nullptr;
+
+    /** @brief The column indices (NNZ values) */
+    const Int_BinType* columnIndex = nullptr;
+
+    /** @brief The values (NNZ values) */
+    const Fp_BinType* values = nullptr;
+
+    /** @brief The start of row \p i */
+    Int_BinType rowBegin(const Int_BinType& i) const
+    {
+        return (i == 0 ? 0 : rowEnd[i - 1]);
+    }
+};
+
+/**
+ * @brief A volume tracking matrix, either in a mapped file or in memory
+ *
+ * When read from a version 1 file (see [Output Files](OutputFiles.html)), the arrays of the
+ * view() point into the mapped file, unless they are not aligned for their type, in which case
+ * only that array is copied. A version 2 file is decoded into memory.
+ *
+ * The matrix keeps the file mapped, so may outlive whatever read it.
+ */
+class Matrix {
+  public:
+    /** @brief An empty matrix, with no rows */
+    Matrix() = default;
+
+    /**
+     * @brief A matrix in memory
+     *
+     * @param rowIndex The row index, with the starting zero (RC+1 values)
+     * @param columnIndex The column indices (NNZ values)
+     * @param values The values (NNZ values)
+     */
+    Matrix(
+        std::vector<Int_BinType> rowIndex, std::vector<Int_BinType> columnIndex,
+        std::vector<Fp_BinType> values
+    );
+
+    /**
+     * @brief The matrix stored in \p size bytes at \p data, within \p file
+     *
+     * @throws std::runtime_error If the bytes are not a volume tracking matrix
+     */
+    static Matrix map(
+        std::shared_ptr<const MappedFile> file, const char* data, const std::size_t& size
+    );
+
+    Matrix(Matrix&&) = default;
+    Matrix& operator=(Matrix&&) = default;
+    Matrix(const Matrix&) = delete;
+    Matrix& operator=(const Matrix&) = delete;
+
+    /** @brief The arrays of the matrix */
+    const MatrixView& view() const noexcept
+    {
+        return v;
+    }
+
+    /** @brief Whether none of the arrays were copied from the file */
+    bool isZeroCopy() const noexcept
+    {
+        return file && rowIndex.empty() && columnIndex.empty() && values.empty();
+    }
+
+  private:
+    std::shared_ptr<const MappedFile> file;
+
+    // arrays that are not in the file
+    std::vector<Int_BinType> rowIndex;
+    std::vector<Int_BinType> columnIndex;
+    std::vector<Fp_BinType> values;
+
+    MatrixView v;
+};
+
+/**
+ * @brief A volume vector, either in a mapped file or in memory
+ *
+ * In a file the values follow the 4 byte RC, so are only used in place when that is aligned
+ * (e.g., in a container). Otherwise, they are copied.
+ */
+class Vector {
+  public:
+    /** @brief An empty vector */
+    Vector() = default;
+
+    /** @brief A vector in memory */
+    explicit Vector(std::vector<Fp_BinType> values);
+
+    /**
+     * @brief The vector stored in \p size bytes at \p data, within \p file
+     *
+     * @throws std::runtime_error If the bytes are not a volume vector
+     */
+    static Vector map(
+        std::shared_ptr<const MappedFile> file, const char* data, const std::size_t& size
+    );
+
+    Vector(Vector&&) = default;
+    Vector& operator=(Vector&&) = default;
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
+    /** @brief The row count */
+    Int_BinType size() const noexcept
+    {
+        return rc;
+    }
+
+    /** @brief The volume of each label (RC values, label `l` at `l-1`) */
+    const Fp_BinType* data() const noexcept
+    {
+        return ptr;
+    }
+
+  private:
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Fp_BinType> values;
+
+    Int_BinType rc = 0;
+    const Fp_BinType* ptr = nullptr;
+};
+
+/**
+ * @brief Each row of \p a divided by its sum (rows that sum to zero are unchanged)
+ *
+ * For a volume tracking matrix \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$, entry \f$(i,j)\f$ of the
+ * result is the fraction of the volume of blob \f$i\f$ at \f$n\f$ that came from blob \f$j\f$ at
+ * \f$n-1\f$ (in the row of label \f$i\f$ and column \f$j\f$, see MatrixView).
+ */
+Matrix normalizeRows(const MatrixView& a);
+
+/**
+ * @brief The sparse product \f$\mathbf{A}\mathbf{B}\f$ of volume tracking matrices
+ *
+ * As for the matrices, the product's rows are labels from 1 and its columns are labels (see
+ * MatrixView), so column `j` of \p a is multiplied with row `j-1` of \p b.
+ *
+ * @throws std::runtime_error If a column of \p a is not a label with a row in \p b
+ *
+ * @param a The left matrix
+ * @param b The right matrix, which must have a row for each label in the columns of \p a
+ * @param normalize Whether to use \p a with each row divided by its sum, see normalizeRows()
+ * @param dropTolerance Entries of the product with magnitude at most this are not stored (exact
+ * zeros are never stored)
+ */
+Matrix multiply(
+    const MatrixView& a, const MatrixView& b, const bool& normalize = false,
+    const double& dropTolerance = 0.0
+);
+
+} // namespace reader
+
+#endif
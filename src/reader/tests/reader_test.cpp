@@ -0,0 +1,318 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "../../ELA_Reader.h"
+#include "../../output/binarywriter.h"
+#include "../../output/container.h"
+#include "../../output/matrixencoding.h"
+#include "../mappedfile.h"
+#include "../matrix.h"
+#include "../trackingdata.h"
+
+using output::Fp_BinType;
+using output::Int_BinType;
+
+// a matrix in CSR format, with the starting zero of the row index
+struct CSR {
+    std::vector<Int_BinType> rowIndex;
+    std::vector<Int_BinType> columnIndex;
+    std::vector<Fp_BinType> values;
+};
+
+// row i is label i+1, and the columns are labels
+
+// Q^(0->1): blob 2 splits into blobs 2 and 3
+// RC+NNZ is even, so the values are aligned in the file
+const CSR Q1 = {{0, 1, 2, 3}, {1, 2, 2}, {4.0, 2.0, 1.0}};
+
+// Q^(1->2): blobs 2 and 3 merge into blob 2
+const CSR Q2 = {{0, 1, 3}, {1, 2, 3}, {4.0, 2.0, 3.0}};
+
+// write a version 1 volume tracking matrix
+void writeMatrix(output::BinaryWriter& file, const CSR& m)
+{
+    const Int_BinType RC = static_cast<Int_BinType>(m.rowIndex.size() - 1);
+    const Int_BinType NNZ = static_cast<Int_BinType>(m.values.size());
+    file.write(RC);
+    file.write(NNZ);
+    file.write(m.rowIndex.data() + 1, RC);
+    file.write(m.columnIndex.data(), NNZ);
+    file.write(m.values.data(), NNZ);
+}
+
+// write a version 2 volume tracking matrix
+void writeCompactMatrix(output::BinaryWriter& file, const CSR& m)
+{
+    std::vector<svec::SVector> rows(m.rowIndex.size() - 1);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        for (auto k = m.rowIndex[i]; k < m.rowIndex[i + 1]; ++k) {
+            rows[i].add(svec::SVector(svec::Element{m.columnIndex[k], m.values[k]}));
+        }
+    }
+    output::writeCompactMatrix(
+        file, rows, static_cast<int>(rows.size()), output::MatrixEncoding::compactShuffled
+    );
+}
+
+void writeVector(output::BinaryWriter& file, const std::vector<Fp_BinType>& v)
+{
+    file.write(static_cast<Int_BinType>(v.size()));
+    file.write(v.data(), v.size());
+}
+
+void expectMatrix(const reader::MatrixView& view, const CSR& m)
+{
+    ASSERT_EQ(view.rc, m.rowIndex.size() - 1);
+    ASSERT_EQ(view.nnz, m.values.size());
+    for (Int_BinType i = 0; i < view.rc; ++i) {
+        EXPECT_EQ(view.rowBegin(i), m.rowIndex[i]);
+        EXPECT_EQ(view.rowEnd[i], m.rowIndex[i + 1]);
+    }
+    for (Int_BinType k = 0; k < view.nnz; ++k) {
+        EXPECT_EQ(view.columnIndex[k], m.columnIndex[k]);
+        EXPECT_DOUBLE_EQ(view.values[k], m.values[k]);
+    }
+}
+
+// write the separate files of the snapshots to folder, the second matrix in version 2
+void writeFolder(const std::string& folder)
+{
+    mkdir(folder.c_str(), 0755);
+    {
+        output::BinaryWriter file((folder + "/afwd_000001.bin").c_str());
+        writeMatrix(file, Q1);
+        file.close();
+    }
+    {
+        output::BinaryWriter file((folder + "/afwd_000002.bin").c_str());
+        writeCompactMatrix(file, Q2);
+        file.close();
+    }
+    {
+        output::BinaryWriter file((folder + "/v_000002.bin").c_str());
+        writeVector(file, {0.0, 5.0});
+        file.close();
+    }
+    {
+        output::BinaryWriter file((folder + "/timelog.bin").c_str());
+        file.write(Int_BinType(1));
+        file.write(Int_BinType(3));
+        file.write(Fp_BinType(0.5));
+        file.write(Int_BinType(2));
+        file.write(Int_BinType(2));
+        file.write(Fp_BinType(1.0));
+        file.close();
+    }
+}
+
+TEST(Reader, Matrix)
+{
+    {
+        output::BinaryWriter file("temp_q1.bin");
+        writeMatrix(file, Q1);
+        file.close();
+    }
+    {
+        output::BinaryWriter file("temp_q2.bin");
+        writeMatrix(file, Q2);
+        file.close();
+    }
+    {
+        output::BinaryWriter file("temp_q2_v2.bin");
+        writeCompactMatrix(file, Q2);
+        file.close();
+    }
+
+    auto read = [](const char* filename) {
+        auto file = std::make_shared<const reader::MappedFile>(filename);
+        const char* data = file->data();
+        const std::size_t size = file->size();
+        return reader::Matrix::map(std::move(file), data, size);
+    };
+
+    // used in place
+    const auto q1 = read("temp_q1.bin");
+    EXPECT_TRUE(q1.isZeroCopy());
+    expectMatrix(q1.view(), Q1);
+
+    // the values are not aligned, so are copied
+    const auto q2 = read("temp_q2.bin");
+    EXPECT_FALSE(q2.isZeroCopy());
+    expectMatrix(q2.view(), Q2);
+
+    // decoded
+    const auto q2Compact = read("temp_q2_v2.bin");
+    EXPECT_FALSE(q2Compact.isZeroCopy());
+    expectMatrix(q2Compact.view(), Q2);
+
+    remove("temp_q1.bin");
+    remove("temp_q2.bin");
+    remove("temp_q2_v2.bin");
+}
+
+TEST(Reader, Multiply)
+{
+    const reader::Matrix q1(Q1.rowIndex, Q1.columnIndex, Q1.values);
+    const reader::Matrix q2(Q2.rowIndex, Q2.columnIndex, Q2.values);
+
+    // the volumes
+    expectMatrix(reader::multiply(q2.view(), q1.view()).view(), {{0, 1, 2}, {1, 2}, {16.0, 7.0}});
+
+    // the fractions
+    const auto n1 = reader::normalizeRows(q1.view());
+    expectMatrix(n1.view(), {{0, 1, 2, 3}, {1, 2, 2}, {1.0, 1.0, 1.0}});
+    expectMatrix(
+        reader::multiply(q2.view(), n1.view(), true).view(), {{0, 1, 2}, {1, 2}, {1.0, 1.0}}
+    );
+
+    // small entries are dropped
+    expectMatrix(
+        reader::multiply(q2.view(), q1.view(), false, 10.0).view(), {{0, 1, 1}, {1}, {16.0}}
+    );
+
+    // q2 has no row for label 3
+    EXPECT_THROW(reader::multiply(q2.view(), q2.view()), std::runtime_error);
+}
+
+TEST(Reader, TrackingData)
+{
+    writeFolder("temp_reader");
+
+    const reader::TrackingData data("temp_reader");
+    EXPECT_FALSE(data.isContainer());
+
+    const auto& snapshots = data.getSnapshots();
+    ASSERT_EQ(snapshots.size(), 2);
+    EXPECT_EQ(snapshots[0].t_num, 1);
+    EXPECT_EQ(snapshots[0].rc, 3);
+    EXPECT_EQ(snapshots[1].time, 1.0);
+
+    expectMatrix(data.getTrackingMatrix(1).view(), Q1);
+    expectMatrix(data.getTrackingMatrix(2).view(), Q2);
+
+    const auto v = data.getVolumeVector(2);
+    ASSERT_EQ(v.size(), 2);
+    EXPECT_EQ(v.data()[1], 5.0);
+
+    expectMatrix(data.compose(0, 2).view(), {{0, 1, 2}, {1, 2}, {1.0, 1.0}});
+    expectMatrix(data.compose(0, 2, false).view(), {{0, 1, 2}, {1, 2}, {16.0, 7.0}});
+    expectMatrix(data.compose(1, 2, false).view(), Q2);
+
+    EXPECT_THROW(data.getTrackingMatrix(3), std::runtime_error);
+    EXPECT_THROW(data.compose(2, 2), std::invalid_argument);
+}
+
+TEST(Reader, Container)
+{
+    // the container is appended to
+    mkdir("temp_reader_container", 0755);
+    remove("temp_reader_container/tracking.dat");
+    remove("temp_reader_container/tracking.idx");
+    {
+        output::ContainerWriter container(
+            "temp_reader_container/tracking.dat", "temp_reader_container/tracking.idx"
+        );
+
+        auto entry = [](const output::SnapshotKind& kind, const int& t_num, const CSR& m) {
+            return output::ContainerEntry{
+                static_cast<Int_BinType>(kind),
+                static_cast<Int_BinType>(t_num),
+                0.5 * t_num,
+                static_cast<Int_BinType>(m.rowIndex.size() - 1),
+                static_cast<Int_BinType>(m.values.size()),
+                0,
+                0};
+        };
+        container.append(entry(output::SnapshotKind::trackingMatrix, 1, Q1), [](auto& file) {
+            writeMatrix(file, Q1);
+        });
+        container.append(
+            entry(output::SnapshotKind::volumeVector, 2, {{0, 0, 0}, {}, {}}),
+            [](auto& file) { writeVector(file, {0.0, 5.0}); }
+        );
+        container.append(entry(output::SnapshotKind::trackingMatrix, 2, Q2), [](auto& file) {
+            writeCompactMatrix(file, Q2);
+        });
+        container.close();
+    }
+
+    const reader::TrackingData data("temp_reader_container");
+    EXPECT_TRUE(data.isContainer());
+
+    const auto& snapshots = data.getSnapshots();
+    ASSERT_EQ(snapshots.size(), 2);
+    EXPECT_EQ(snapshots[1].t_num, 2);
+    EXPECT_EQ(snapshots[1].rc, 2);
+    EXPECT_EQ(snapshots[1].time, 1.0);
+
+    // the values of the first snapshot are aligned in the data file
+    const auto q1 = data.getTrackingMatrix(1);
+    EXPECT_TRUE(q1.isZeroCopy());
+    expectMatrix(q1.view(), Q1);
+    expectMatrix(data.getTrackingMatrix(2).view(), Q2);
+    EXPECT_EQ(data.getVolumeVector(2).data()[1], 5.0);
+
+    expectMatrix(data.compose(0, 2).view(), {{0, 1, 2}, {1, 2}, {1.0, 1.0}});
+
+    EXPECT_THROW(data.getVolumeVector(1), std::runtime_error);
+}
+
+TEST(Reader, CInterface)
+{
+    writeFolder("temp_reader_c");
+
+    ELA_Reader* reader;
+    ASSERT_EQ(ELA_ReaderOpen("temp_reader_c", &reader), 0);
+    ASSERT_EQ(ELA_ReaderGetSnapshotCount(reader), 2);
+
+    ELA_SnapshotInfo info;
+    ASSERT_EQ(ELA_ReaderGetSnapshot(reader, 1, &info), 0);
+    EXPECT_EQ(info.t_num, 2);
+    EXPECT_EQ(info.rc, 2);
+    EXPECT_EQ(info.time, 1.0);
+    EXPECT_NE(ELA_ReaderGetSnapshot(reader, 2, &info), 0);
+
+    ELA_Matrix* matrix;
+    ASSERT_EQ(ELA_ReaderGetVTM(reader, 1, &matrix), 0);
+
+    ELA_Matrix* product;
+    ASSERT_EQ(ELA_ReaderCompose(reader, 0, 2, 0, 0.0, &product), 0);
+
+    ELA_Vector* vector;
+    ASSERT_EQ(ELA_ReaderGetV(reader, 2, &vector), 0);
+
+    // all stay valid once closed
+    ELA_ReaderClose(reader);
+
+    ELA_MatrixView view;
+    ELA_MatrixGetView(matrix, &view);
+    ASSERT_EQ(view.rc, 3);
+    ASSERT_EQ(view.nnz, 3);
+    EXPECT_EQ(view.row_index[2], 3);
+    EXPECT_EQ(view.column_index[1], 2);
+    EXPECT_EQ(view.values[0], 4.0);
+    ELA_MatrixFree(matrix);
+
+    ELA_MatrixGetView(product, &view);
+    ASSERT_EQ(view.nnz, 2);
+    EXPECT_EQ(view.values[1], 7.0);
+    ELA_MatrixFree(product);
+
+    uint32_t rc;
+    const double* values;
+    ELA_VectorGetValues(vector, &rc, &values);
+    ASSERT_EQ(rc, 2);
+    EXPECT_EQ(values[1], 5.0);
+    ELA_VectorFree(vector);
+
+    // errors
+    ASSERT_EQ(ELA_ReaderOpen("temp_reader_c", &reader), 0);
+    EXPECT_NE(ELA_ReaderGetVTM(reader, 3, &matrix), 0);
+    EXPECT_NE(std::string(ELA_ReaderGetError()), "");
+    ELA_ReaderClose(reader);
+}
@@ -0,0 +1,163 @@
+#include "trackingdata.h"
+#include "../naming.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace reader;
+
+// the name of the file of snapshot t_num, as written by ELA_Output()
+static std::string getSnapshotFileName(
+    const std::string& folder, const char* name, const int& t_num, const char* ext
+)
+{
+    std::string t_numString = std::to_string(t_num);
+
+    return folder + "/" + name +
+           std::string(T_NUM_DIGITS - t_numString.length(), '0') + t_numString + "." + ext;
+}
+
+static bool exists(const std::string& filename)
+{
+    return std::ifstream(filename).good();
+}
+
+// check the header of a file of a container
+static void checkHeader(const MappedFile& file, const char (&magic)[4], const std::string& filename)
+{
+    output::Int_BinType version = 0;
+    if (file.size() < output::containerHeaderSize ||
+        std::memcmp(file.data(), magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(filename + " is not a container file");
+    }
+
+    std::memcpy(&version, file.data() + sizeof(magic), sizeof(version));
+    if (version != output::containerVersion) {
+        throw std::runtime_error(
+            filename + " has unsupported container version " + std::to_string(version)
+        );
+    }
+}
+
+TrackingData::TrackingData(std::string folder_in) : folder(std::move(folder_in))
+{
+    const std::string indexFilename =
+        folder + "/" + CONTAINER_FILENAME + "." + CONTAINER_INDEX_EXT;
+
+    if (exists(indexFilename)) {
+        const std::string dataFilename =
+            folder + "/" + CONTAINER_FILENAME + "." + CONTAINER_DATA_EXT;
+
+        data = std::make_shared<const MappedFile>(dataFilename);
+        index = std::make_shared<const MappedFile>(indexFilename);
+        checkHeader(*data, output::containerDataMagic, dataFilename);
+        checkHeader(*index, output::containerIndexMagic, indexFilename);
+
+        // only complete entries, which are aligned as the header is 8 bytes
+        entries = reinterpret_cast<const output::ContainerEntry*>(
+            index->data() + output::containerHeaderSize
+        );
+        entryCount = (index->size() - output::containerHeaderSize) / sizeof(output::ContainerEntry);
+
+        for (std::size_t i = 0; i < entryCount; ++i) {
+            const auto& entry = entries[i];
+            if (entry.kind != static_cast<Int_BinType>(output::SnapshotKind::trackingMatrix)) {
+                continue;
+            }
+            snapshots.push_back({static_cast<int>(entry.t_num), entry.rc, entry.time});
+        }
+        return;
+    }
+
+    // the snapshots are in timelog.bin
+    const std::string timelogFilename =
+        folder + "/" + TIMELOG_FILENAME + "." + TIMELOG_FILENAME_EXT;
+    if (!exists(timelogFilename)) return;
+
+    const MappedFile timelog(timelogFilename);
+    constexpr std::size_t recordSize = 2 * sizeof(Int_BinType) + sizeof(Fp_BinType);
+    for (std::size_t offset = 0; offset + recordSize <= timelog.size(); offset += recordSize) {
+        const char* ptr = timelog.data() + offset;
+
+        Int_BinType t_num, rc;
+        Fp_BinType time;
+        std::memcpy(&t_num, ptr, sizeof(t_num));
+        std::memcpy(&rc, ptr + sizeof(t_num), sizeof(rc));
+        std::memcpy(&time, ptr + 2 * sizeof(Int_BinType), sizeof(time));
+        snapshots.push_back({static_cast<int>(t_num), rc, time});
+    }
+}
+
+const output::ContainerEntry& TrackingData::findEntry(
+    const output::SnapshotKind& kind, const int& t_num
+) const
+{
+    for (std::size_t i = 0; i < entryCount; ++i) {
+        if (entries[i].kind == static_cast<Int_BinType>(kind) &&
+            entries[i].t_num == static_cast<Int_BinType>(t_num)) {
+            const auto& entry = entries[i];
+            if (entry.offset > data->size() || entry.size > data->size() - entry.offset) {
+                throw std::runtime_error("Snapshot " + std::to_string(t_num) + " is truncated");
+            }
+            return entry;
+        }
+    }
+    throw std::runtime_error("There is no snapshot " + std::to_string(t_num) + " in the container");
+}
+
+Matrix TrackingData::getTrackingMatrix(const int& t_num) const
+{
+    if (isContainer()) {
+        const auto& entry = findEntry(output::SnapshotKind::trackingMatrix, t_num);
+        return Matrix::map(data, data->data() + entry.offset, entry.size);
+    }
+
+    auto file = std::make_shared<const MappedFile>(getSnapshotFileName(
+        folder, TRACKING_MATRIX_FILENAME, t_num, TRACKING_MATRIX_FILENAME_EXT
+    ));
+    const char* bytes = file->data();
+    const std::size_t size = file->size();
+    return Matrix::map(std::move(file), bytes, size);
+}
+
+Vector TrackingData::getVolumeVector(const int& t_num) const
+{
+    if (isContainer()) {
+        const auto& entry = findEntry(output::SnapshotKind::volumeVector, t_num);
+        return Vector::map(data, data->data() + entry.offset, entry.size);
+    }
+
+    auto file = std::make_shared<const MappedFile>(getSnapshotFileName(
+        folder, VOLUME_VECTOR_FILENAME, t_num, VOLUME_VECTOR_FILENAME_EXT
+    ));
+    const char* bytes = file->data();
+    const std::size_t size = file->size();
+    return Vector::map(std::move(file), bytes, size);
+}
+
+Matrix TrackingData::compose(
+    const int& from, const int& to, const bool& normalize, const double& dropTolerance
+) const
+{
+    // the snapshots in the chain
+    std::vector<int> chain;
+    for (const auto& snapshot : snapshots) {
+        if (snapshot.t_num > from && snapshot.t_num <= to) chain.push_back(snapshot.t_num);
+    }
+    if (chain.empty() || chain.back() != to) {
+        throw std::invalid_argument(
+            "There is no snapshot " + std::to_string(to) + " after " + std::to_string(from)
+        );
+    }
+
+    Matrix product = getTrackingMatrix(chain.front());
+    if (normalize) product = normalizeRows(product.view());
+
+    for (std::size_t i = 1; i < chain.size(); ++i) {
+        const Matrix next = getTrackingMatrix(chain[i]);
+        product = multiply(next.view(), product.view(), normalize, dropTolerance);
+    }
+
+    return product;
+}
@@ -0,0 +1,115 @@
+#ifndef TRACKING_DATA_H
+#define TRACKING_DATA_H
+
+#include "../output/container.h"
+#include "mappedfile.h"
+#include "matrix.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reader {
+
+/** @brief A snapshot with a volume tracking matrix */
+struct SnapshotInfo {
+    /** @brief The snapshot index, \f$n\f$ */
+    int t_num;
+
+    /** @brief The row count, \f$M^{n}\f$ */
+    Int_BinType rc;
+
+    /** @brief The time of the snapshot, \f$t^{n}\f$ */
+    Fp_BinType time;
+};
+
+/**
+ * @brief The tracking data written to a folder by ELA_Output()
+ *
+ * Reads either a [container](OutputFiles.html#container), if the folder has one, or the separate
+ * files. Only the list of snapshots (from the index or `timelog.bin`) is read when constructed;
+ * each volume tracking matrix or volume vector is only mapped when asked for, so snapshots can be
+ * iterated over without holding them all in memory.
+ *
+ * Snapshots written after this is constructed are not seen.
+ */
+class TrackingData {
+  public:
+    /**
+     * @throws std::runtime_error If the folder has a container that can not be read
+     *
+     * @param folder The folder the output was written to
+     */
+    explicit TrackingData(std::string folder);
+
+    /** @brief Whether the data is in a container */
+    bool isContainer() const noexcept
+    {
+        return data != nullptr;
+    }
+
+    /** @brief The snapshots with a volume tracking matrix, in the order written */
+    const std::vector<SnapshotInfo>& getSnapshots() const noexcept
+    {
+        return snapshots;
+    }
+
+    /**
+     * @brief The volume tracking matrix \f$\mathbf{Q}^{(n-1\rightarrow n)}\f$ of snapshot
+     * \p t_num
+     *
+     * @throws std::runtime_error If there is none, or it can not be read
+     */
+    Matrix getTrackingMatrix(const int& t_num) const;
+
+    /**
+     * @brief The volume vector \f$\mathbf{v}^{n}\f$ of snapshot \p t_num
+     *
+     * @throws std::runtime_error If there is none, or it can not be read
+     */
+    Vector getVolumeVector(const int& t_num) const;
+
+    /**
+     * @brief The product of the volume tracking matrices from snapshot \p from to \p to
+     *
+     * That is, \f$\mathbf{Q}^{(m-1\rightarrow m)}\cdots\mathbf{Q}^{(k\rightarrow k+1)}\f$, where
+     * \f$k\f$ is \p from and \f$m\f$ is \p to, using the snapshots of getSnapshots() after \p from
+     * up to \p to. The matrices are read one at a time, so only one is held in memory with the
+     * product.
+     *
+     * @throws std::invalid_argument If \p to is not a snapshot after \p from
+     * @throws std::runtime_error If a matrix can not be read, or they do not chain together
+     *
+     * @param from The earlier snapshot
+     * @param to The later snapshot
+     * @param normalize If true, each matrix has its rows divided by their sums (see
+     * normalizeRows()), so entry \f$(i,j)\f$ of the product is the fraction of the volume of blob
+     * \f$i\f$ at \p to that came from blob \f$j\f$ at \p from
+     * @param dropTolerance Entries of each partial product with magnitude at most this are
+     * dropped, which bounds the fill-in over long chains
+     */
+    Matrix compose(
+        const int& from, const int& to, const bool& normalize = true,
+        const double& dropTolerance = 0.0
+    ) const;
+
+  private:
+    /** @brief The entry of the snapshot of the \p kind at \p t_num in the container */
+    const output::ContainerEntry& findEntry(
+        const output::SnapshotKind& kind, const int& t_num
+    ) const;
+
+    const std::string folder;
+
+    // the container, if there is one
+    std::shared_ptr<const MappedFile> data;
+    std::shared_ptr<const MappedFile> index;
+    const output::ContainerEntry* entries = nullptr;
+    std::size_t entryCount = 0;
+
+    std::vector<SnapshotInfo> snapshots;
+};
+
+} // namespace reader
+
+#endif
@@ -121,10 +121,10 @@ void SVector::add(const NormalizedSVector& a, const Value& C)
     add(a.base, C * a.factor);
 }
 
-void SVector::normalize(const Value& total)
+bool SVector::normalize(const Value& total)
 {
     // quick exit
-    if (isEmpty()) return;
+    if (isEmpty()) return false;
 
     const Value s = sum();
 
@@ -134,19 +134,23 @@ void SVector::normalize(const Value& total)
     // total/s will give inf if s/total is subnormal
     if (total == 0 || s == 0 || std::abs(s / total) < std::numeric_limits<Value>::min()) {
         clear();
-        return;
+        return true;
     }
 
     // normalize each value so sum(s)=total;
     const Value factor = total / s;
     assert(std::isfinite(factor));
 
+    if (factor == 1.0) return false;
+
     for (auto& elm : vec) {
         elm *= factor;
     }
+
+    return true;
 }
 
-void SVector::chop(const Value& ref)
+bool SVector::chop(const Value& ref)
 {
     Value minV = std::numeric_limits<Value>::epsilon() * ref;
 
@@ -155,7 +159,10 @@ void SVector::chop(const Value& ref)
         return elm.v <= minV;
     });
 
+    const bool removed = (itr != vec.end());
     vec.erase(itr, vec.end());
+
+    return removed;
 }
 
 void svec::SVector::zeroEntry(const Label& l)
@@ -228,6 +235,14 @@ SVector svec::operator*(const SVector& a, const Value& C)
     return out;
 }
 
+bool svec::operator==(const SVector& a, const SVector& b)
+{
+    return std::equal(
+        a.vec.cbegin(), a.vec.cend(), b.vec.cbegin(), b.vec.cend(),
+        [](const Element& x, const Element& y) { return x.l == y.l && x.v == y.v; }
+    );
+}
+
 NormalizedSVector::NormalizedSVector(const SVector& a, const Value& total)
 {
     const Value s = a.sum();
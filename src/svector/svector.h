@@ -166,8 +166,9 @@ class SVector {
      * If sum(s) is zero or sum(s)/total is subnormal, \f$\mathbf{s}\gets\mathbf{0}\f$.
      *
      * @param total
+     * @return true if any element changed, false if sum(s) was already \p total
      */
-    void normalize(const Value& total = 1.0);
+    bool normalize(const Value& total = 1.0);
 
     /**
      * @brief Remove small elements in s
@@ -176,8 +177,9 @@ class SVector {
      * machine precision.
      *
      * @param ref \f$ R \f$
+     * @return true if any element was removed
      */
-    void chop(const Value& ref = 0.0);
+    bool chop(const Value& ref = 0.0);
 
     /**
      * @brief Set the entry at label \p l to zero
@@ -204,6 +206,7 @@ class SVector {
     friend SVector fma(const SVector& a, const Value& C, const SVector& b);
     friend SVector operator/(const SVector& a, const Value& C);
     friend SVector operator*(const SVector& a, const Value& C);
+    friend bool operator==(const SVector& a, const SVector& b);
 
   private:
     std::vector<Element> vec;
@@ -269,6 +272,12 @@ class NormalizedSVector {
         factor = 0;
     }
 
+    /** @brief Check if there are no non-zero elements, so adding this changes nothing */
+    inline bool isEmpty() const noexcept
+    {
+        return base.isEmpty();
+    }
+
     friend void SVector::add(const NormalizedSVector& a, const Value& C);
 
   private:
@@ -319,6 +328,17 @@ SVector operator/(const SVector& a, const Value& C);
  */
 SVector operator*(const SVector& a, const Value& C);
 
+/**
+ * @brief Equality, a==b
+ *
+ * True if \p a and \p b have the same non-zero labels, with exactly the same values
+ *
+ * @param a SVector, \f$\mathbf{a}\f$
+ * @param b SVector, \f$\mathbf{b}\f$
+ * @return bool
+ */
+bool operator==(const SVector& a, const SVector& b);
+
 inline SVector::SVector(const Element& elm) : vec(1, elm)
 {
 }
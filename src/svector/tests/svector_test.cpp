@@ -185,13 +185,17 @@ TEST(SVectorTests, Chop)
                              svec::END_ELEMENT};
     svec::SVector s = svec::SVector(buff);
 
-    s.chop();
+    EXPECT_TRUE(s.chop());
     EXPECT_EQ(s.NNZ(), 4);
     EXPECT_DOUBLE_EQ(s.sum(), 5 + 0.2 + 0.8);
 
-    s.chop(1.0);
+    EXPECT_TRUE(s.chop(1.0));
     EXPECT_EQ(s.NNZ(), 3);
     EXPECT_DOUBLE_EQ(s.sum(), 5 + 0.2 + 0.8);
+
+    // nothing else is small enough to remove
+    EXPECT_FALSE(s.chop(1.0));
+    EXPECT_EQ(s.NNZ(), 3);
 }
 
 TEST(SVectorTests, Normalize)
@@ -209,7 +213,7 @@ TEST(SVectorTests, Normalize)
     buff[length] = svec::END_ELEMENT;
 
     svec::SVector s = svec::SVector(buff);
-    s.normalize(0.3);
+    EXPECT_TRUE(s.normalize(0.3));
 
     for (std::size_t i = 0; i < length; i++) {
         EXPECT_EQ(buff[i].l, s.data()[i].l);
@@ -233,9 +237,14 @@ TEST(SVectorTests, Normalize)
 
     delete[] buff;
 
+    // a vector which already has the sum is not changed
+    s = svec::SVector(svec::Element({1, 0.5}));
+    EXPECT_FALSE(s.normalize(0.5));
+    EXPECT_EQ(s.data()[0].v, 0.5);
+
     // confirm nothing weird happens with empty vectors
     s = svec::SVector();
-    s.normalize();
+    EXPECT_FALSE(s.normalize());
     EXPECT_EQ(s.NNZ(), 0);
     EXPECT_EQ(s.sum(), 0.0);
 
@@ -327,3 +336,18 @@ TEST(SVectorTests, ContainsNaN)
     EXPECT_TRUE(s1.containsNaN());
     EXPECT_FALSE(s2.containsNaN());
 }
+
+TEST(SVectorTests, Equality)
+{
+    svec::Element buff1[4] = {{0, 0.1}, {1, 0.1}, {3, 0.2}, svec::END_ELEMENT};
+    svec::Element buff2[4] = {{0, 0.1}, {2, 0.1}, {3, 0.2}, svec::END_ELEMENT};
+    svec::Element buff3[4] = {{0, 0.1}, {1, 0.1}, {3, 0.3}, svec::END_ELEMENT};
+
+    const svec::SVector s1 = svec::SVector(buff1);
+
+    EXPECT_TRUE(s1 == svec::SVector(buff1));
+    EXPECT_FALSE(s1 == svec::SVector(buff2));
+    EXPECT_FALSE(s1 == svec::SVector(buff3));
+    EXPECT_FALSE(s1 == svec::SVector());
+    EXPECT_TRUE(svec::SVector() == svec::SVector());
+}
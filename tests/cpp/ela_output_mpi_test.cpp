@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <mpi.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <ELA.h>
+#include <ELA_Output.h>
+
+unsigned int count = 0;
+
+constexpr int dims[3] = {2, 2, 1};
+constexpr int periods[3] = {false, false, false};
+
+constexpr int N[3] = {6, 7, 8};
+const int NN = 2;
+
+constexpr int pad[6] = {1, 1, 1, 1, 1, 1};
+
+std::size_t getFieldSize()
+{
+    return (N[0] + pad[0] + pad[1]) * (N[1] + pad[2] + pad[3]) * (N[2] + pad[4] + pad[5]);
+}
+
+std::vector<double> randomDoubleField(const double& fMin, const double& fMax)
+{
+    std::vector<double> out(getFieldSize());
+    for (auto& x : out) {
+        x = fMin + (fMax - fMin) * (double)rand() / RAND_MAX;
+    }
+    return out;
+}
+
+std::vector<int> randomLabelField(const int& maxLabel)
+{
+    std::vector<int> out(getFieldSize());
+    for (auto& l : out) {
+        l = ++count % (maxLabel + 1);
+    }
+    return out;
+}
+
+bool isRoot()
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank == 0;
+}
+
+// an empty folder for the files of a test, made by root
+std::string newFolder(const std::string& name)
+{
+    if (isRoot()) {
+        std::filesystem::remove_all(name);
+        std::filesystem::create_directory(name);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    return name;
+}
+
+std::vector<char> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+// check the folders have the same files, with the same bytes, on root which writes them
+void expectSameFiles(const std::string& a, const std::string& b)
+{
+    if (!isRoot()) return;
+
+    std::size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(a)) {
+        const auto name = entry.path().filename().string();
+        EXPECT_EQ(readFile(a + "/" + name), readFile(b + "/" + name)) << name;
+        ++count;
+    }
+    EXPECT_GT(count, 0);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(b), {}), count);
+}
+
+// adapted from https://bbanerjee.github.io/ParSim/mpi/c++/mpi-unit-testing-googletests-cmake/
+class ELAEnvironment : public ::testing::Environment {
+  public:
+    virtual void SetUp()
+    {
+        char** argv;
+        int argc = 0;
+        ASSERT_EQ(MPI_Init(&argc, &argv), MPI_SUCCESS);
+
+        MPI_Comm comm_cart;
+        ASSERT_EQ(MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, true, &comm_cart), MPI_SUCCESS);
+        ELA_Init(N, pad, NN, comm_cart);
+
+        // each ELA instance has labels from another field
+        for (auto n = 0; n < NN; ++n) {
+            const auto labels = randomLabelField(5 + n);
+            const auto vof = randomDoubleField(0.0, 1.0);
+            ELA_InitLabels(vof.data(), n, labels.data());
+        }
+    }
+
+    virtual void TearDown()
+    {
+        ELA_DeInit();
+        ASSERT_EQ(MPI_Finalize(), MPI_SUCCESS);
+    }
+
+    virtual ~ELAEnvironment()
+    {
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(new ELAEnvironment);
+    return RUN_ALL_TESTS();
+}
+
+TEST(ELAOutputMPI, AsyncPending)
+{
+    const auto folder = newFolder("output_async");
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // every pending output is continued at each call, so only those of the last few calls are left,
+    // each has three
+    const int calls = 30;
+    ELA_SetOutputAsync(1);
+    for (auto t_num = 1; t_num <= calls; ++t_num) {
+        ELA_Output(labels.data(), vof.data(), dV.data(), 0, t_num, 0.1 * t_num, folder.c_str());
+        EXPECT_LE(ELA_OutputPending(), 3 * 4) << t_num;
+
+        // time for the messages to arrive, as for a step of the solver
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    // and most files are written before the flush
+    if (isRoot()) {
+        for (auto t_num = 1; t_num <= calls - 4; ++t_num) {
+            const auto name = std::to_string(1000000 + t_num).substr(1);
+            EXPECT_TRUE(std::filesystem::exists(folder + "/v_" + name + ".bin")) << t_num;
+            EXPECT_TRUE(std::filesystem::exists(folder + "/afwd_" + name + ".bin")) << t_num;
+        }
+    }
+
+    ELA_OutputFlush();
+    ELA_SetOutputAsync(0);
+    EXPECT_EQ(ELA_OutputPending(), 0);
+}
+
+TEST(ELAOutputMPI, AsyncDistributed)
+{
+    const auto async = newFolder("output_async_distributed");
+    const auto sync = newFolder("output_sync_distributed");
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // the exchange of the matrix waits for the row count of the volume vector, and the write for
+    // the next call
+    ELA_SetOutputDistributed(1);
+    for (const auto& [folder, on] : {std::make_pair(async, 1), std::make_pair(sync, 0)}) {
+        ELA_SetOutputAsync(on);
+        for (auto t_num = 1; t_num <= 3; ++t_num) {
+            ELA_Output(labels.data(), vof.data(), dV.data(), 0, t_num, 0.1 * t_num, folder.c_str());
+        }
+        ELA_OutputFlush();
+    }
+    ELA_SetOutputAsync(0);
+    ELA_SetOutputDistributed(0);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    expectSameFiles(async, sync);
+}
+
+TEST(ELAOutputMPI, AllAsync)
+{
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // every ELA instance at once and asynchronously, and one at a time
+    for (const auto distributed : {0, 1}) {
+        const auto suffix = "_" + std::to_string(distributed) + "_";
+        ELA_SetOutputDistributed(distributed);
+
+        std::vector<std::string> all;
+        std::vector<const char*> folders;
+        for (auto n = 0; n < NN; ++n) {
+            all.push_back(newFolder("output_all_async" + suffix + std::to_string(n)));
+        }
+        for (const auto& folder : all) {
+            folders.push_back(folder.c_str());
+        }
+        ELA_SetOutputAsync(1);
+        for (auto t_num = 1; t_num <= 3; ++t_num) {
+            ELA_OutputAll(labels.data(), vof.data(), dV.data(), t_num, 0.1 * t_num, folders.data());
+        }
+        ELA_OutputFlush();
+        ELA_SetOutputAsync(0);
+
+        for (auto n = 0; n < NN; ++n) {
+            const auto folder = newFolder("output_one_sync" + suffix + std::to_string(n));
+            for (auto t_num = 1; t_num <= 3; ++t_num) {
+                ELA_Output(
+                    labels.data(), vof.data(), dV.data(), n, t_num, 0.1 * t_num, folder.c_str()
+                );
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        for (auto n = 0; n < NN; ++n) {
+            expectSameFiles(all[n], "output_one_sync" + suffix + std::to_string(n));
+        }
+    }
+    ELA_SetOutputDistributed(0);
+}
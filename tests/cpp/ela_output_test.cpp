@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ELA.h>
+#include <ELA_Output.h>
+
+unsigned int count = 0;
+
+constexpr int N[3] = {10, 12, 14};
+const int NN = 2;
+
+constexpr int pad[6] = {1, 1, 1, 1, 1, 1};
+
+std::size_t getFieldSize()
+{
+    return (N[0] + pad[0] + pad[1]) * (N[1] + pad[2] + pad[3]) * (N[2] + pad[4] + pad[5]);
+}
+
+std::vector<double> randomDoubleField(const double& fMin, const double& fMax)
+{
+    std::vector<double> out(getFieldSize());
+    for (auto& x : out) {
+        x = fMin + (fMax - fMin) * (double)rand() / RAND_MAX;
+    }
+    return out;
+}
+
+std::vector<int> randomLabelField(const int& maxLabel)
+{
+    std::vector<int> out(getFieldSize());
+    for (auto& l : out) {
+        l = ++count % (maxLabel + 1);
+    }
+    return out;
+}
+
+// an empty folder for the files of a test
+std::string newFolder(const std::string& name)
+{
+    std::filesystem::remove_all(name);
+    std::filesystem::create_directory(name);
+    return name;
+}
+
+std::vector<char> readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+// check the folders have the same files, with the same bytes
+void expectSameFiles(const std::string& a, const std::string& b)
+{
+    std::size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(a)) {
+        const auto name = entry.path().filename().string();
+        EXPECT_EQ(readFile(a + "/" + name), readFile(b + "/" + name)) << name;
+        ++count;
+    }
+    EXPECT_GT(count, 0);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(b), {}), count);
+}
+
+void initELA()
+{
+    ELA_Init(N, pad, NN);
+
+    // each ELA instance has labels from another field
+    for (auto n = 0; n < NN; ++n) {
+        const auto labels = randomLabelField(5 + n);
+        const auto vof = randomDoubleField(0.0, 1.0);
+        ELA_InitLabels(vof.data(), n, labels.data());
+    }
+}
+
+class ELAEnvironment : public ::testing::Environment {
+  public:
+    virtual void SetUp()
+    {
+        initELA();
+    };
+
+    virtual void TearDown()
+    {
+        ELA_DeInit();
+    }
+
+    virtual ~ELAEnvironment()
+    {
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(new ELAEnvironment);
+    return RUN_ALL_TESTS();
+}
+
+TEST(ELAOutput, LogFolders)
+{
+    const auto a = newFolder("output_log_a");
+    const auto b = newFolder("output_log_b");
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // the batch of the first folder is written once another is used
+    ELA_SetOutputLogInterval(3);
+    ELA_OutputLog(vof.data(), dV.data(), 0, 1.0, a.c_str());
+    ELA_OutputLog(vof.data(), dV.data(), 0, 2.0, a.c_str());
+    ELA_OutputLog(vof.data(), dV.data(), 0, 3.0, b.c_str());
+    ELA_OutputFlush();
+    ELA_SetOutputLogInterval(1);
+
+    for (const auto& [folder, lines] : {std::make_pair(a, 2), std::make_pair(b, 1)}) {
+        const auto log = readFile(folder + "/tracking.log");
+        ASSERT_EQ(std::count(log.begin(), log.end(), '\n'), lines) << folder;
+    }
+}
+
+TEST(ELAOutput, SameAsSeparate)
+{
+    const auto fused = newFolder("output_fused");
+    const auto separate = newFolder("output_separate");
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    for (auto t_num = 1; t_num <= 2; ++t_num) {
+        const double time = 0.5 * t_num;
+        ELA_Output(labels.data(), vof.data(), dV.data(), 1, t_num, time, fused.c_str());
+
+        ELA_OutputWriteV(vof.data(), labels.data(), dV.data(), t_num, separate.c_str());
+        ELA_OutputWriteVTM(labels.data(), dV.data(), 1, t_num, time, separate.c_str());
+        ELA_OutputLog(vof.data(), dV.data(), 1, time, separate.c_str());
+    }
+    ELA_OutputFlush();
+
+    expectSameFiles(fused, separate);
+}
+
+TEST(ELAOutput, Threads)
+{
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // the blocks are summed on any number of threads, but merged in order
+    for (const auto threads : {1, 4}) {
+        const auto folder = newFolder("output_threads_" + std::to_string(threads));
+        ELA_SetOutputThreads(threads);
+        ELA_Output(labels.data(), vof.data(), dV.data(), 0, 1, 0.5, folder.c_str());
+        ELA_OutputFlush();
+    }
+    ELA_SetOutputThreads(1);
+
+    expectSameFiles("output_threads_1", "output_threads_4");
+}
+
+TEST(ELAOutput, All)
+{
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // every ELA instance at once, and one at a time
+    std::vector<std::string> all;
+    std::vector<const char*> folders;
+    for (auto n = 0; n < NN; ++n) {
+        all.push_back(newFolder("output_all_" + std::to_string(n)));
+    }
+    for (const auto& folder : all) {
+        folders.push_back(folder.c_str());
+    }
+    ELA_OutputAll(labels.data(), vof.data(), dV.data(), 1, 0.5, folders.data());
+
+    for (auto n = 0; n < NN; ++n) {
+        const auto folder = newFolder("output_one_" + std::to_string(n));
+        ELA_Output(labels.data(), vof.data(), dV.data(), n, 1, 0.5, folder.c_str());
+    }
+    ELA_OutputFlush();
+
+    for (auto n = 0; n < NN; ++n) {
+        expectSameFiles(all[n], "output_one_" + std::to_string(n));
+    }
+}
+
+TEST(ELAOutput, Events)
+{
+    const auto only = newFolder("output_events_only");
+    const auto matrix = newFolder("output_events_matrix");
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // the events are the same whether or not the matrices are written
+    for (const auto& [folder, events] :
+         {std::make_pair(only, ELA_EVENTS_ONLY), std::make_pair(matrix, ELA_EVENTS_WITH_MATRIX)}) {
+        ELA_SetOutputEvents(events);
+        for (auto t_num = 1; t_num <= 2; ++t_num) {
+            ELA_Output(labels.data(), vof.data(), dV.data(), 0, t_num, 0.5 * t_num, folder.c_str());
+        }
+    }
+    ELA_OutputFlush();
+    ELA_SetOutputEvents(ELA_EVENTS_OFF);
+
+    const auto events = readFile(only + "/events.bin");
+    EXPECT_GT(events.size(), 0);
+    EXPECT_EQ(events.size() % 32, 0);
+    EXPECT_EQ(events, readFile(matrix + "/events.bin"));
+
+    EXPECT_FALSE(std::filesystem::exists(only + "/afwd_000001.bin"));
+    EXPECT_FALSE(std::filesystem::exists(only + "/timelog.bin"));
+    EXPECT_TRUE(std::filesystem::exists(matrix + "/afwd_000002.bin"));
+
+    EXPECT_THROW(ELA_SetOutputEvents(3), std::invalid_argument);
+}
+
+TEST(ELAOutput, EventsAfterInit)
+{
+    const auto again = newFolder("output_events_again");
+    const auto fresh = newFolder("output_events_fresh");
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    ELA_SetOutputEvents(ELA_EVENTS_ONLY);
+    ELA_Output(labels.data(), vof.data(), dV.data(), 0, 1, 0.5, again.c_str());
+    ELA_OutputFlush();
+    const auto first = readFile(again + "/events.bin");
+
+    // a new run in the same folder finds no deaths from the volumes of the last run
+    ELA_DeInit();
+    initELA();
+    ELA_Output(labels.data(), vof.data(), dV.data(), 0, 1, 0.5, again.c_str());
+    ELA_Output(labels.data(), vof.data(), dV.data(), 0, 1, 0.5, fresh.c_str());
+    ELA_OutputFlush();
+    ELA_SetOutputEvents(ELA_EVENTS_OFF);
+
+    auto events = readFile(again + "/events.bin");
+    ASSERT_GE(events.size(), first.size());
+    events.erase(events.begin(), events.begin() + first.size());
+    EXPECT_EQ(events, readFile(fresh + "/events.bin"));
+}
+
+TEST(ELAOutput, BackgroundErrors)
+{
+    const auto labels = randomLabelField(7);
+    const auto vof = randomDoubleField(0.0, 1.0);
+    const auto dV = randomDoubleField(0.5, 1.0);
+
+    // the folder does not exist, so the write on the background thread fails
+    std::filesystem::remove_all("output_missing");
+    ELA_SetOutputBackground(2);
+    ELA_OutputWriteV(vof.data(), labels.data(), dV.data(), 1, "output_missing");
+    EXPECT_THROW(ELA_SetOutputBackground(0), std::runtime_error);
+
+    // the error is only thrown once
+    ELA_SetOutputBackground(0);
+}
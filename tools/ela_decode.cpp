@@ -0,0 +1,45 @@
+/*
+Convert a volume tracking matrix file, of any version, to the version 1 format
+
+    ela_decode INPUT OUTPUT
+
+See doc/OutputFiles.md for the formats.
+*/
+#include "output/binarywriter.h"
+#include "output/matrixencoding.h"
+
+#include <exception>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " INPUT OUTPUT\n"
+                  << "Convert a volume tracking matrix file to the version 1 format\n";
+        return 2;
+    }
+
+    try {
+        std::vector<output::Int_BinType> rowIndex, columnIndex;
+        std::vector<output::Fp_BinType> values;
+        output::readMatrix(argv[1], rowIndex, columnIndex, values);
+
+        const output::Int_BinType RC = static_cast<output::Int_BinType>(rowIndex.size() - 1);
+        const output::Int_BinType NNZ = static_cast<output::Int_BinType>(values.size());
+
+        output::BinaryWriter outputFile(argv[2]);
+        outputFile.write(RC);
+        outputFile.write(NNZ);
+        outputFile.write(rowIndex.data() + 1, RC);
+        outputFile.write(columnIndex.data(), NNZ);
+        outputFile.write(values.data(), NNZ);
+        outputFile.close();
+    }
+    catch (const std::exception& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}